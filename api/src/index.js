@@ -142,7 +142,7 @@ app.get('/loader', loaderSecurityMiddleware, async (req, res) => {
     
     // OBFUSCATE the loader content (makes dumped code unreadable)
     try {
-      const obfResult = obfuscate(loaderContent, { userId: 'loader', keyId: buildId });
+      const obfResult = await obfuscate(loaderContent, { userId: 'loader', keyId: buildId });
       if (obfResult.success && obfResult.code) {
         loaderContent = obfResult.code;
         console.log('[Loader] Obfuscated:', obfResult.stats.originalSize, '->', obfResult.stats.obfuscatedSize, 'bytes');
@@ -570,7 +570,7 @@ router.get('/scripts/:id/preview', async (req, res, next) => {
     const uniqueSessionId = crypto.randomBytes(32).toString('hex');
 
     // Apply obfuscation with unique session
-    const obfuscationResult = obfuscate(script.content, {
+    const obfuscationResult = await obfuscate(script.content, {
       level: level,
       userId: 'preview',
       keyId: 'preview',
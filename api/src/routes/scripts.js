@@ -93,14 +93,15 @@ router.get('/:placeId', async (req, res, next) => {
     });
 
     // Apply simple obfuscation (working version)
-    const obfuscationResult = obfuscate(script.content, {
+    const obfuscationResult = await obfuscate(script.content, {
       level: 'medium',
       userId: keyInfo?.userId || 'unknown',
       keyId: scriptToken.keyId,
-      sessionId: sessionId || 'unknown'
+      sessionId: sessionId || 'unknown',
+      poolKey: script.id
     });
 
-    console.log('[Script] Obfuscated:', script.name, '| Size:', obfuscationResult.stats.originalSize, '->', obfuscationResult.stats.obfuscatedSize);
+    console.log('[Script] Obfuscated:', script.name, '| Size:', obfuscationResult.stats.originalSize, '->', obfuscationResult.stats.obfuscatedSize, '| Seed:', obfuscationResult.stats.seed);
 
     res.json({
       success: true,
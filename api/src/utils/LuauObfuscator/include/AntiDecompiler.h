@@ -2,11 +2,12 @@
 #define ANTI_DECOMPILER_H
 
 #include "BytecodeBuilder.h"
+#include "Context.h"
 
 // Insert anti-decompiler traps that confuse Unluac, Luraph decompilers
-void InsertAntiDecompilerTraps(BytecodeChunk* chunk);
+void InsertAntiDecompilerTraps(BytecodeChunk* chunk, ObfContext* obf);
 
 // Generate anti-decompiler code patterns in script
-void GenerateAntiDecompilerPatterns(char** script, int* size, int* capacity);
+void GenerateAntiDecompilerPatterns(char** script, int* size, int* capacity, ObfContext* obf);
 
 #endif
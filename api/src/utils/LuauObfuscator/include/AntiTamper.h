@@ -2,6 +2,7 @@
 #define ANTI_TAMPER_H
 
 #include "Common.h"
+#include "Context.h"
 
 // ============================================
 // ANTI-TAMPER MODULE
@@ -45,10 +46,11 @@ typedef struct {
     int validatorCount;
     unsigned int masterChecksum;
     int silentFailEnabled;
+    ObfContext* obf;        // Owning job (random stream)
 } AntiTamperContext;
 
 // Function declarations
-AntiTamperContext* CreateAntiTamperContext();
+AntiTamperContext* CreateAntiTamperContext(ObfContext* obf);
 void AddCheckpoint(AntiTamperContext* ctx, CheckpointType type, int start, int end);
 void AddCrossValidator(AntiTamperContext* ctx, int funcA, int funcB);
 char* GenerateChecksumCode(AntiTamperContext* ctx, int variant);
@@ -58,9 +60,9 @@ unsigned int ComputeCRC32(const char* data, int len);
 void FreeAntiTamperContext(AntiTamperContext* ctx);
 
 // Robust anti-tamper with multiple checks
-char* GenerateRobustAntiTamper(int seed);
+char* GenerateRobustAntiTamper(int seed, ObfContext* obf);
 
 // Timing-based anti-debug
-char* GenerateTimingCheck();
+char* GenerateTimingCheck(ObfContext* obf);
 
 #endif
@@ -0,0 +1,30 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "Common.h"
+
+// ============================================
+// ARENA (bump-pointer allocation, released all at once)
+// ============================================
+//
+// Used for data that lives exactly as long as one compilation (AST nodes,
+// node lists, parsed strings). Nothing is freed individually.
+
+#define ARENA_DEFAULT_BLOCK (64 * 1024)
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;       // Block being carved; older blocks follow it
+    size_t blockSize;
+} Arena;
+
+Arena* CreateArena(size_t blockSize);  // 0 = ARENA_DEFAULT_BLOCK
+void FreeArena(Arena* arena);
+
+// Zeroed memory aligned for any type, or NULL when out of memory
+void* ArenaAlloc(Arena* arena, size_t size);
+// Grow a block obtained from ArenaAlloc (the old one is simply abandoned)
+void* ArenaGrow(Arena* arena, void* old, size_t oldSize, size_t newSize);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef AST_OPTIMIZER_H
+#define AST_OPTIMIZER_H
+
+#include "Common.h"
+#include "Parser.h"
+
+// ============================================
+// AST OPTIMIZER (runs between Parse and compilation)
+// ============================================
+//
+// Folds expressions whose operands are literals (arithmetic, comparisons,
+// not, # and .. of strings) and drops branches whose condition folds to a
+// constant: an if keeps only the arm that runs, a while false disappears.
+// Locals initialised with a literal and never assigned anywhere in the
+// chunk are treated as that literal, so `local DEBUG = false` guards fold
+// too. The tree is rewritten in place; new nodes and strings come from the
+// parser's arena and string table.
+
+void OptimizeAst(ASTNode* root, Parser* parser);
+
+#endif
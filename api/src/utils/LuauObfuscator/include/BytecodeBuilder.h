@@ -41,7 +41,21 @@ typedef enum {
     OP_SETLIST,
     OP_CLOSE,
     OP_CLOSURE,
-    OP_VARARG
+    OP_VARARG,
+    
+    // Superinstructions: run this instruction and the next one in a single
+    // dispatch. The next one is left in place as the operand carrier and still
+    // runs on its own when a jump or skip lands on it.
+    OP_GETGLOBAL_CALL,
+    OP_SELF_CALL,
+    OP_GETTABLE_GETTABLE,
+    OP_LOADK_SETTABLE,
+    OP_EQ_JMP,
+    OP_LT_JMP,
+    OP_LE_JMP,
+    OP_TEST_JMP,
+    
+    OP_COUNT
 } OpCode;
 
 typedef struct {
@@ -51,19 +65,109 @@ typedef struct {
     int C;
 } Instruction;
 
+// RK operands: B/C values from RK_CONSTANT up name K[value - RK_CONSTANT],
+// so registers used as B or C must stay below it
+#define RK_CONSTANT 256
+
+// A count of 0 (CALL B and C, RETURN B, VARARG B, SETLIST B) means "up to the
+// top": the frame's top is set by the CALL with C = 0 or VARARG with B = 0
+// right before, which leaves all its values from A on
+#define FIELDS_PER_FLUSH 50     // SETLIST stores at most this many; C counts such batches from 1
+
+typedef enum {
+    CONST_NIL,
+    CONST_BOOL,
+    CONST_NUMBER,
+    CONST_STRING
+} ConstantType;
+
+typedef struct {
+    ConstantType Type;
+    int Boolean;
+    double Number;
+    char* String;       // Owned, NUL-terminated (may also contain NULs)
+    int Length;
+} Constant;
+
+// Payload version byte; the watermarked form carries one extra string constant
+// in the main prototype. Layout: version, then the main prototype:
+//   varint constant count, constants
+//   varint parameter count, varint frame size (MaxStack)
+//   varint upvalue count, upvalues (byte isLocal, varint index)
+//   varint instruction count, instructions (op byte, varint A,
+//       zigzag varint B, varint C)
+//   varint child count, child prototypes
+// Varints are LEB128.
+#define BYTECODE_VERSION           0x09
+#define BYTECODE_VERSION_WATERMARK 0x0A
+
+// Serialized constant tags: one byte, then the value
+#define KTAG_NIL    0
+#define KTAG_FALSE  1
+#define KTAG_TRUE   2
+#define KTAG_INT    3   // int32, little endian
+#define KTAG_DOUBLE 4   // IEEE 754 binary64, little endian
+#define KTAG_STRING 5   // varint length, then the bytes
+
+// Where a closure's upvalue comes from when CLOSURE builds it
 typedef struct {
+    int IsLocal;    // 1 = register Index of the enclosing frame, 0 = its upvalue Index
+    int Index;
+} UpvalueDesc;
+
+typedef struct BytecodeChunk BytecodeChunk;
+
+// One function prototype; the main chunk is the root of the tree
+struct BytecodeChunk {
     Instruction* Instructions;
     int Count;
     int Capacity;
     
-    // Constants (simplified strings only for demo)
-    char** Constants; 
+    Constant* Constants;
     int ConstantCount;
-} BytecodeChunk;
+    int ConstantCapacity;
+    
+    int ParamCount;
+    int MaxStack;           // Registers the frame touches
+    UpvalueDesc* Upvalues;
+    int UpvalueCount;
+    
+    // Nested functions; CLOSURE A B instantiates Children[B]
+    BytecodeChunk** Children;
+    int ChildCount;
+    int ChildCapacity;
+};
 
 BytecodeChunk* CreateChunk();
 void AddInstruction(BytecodeChunk* chunk, OpCode op, int a, int b, int c);
-void AddConstant(BytecodeChunk* chunk, const char* str);
+void AddStringConstant(BytecodeChunk* chunk, const char* str, int length);
+void AddNumberConstant(BytecodeChunk* chunk, double value);
+// Takes ownership of child; returns its index for CLOSURE
+int AddChild(BytecodeChunk* chunk, BytecodeChunk* child);
+
+// LEB128: 7 bits per byte, low first, high bit set on all but the last
+int VarintSize(unsigned int value);
+int WriteVarint(unsigned char* out, unsigned int value);
+// Decode at data[*pos], advancing it; returns 0 if the varint runs past length
+int ReadVarint(const unsigned char* data, int length, int* pos, unsigned int* value);
+
+// Bytes WriteConstant emits for k
+int ConstantSize(const Constant* k);
+// Serialize k at out (KTAG_* then value); returns the bytes written
+int WriteConstant(unsigned char* out, const Constant* k);
+
+// Bytes WriteInstruction emits for ins
+int InstructionSize(const Instruction* ins);
+// Serialize ins at out with op as its opcode byte; returns the bytes written
+int WriteInstruction(unsigned char* out, int op, const Instruction* ins);
+
+// Bytes WritePrototype emits for chunk and its children
+int PrototypeSize(const BytecodeChunk* chunk);
+// Serialize chunk and its children at out, opcodes translated through
+// opcodeMap (NULL = as is). *constantsEnd (may be NULL) receives the offset
+// just past chunk's own constants. Returns the bytes written.
+int WritePrototype(unsigned char* out, const BytecodeChunk* chunk, const int* opcodeMap,
+                   int* constantsEnd);
 void FreeChunk(BytecodeChunk* chunk);
 
 #endif
@@ -2,6 +2,7 @@
 #define CODE_VIRTUALIZER_H
 
 #include "BytecodeBuilder.h"
+#include "Context.h"
 
 // Extended opcode set for deeper virtualization
 #define OP_VIRTUAL_NOP      50
@@ -15,6 +16,6 @@
 void GenerateExtendedVMHandlers(char** script, int* size, int* capacity, int* opcodeMap);
 
 // Insert virtualization layer
-void ApplyCodeVirtualization(BytecodeChunk* chunk);
+void ApplyCodeVirtualization(BytecodeChunk* chunk, ObfContext* obf);
 
 #endif
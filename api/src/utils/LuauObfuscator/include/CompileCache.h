@@ -0,0 +1,42 @@
+#ifndef COMPILE_CACHE_H
+#define COMPILE_CACHE_H
+
+#include "Common.h"
+#include "BytecodeBuilder.h"
+#include "Context.h"
+
+// ============================================
+// COMPILE CACHE (one BytecodeChunk per distinct script)
+// ============================================
+//
+// Compilation is deterministic and independent of the job's seed, so the
+// chunk for a given source is built once and shared read-only by every job
+// that obfuscates it. Only the generator stage runs per request.
+
+#define COMPILE_CACHE_DEFAULT_ENTRIES 64
+
+typedef struct CompiledScript CompiledScript;
+
+struct CompiledScript {
+    unsigned long long hash;    // FNV-1a of the source
+    char* source;               // Key, compared in full on a hash match (NULL if uncached)
+    size_t length;
+    BytecodeChunk* chunk;       // Read-only once published
+    int refs;                   // Jobs currently holding the entry
+    int cached;                 // Still listed (freed on last release otherwise)
+    unsigned long long lastUse; // LRU tick
+    CompiledScript* next;
+};
+
+// Compile length bytes of source or return the cached chunk for it.
+// useCache = 0 compiles a private chunk. Returns NULL with errorMsg filled on
+// a compile error; errors are not cached. A compile started here stops early
+// once job (may be NULL) is cancelled or past its deadline.
+CompiledScript* AcquireCompiledScript(const char* source, size_t length, int useCache,
+                                      const ObfContext* job, char* errorMsg, int errorSize);
+void RetainCompiledScript(CompiledScript* script);  // Extra reference for another holder
+void ReleaseCompiledScript(CompiledScript* script);
+
+// SetCompileCacheLimit (Obfuscator.h) resizes the cache
+
+#endif
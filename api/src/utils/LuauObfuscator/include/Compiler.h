@@ -4,23 +4,35 @@
 #include "Common.h"
 #include "Parser.h"
 #include "BytecodeBuilder.h"
+#include "Context.h"
 
 #define MAX_LOCALS 200
 #define MAX_UPVALUES 60
+#define MULTRET -1          // Value count asking a call or ... for all it has
 #define MAX_CONSTANTS 65536
 
 typedef struct {
-    char* name;
+    const char* name;   // Interned
     int depth;
     int slot;
+    int captured;       // An inner function holds it as an upvalue
 } Local;
 
 typedef struct {
-    char* name;
+    const char* name;
     int index;
     int isLocal;
 } Upvalue;
 
+// Constant pool index entry, keyed on (type, key bytes); open addressing
+typedef struct {
+    int type;               // CONSTANT_KEY_*, 0 = empty slot
+    unsigned int hash;
+    int length;
+    unsigned char key[8];   // Interned string pointer, or a number's double bits
+    int index;              // Into the chunk's constants
+} ConstantSlot;
+
 typedef struct Compiler Compiler;
 
 struct Compiler {
@@ -37,20 +49,28 @@ struct Compiler {
     int stackTop;
     int maxStack;
     
-    // For break statements
+    // Finds an existing constant in O(1); at most half full
+    ConstantSlot* constantSlots;
+    int constantSlotCount;
+    int constantSlotCapacity;   // Power of two
+    
+    // Pending break jumps of the enclosing loops, innermost last
     int* breakJumps;
     int breakCount;
     int breakCapacity;
+    int loopLocals;     // localCount when the innermost loop began; -1 outside loops
 };
 
 typedef struct {
     Compiler* current;
     Parser* parser;
+    ObfContext* obf;
     int hadError;
     char errorMsg[256];
 } CompilerState;
 
-CompilerState* CreateCompilerState(const char* source);
+// source is read in place and must stay valid until Compile returns
+CompilerState* CreateCompilerState(const char* source, int length, ObfContext* obf);
 void FreeCompilerState(CompilerState* state);
 BytecodeChunk* Compile(CompilerState* state);
 
@@ -0,0 +1,33 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "Common.h"
+
+// Per-job state: owns the random stream and every counter the pipeline uses.
+// One context per obfuscation; never shared between threads.
+typedef struct {
+    unsigned long long rng[4];  // xoshiro256** state
+    unsigned long long seed;    // Seed the stream was expanded from
+    long long deadline;         // MonotonicMs() limit, 0 = none
+    volatile int* cancel;       // Set non-zero by the owner to abandon the job
+} ObfContext;
+
+// Why a job stopped early
+#define CONTEXT_RUNNING   0
+#define CONTEXT_CANCELLED 1
+#define CONTEXT_EXPIRED   2
+
+ObfContext* CreateObfContext(unsigned long long seed);  // seed 0 = fresh entropy
+void FreeObfContext(ObfContext* ctx);
+
+long long MonotonicMs();
+int OnlineCores();  // Cores available to worker threads (4 when unknown)
+int ContextState(ObfContext* ctx);  // CONTEXT_RUNNING while the job should go on
+
+// Random Generation
+unsigned int RandomU32(ObfContext* ctx);
+int RandomInt(ObfContext* ctx, int min, int max);
+char* GenerateRandomString(ObfContext* ctx, int length);
+char* GenerateRandomHex(ObfContext* ctx, int length);
+
+#endif
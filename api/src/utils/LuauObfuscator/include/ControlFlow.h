@@ -2,6 +2,7 @@
 #define CONTROL_FLOW_H
 
 #include "Common.h"
+#include "Context.h"
 
 // ============================================
 // AGGRESSIVE CONTROL FLOW MODULE
@@ -39,10 +40,11 @@ typedef struct {
     unsigned int stateXorKey;
     int redundantJumps;
     int fakeLoops;
+    ObfContext* obf;        // Owning job (random stream)
 } ControlFlowContext;
 
 // Function declarations
-ControlFlowContext* CreateControlFlowContext();
+ControlFlowContext* CreateControlFlowContext(ObfContext* obf);
 void AddState(ControlFlowContext* ctx, StateType type, int nextReal);
 void InsertFakeStates(ControlFlowContext* ctx, int count);
 void InsertRedundantJumps(ControlFlowContext* ctx, int count);
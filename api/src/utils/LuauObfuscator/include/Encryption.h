@@ -2,6 +2,7 @@
 #define ENCRYPTION_H
 
 #include "Common.h"
+#include "Context.h"
 
 // ============================================
 // ADVANCED ENCRYPTION MODULE
@@ -15,6 +16,7 @@ typedef struct {
     unsigned int xorTable[256];     // XOR lookup table
     int keyRotation;
     int rounds;
+    ObfContext* obf;        // Owning job (random stream)
 } EncryptionContext;
 
 // Encrypted constant
@@ -27,7 +29,7 @@ typedef struct {
 } EncryptedConstant;
 
 // Function declarations
-EncryptionContext* CreateEncryptionContext();
+EncryptionContext* CreateEncryptionContext(ObfContext* obf);
 void GenerateKeys(EncryptionContext* ctx);
 char* EncryptConstant(EncryptionContext* ctx, const char* input, int* keyIndex);
 char* GenerateDecryptorCode(EncryptionContext* ctx, int variant);
@@ -2,14 +2,15 @@
 #define FLOW_OBFUSCATOR_H
 
 #include "BytecodeBuilder.h"
+#include "Context.h"
 
 // Control Flow Flattening - transforms control structures into state machine
 void ApplyControlFlowFlattening(BytecodeChunk* chunk);
 
 // Opaque Predicates - inserts always-true/false conditions
-void InsertOpaquePredicates(char** script, int* size, int* capacity);
+void InsertOpaquePredicates(char** script, int* size, int* capacity, ObfContext* obf);
 
 // Control Flow Dispatcher - state machine in script
-void GenerateControlFlowDispatcher(char** script, int* size, int* capacity);
+void GenerateControlFlowDispatcher(char** script, int* size, int* capacity, ObfContext* obf);
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "Common.h"
 #include "BytecodeBuilder.h"
+#include "Context.h"
 
 // ============================================
 // BYTECODE FRAGMENTER MODULE
@@ -39,10 +40,11 @@ typedef struct {
     int fakeCount;
     int* orderTable;    // Runtime reconstruction order
     int entryFragment;
+    ObfContext* obf;        // Owning job (random stream)
 } FragmentContext;
 
 // Function declarations
-FragmentContext* CreateFragmentContext();
+FragmentContext* CreateFragmentContext(ObfContext* obf);
 void FragmentBytecode(FragmentContext* ctx, BytecodeChunk* chunk, int blockSize);
 void InsertFakeBlocks(FragmentContext* ctx, int count);
 void ShuffleFragments(FragmentContext* ctx);
@@ -0,0 +1,23 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "Common.h"
+#include "Arena.h"
+
+// ============================================
+// STRING INTERNING (one table per compilation)
+// ============================================
+//
+// Every distinct identifier and string literal of a job is stored once, in
+// the job's arena. Equal text always yields the same pointer, so the parser
+// and compiler compare interned strings with ==.
+
+typedef struct StringTable StringTable;
+
+StringTable* CreateStringTable(Arena* arena);   // Strings live as long as arena
+void FreeStringTable(StringTable* table);       // Frees the index, not the strings
+
+// Interned NUL-terminated copy of str[0, length); NULL when out of memory
+const char* InternString(StringTable* table, const char* str, int length);
+
+#endif
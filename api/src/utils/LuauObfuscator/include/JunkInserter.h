@@ -2,11 +2,12 @@
 #define JUNK_INSERTER_H
 
 #include "BytecodeBuilder.h"
+#include "Context.h"
 
 // Insert junk/dead code into bytecode
-void InsertJunkCode(BytecodeChunk* chunk);
+void InsertJunkCode(BytecodeChunk* chunk, ObfContext* obf);
 
 // Generate realistic junk code patterns in script
-void GenerateJunkPatterns(char** script, int* size, int* capacity, int count);
+void GenerateJunkPatterns(char** script, int* size, int* capacity, int count, ObfContext* obf);
 
 #endif
@@ -2,6 +2,7 @@
 #define LEXER_H
 
 #include "Common.h"
+#include "Intern.h"
 
 typedef enum {
     // Literals
@@ -64,26 +65,41 @@ typedef enum {
     TOK_ERROR
 } TokenType;
 
+// A token is a view into the lexer's source (or, for TOK_ERROR, a static
+// message); it owns nothing and stays valid until the lexer is freed.
 typedef struct {
     TokenType type;
-    char* value;
+    const char* start;
+    int length;
     int line;
-    int column;
 } Token;
 
+// The whole input, lexed once, in structure-of-arrays form. It always ends
+// with TOK_EOF; a lexical error ends it early with TOK_ERROR then TOK_EOF.
+typedef struct {
+    unsigned char* types;   // TokenType
+    int* offsets;           // Into the source
+    int* lengths;
+    int* lines;
+    int count;
+    int capacity;
+    const char* error;      // Message of the TOK_ERROR entry, if any
+} TokenStream;
+
 typedef struct {
-    char* source;
+    const char* source;     // Borrowed; CRLF is left in place and read as LF
     int pos;
     int line;
-    int column;
     int length;
-    Token current;
+    TokenStream tokens;
 } Lexer;
 
-Lexer* CreateLexer(const char* source);
+// source need not be NUL-terminated and must outlive the lexer
+Lexer* CreateLexer(const char* source, int length);
 void FreeLexer(Lexer* lexer);
-Token NextToken(Lexer* lexer);
-Token PeekToken(Lexer* lexer);
+int Tokenize(Lexer* lexer);             // Fill lexer->tokens; 0 when out of memory
+Token TokenAt(const Lexer* lexer, int index);  // Past the end yields the final EOF
+const char* InternToken(const Token* token, StringTable* strings);  // Interned text
 const char* TokenTypeName(TokenType type);
 
 #endif
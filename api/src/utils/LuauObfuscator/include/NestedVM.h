@@ -1,22 +1,24 @@
 #ifndef NESTED_VM_H
 #define NESTED_VM_H
 
+#include "Context.h"
+
 // Nested VM - VM within VM execution
-void GenerateNestedVMWrapper(char** script, int* size, int* capacity);
+void GenerateNestedVMWrapper(char** script, int* size, int* capacity, ObfContext* obf);
 
 // Generate inner VM dispatcher
-void GenerateInnerVMDispatcher(char** script, int* size, int* capacity, int layer);
+void GenerateInnerVMDispatcher(char** script, int* size, int* capacity, int layer, ObfContext* obf);
 
 // Metamorphic code generator
-void GenerateMetamorphicCode(char** script, int* size, int* capacity);
+void GenerateMetamorphicCode(char** script, int* size, int* capacity, ObfContext* obf);
 
 // Self-modifying code patterns
-void GenerateSelfModifyingPatterns(char** script, int* size, int* capacity);
+void GenerateSelfModifyingPatterns(char** script, int* size, int* capacity, ObfContext* obf);
 
 // Bytecode encryption layer
-void GenerateBytecodeEncryption(char** script, int* size, int* capacity, int key);
+void GenerateBytecodeEncryption(char** script, int* size, int* capacity, int key, ObfContext* obf);
 
 // Native-like code generation (optimized Lua patterns)
-void GenerateNativePatterns(char** script, int* size, int* capacity);
+void GenerateNativePatterns(char** script, int* size, int* capacity, ObfContext* obf);
 
 #endif
@@ -0,0 +1,92 @@
+#ifndef OBFUSCATOR_H
+#define OBFUSCATOR_H
+
+#include <stddef.h>
+
+// ============================================
+// LIBRARY API (libluauobf)
+// ============================================
+//
+// Entry point shared by the CLI, the --serve loop and the Node addon.
+// Each call runs on its own ObfContext, so calls may be issued from any
+// number of threads at once.
+
+// Result status
+#define OBF_OK        0
+#define OBF_ERROR     1
+#define OBF_TIMEOUT   2   // Deadline passed before the job finished
+#define OBF_CANCELLED 3   // *cancel was set while the job ran
+
+// ObfOptions.options bits
+#define OBF_OPT_NO_CACHE 0x1    // Compile privately, bypassing the compile cache
+
+typedef struct {
+    unsigned long long seed;    // 0 = random; the same seed, source and watermark give
+                                // byte-identical output
+    unsigned int options;       // OBF_OPT_* bits, 0 for defaults
+    const char* watermark;      // Optional per-user tag (< 64 KiB), may be NULL
+    size_t watermarkLength;
+    unsigned int timeoutMs;     // Give up after this long, 0 = no deadline
+    volatile int* cancel;       // Optional flag the caller sets to abandon the job
+} ObfOptions;
+
+typedef struct {
+    int status;                 // OBF_OK, OBF_ERROR, OBF_TIMEOUT or OBF_CANCELLED
+    char* output;               // Obfuscated script (NUL-terminated), owned by the result
+    size_t outputLength;
+    int constantCount;
+    int instructionCount;
+    unsigned long long seed;    // Seed the build came from; passing it back reproduces the output
+    char errorMsg[300];
+} ObfResult;
+
+// Obfuscate len bytes of Lua source. options may be NULL for defaults.
+// Returns result->status; release the result with FreeObfResult.
+int ObfuscateBuffer(const char* src, size_t len, const ObfOptions* options, ObfResult* result);
+void FreeObfResult(ObfResult* result);
+
+// Compile once and build count independently randomized variants in parallel,
+// variant i from seeds[i] (seeds may be NULL for random ones). results holds
+// count entries, each released with FreeObfResult. timeoutMs and cancel cover
+// the whole batch: once either stops it, every result and the return value are
+// OBF_TIMEOUT or OBF_CANCELLED. Returns OBF_OK when every variant was built.
+int ObfuscateVariants(const char* src, size_t len, int count, const unsigned long long* seeds,
+                      const ObfOptions* options, ObfResult* results);
+
+// ============================================
+// VARIANT POOL (resident processes)
+// ============================================
+//
+// Keeps up to highWater ready builds for each of the maxScripts most recently
+// used scripts (0 = default 32). A pooled request pops one and only patches in
+// its watermark; idle threads call RefillVariantPool to replace what was taken.
+
+typedef struct VariantPool VariantPool;
+
+VariantPool* CreateVariantPool(int highWater, int maxScripts);
+void FreeVariantPool(VariantPool* pool);  // No other pool call may be running
+
+// Like ObfuscateBuffer, serving from the builds kept for key. The first
+// request for a key, or one whose source no longer matches what key was
+// built from, is generated directly and (re)starts stocking the key.
+// Seeded requests bypass the pool, since its builds are random.
+int ObfuscatePooled(VariantPool* pool, const char* key, size_t keyLength,
+                    const char* src, size_t len, const ObfOptions* options, ObfResult* result);
+
+// Build one missing variant; returns 0 when every script is stocked
+int RefillVariantPool(VariantPool* pool);
+// Builds still needed to bring every script to its high-water mark
+int VariantPoolDeficit(VariantPool* pool);
+
+// The watermark is not part of the compiled source: it is stored as an extra
+// encrypted constant in the payload, so every user shares one compiled chunk.
+// Recovers it from an obfuscated script into out (NUL-terminated, truncated
+// to outSize); returns its full length, or -1 if the script carries none.
+int ExtractWatermark(const char* script, size_t length, char* out, size_t outSize);
+
+// Compiled scripts are cached by content and shared between calls; only the
+// randomized generation runs per call. Sets how many distinct scripts are
+// kept (default 64, 0 disables the cache).
+void SetCompileCacheLimit(int entries);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "Common.h"
 #include "Lexer.h"
+#include "Context.h"
 
 typedef enum {
     NODE_CHUNK,
@@ -45,13 +46,14 @@ typedef struct {
 struct ASTNode {
     NodeType type;
     int line;
+    int parenthesized;      // (f()) and (...) give exactly one value
     
     union {
         // Number literal
         double number;
         
-        // String/Name
-        char* string;
+        // String/Name (interned)
+        const char* string;
         
         // Boolean
         int boolean;
@@ -97,7 +99,7 @@ struct ASTNode {
         
         // Numeric for
         struct {
-            char* var;
+            const char* var;
             ASTNode* start;
             ASTNode* limit;
             ASTNode* step;
@@ -120,7 +122,7 @@ struct ASTNode {
         // Method call (obj:method(args))
         struct {
             ASTNode* object;
-            char* method;
+            const char* method;
             NodeList args;
         } methodcall;
         
@@ -133,12 +135,12 @@ struct ASTNode {
         // Dot access (obj.field)
         struct {
             ASTNode* object;
-            char* field;
+            const char* field;
         } dotindex;
         
         // Function definition
         struct {
-            char* name;
+            const char* name;
             NodeList params;
             int isVararg;
             ASTNode* body;
@@ -170,20 +172,22 @@ struct ASTNode {
 
 typedef struct {
     Lexer* lexer;
+    Arena* arena;       // Every AST node, node list and string of the parse
+    StringTable* strings;   // Interns names and literals; compare them with ==
+    int pos;            // Index of current in lexer->tokens
     Token current;
     Token previous;
     int hadError;
     char errorMsg[256];
+    ObfContext* job;    // Optional; parsing stops once the job is cancelled or expired
 } Parser;
 
-Parser* CreateParser(const char* source);
-void FreeParser(Parser* parser);
-ASTNode* Parse(Parser* parser);
-void FreeAST(ASTNode* node);
+Parser* CreateParser(const char* source, int length);  // Borrows source
+void FreeParser(Parser* parser);    // Also releases the AST
+ASTNode* Parse(Parser* parser);     // The tree lives in parser->arena
 
 // Helper functions
 NodeList CreateNodeList();
-void AddNode(NodeList* list, ASTNode* node);
-void FreeNodeList(NodeList* list);
+void AddNode(NodeList* list, ASTNode* node, Arena* arena);
 
 #endif
@@ -0,0 +1,32 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "Common.h"
+#include "BytecodeBuilder.h"
+
+// ============================================
+// PEEPHOLE OPTIMIZER (runs on the compiled chunk)
+// ============================================
+//
+// Rewrites a prototype and all of its children in place:
+// - MOVE A A and JMP 0 are removed
+// - a JMP landing on another JMP goes straight to the final target
+// - a comparison whose value only feeds TEST/JMP
+//   (CMP, JMP 1, LOADBOOL, LOADBOOL, TEST, JMP) becomes CMP, JMP
+// - code no path reaches (after RETURN or JMP) is removed
+// Jump offsets (JMP, FORPREP, FORLOOP) are recomputed after every removal.
+
+void PeepholeOptimize(BytecodeChunk* chunk);
+
+// ============================================
+// SUPERINSTRUCTIONS (last pass before serialization)
+// ============================================
+//
+// Retags the head of common pairs (GETGLOBAL+CALL, SELF+CALL,
+// GETTABLE+GETTABLE, LOADK+SETTABLE, EQ/LT/LE/TEST+JMP) with a fused opcode
+// whose handler runs both halves in one dispatch. The second instruction is
+// kept as is, so the other passes must run before this one.
+
+void FuseSuperinstructions(BytecodeChunk* chunk);
+
+#endif
@@ -2,6 +2,7 @@
 #define POLYMORPHIC_H
 
 #include "Common.h"
+#include "Context.h"
 
 // ============================================
 // POLYMORPHIC FUNCTIONS MODULE
@@ -33,10 +34,11 @@ typedef struct {
     int templateCount;
     int buildSeed;
     int variantChoices[MAX_TEMPLATES];
+    ObfContext* obf;        // Owning job (random stream)
 } PolymorphicContext;
 
 // Function declarations
-PolymorphicContext* CreatePolymorphicContext(int seed);
+PolymorphicContext* CreatePolymorphicContext(int seed, ObfContext* obf);
 void AddTemplate(PolymorphicContext* ctx, TemplateType type, const char* code);
 char* GetRandomVariant(PolymorphicContext* ctx, TemplateType type);
 char* ShuffleArguments(PolymorphicContext* ctx, const char* code);
@@ -2,6 +2,7 @@
 #define PROTECTION_H
 
 #include "../include/Common.h"
+#include "../include/Context.h"
 
 // Returns a Lua chunk string for Anti-Tamper
 char* GetAntiTamperCode();
@@ -10,6 +11,6 @@ char* GetAntiTamperCode();
 char* GetAntiDebugCode();
 
 // Returns a Lua chunk string for Control Flow Flattening (Junk loop)
-char* GetControlFlowJunk();
+char* GetControlFlowJunk(ObfContext* obf);
 
 #endif
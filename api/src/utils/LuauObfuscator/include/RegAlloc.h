@@ -0,0 +1,23 @@
+#ifndef REG_ALLOC_H
+#define REG_ALLOC_H
+
+#include "Common.h"
+#include "BytecodeBuilder.h"
+
+// ============================================
+// REGISTER ALLOCATOR (runs on the compiled chunk)
+// ============================================
+//
+// The compiler hands out registers as a stack, so every temporary gets a
+// fresh slot and assignments go through a MOVE. This pass computes which
+// registers are live at every instruction, splits each register into the
+// values it holds (webs) and gives each web the lowest register that is
+// free over its range, preferring the one its MOVE partner sits in; those
+// MOVEs become MOVE A A, which the peephole pass removes.
+// Registers inside windows (CALL arguments, for-loop state, SELF, SETLIST),
+// parameters and registers captured by closures keep their number. Sets
+// MaxStack of every prototype to the registers it ends up touching.
+
+void AllocateRegisters(BytecodeChunk* chunk);
+
+#endif
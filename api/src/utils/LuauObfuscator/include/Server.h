@@ -0,0 +1,20 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "Common.h"
+
+// ============================================
+// SERVE MODE (resident process, framed stdin/stdout)
+// ============================================
+
+typedef struct {
+    int workers;        // Worker threads, 0 = one per core
+    int queueDepth;     // Jobs allowed to wait; more are answered "busy"
+    int poolSize;       // Pre-generated builds kept per script, 0 = no pool
+    int poolScripts;    // Scripts the pool keeps builds for, 0 = default
+} ServerConfig;
+
+// Serve framed requests on stdin until it closes (returns process exit code)
+int RunServer(const ServerConfig* config);
+
+#endif
@@ -2,17 +2,18 @@
 #define STRING_ENCRYPTOR_H
 
 #include "BytecodeBuilder.h"
+#include "Context.h"
 
 // Encrypt all string constants in bytecode
 void EncryptStringConstants(BytecodeChunk* chunk, int encryptionKey);
 
 // Generate string decryption runtime code
-void GenerateStringDecryptor(char** script, int* size, int* capacity, int encryptionKey);
+void GenerateStringDecryptor(char** script, int* size, int* capacity, int encryptionKey, ObfContext* obf);
 
 // Generate constant number encryption
-void GenerateConstantEncryption(char** script, int* size, int* capacity);
+void GenerateConstantEncryption(char** script, int* size, int* capacity, ObfContext* obf);
 
 // Generate multi-layer VM wrapper
-void GenerateMultiLayerVM(char** script, int* size, int* capacity);
+void GenerateMultiLayerVM(char** script, int* size, int* capacity, ObfContext* obf);
 
 #endif
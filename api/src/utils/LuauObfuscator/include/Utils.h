@@ -3,19 +3,16 @@
 
 #include "../include/Common.h"
 #include "../include/BytecodeBuilder.h"
-
-// Random Generation
-void SeedRandom();
-int RandomInt(int min, int max);
-char* GenerateRandomString(int length);
-char* GenerateRandomHex(int length);
+#include "../include/Context.h"
 
 // Logging
 void LogInfo(const char* format, ...);
 void LogError(const char* format, ...);
+void SetLogStream(FILE* stream);  // Where LogInfo writes (stdout by default)
 
 // Base85 Encoding
 char* EncodeBase85Custom(const unsigned char* data, int len);
+unsigned char* DecodeBase85Custom(const char* text, int len, int* outLen);
 char* SerializeBytecode(BytecodeChunk* chunk);
 
 // String buffer helper
@@ -0,0 +1,41 @@
+#ifndef VARIANT_POOL_H
+#define VARIANT_POOL_H
+
+#include "Common.h"
+#include "CompileCache.h"
+#include "VmGenerator.h"
+#include "Obfuscator.h"
+
+// ============================================
+// VARIANT POOL (pre-generated builds per script)
+// ============================================
+//
+// Scripts are registered under a caller-chosen key. Each keeps up to
+// highWater finished builds without a watermark; serving one is a pop plus
+// AssembleScript. RefillVariantPool builds the next missing variant and is
+// meant to be called by otherwise idle threads.
+
+#define VARIANT_POOL_DEFAULT_SCRIPTS 32
+
+typedef struct PoolSlot PoolSlot;
+
+struct PoolSlot {
+    char* key;
+    size_t keyLength;
+    CompiledScript* script;     // Chunk the variants are built from (one reference)
+    ScriptParts** ready;        // Up to highWater builds, newest last
+    int readyCount;
+    int building;               // Refills in flight
+    int generation;             // Bumped when the script's source changes
+    int dropped;                // Evicted; the last refill frees it
+    unsigned long long lastUse;
+    PoolSlot* next;
+};
+
+// Register script under key and pop a ready build, or NULL when none is
+// ready yet. A key whose source hash changed drops every build made from
+// the old source first.
+ScriptParts* TakePooledVariant(VariantPool* pool, const char* key, size_t keyLength,
+                               CompiledScript* script);
+
+#endif
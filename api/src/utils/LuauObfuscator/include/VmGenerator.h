@@ -3,9 +3,37 @@
 
 #include "../include/Common.h"
 #include "../include/BytecodeBuilder.h"
+#include "../include/Context.h"
 
 // Generates the full obfuscated Lua script string from the bytecode chunk
 // Now supports polymorphism and encryption
-char* GenerateObfuscatedScript(BytecodeChunk* chunk);
+// watermark (optional) is embedded as an encrypted constant in the payload
+char* GenerateObfuscatedScript(const BytecodeChunk* chunk, const char* watermark,
+                               size_t watermarkLength, ObfContext* obf);
+
+// A build with its payload cut out, so the watermark can be patched in
+// later without regenerating (the variant pool stores these)
+typedef struct {
+    char* text;                 // Script text without the encoded payload
+    int splitAt;                // Offset in text where the payload goes
+    unsigned char* payload;     // Serialized bytecode, no watermark
+    int payloadLength;
+    int constantsEnd;           // Payload offset just past the last constant
+    int buildId;                // Keys the watermark constant
+    unsigned long long seed;    // Seed of the context it was generated with
+} ScriptParts;
+
+ScriptParts* GenerateScriptParts(const BytecodeChunk* chunk, ObfContext* obf);
+char* AssembleScript(const ScriptParts* parts, const char* watermark, size_t watermarkLength);
+void FreeScriptParts(ScriptParts* parts);
+
+// Builds k independently randomized variants of one chunk in parallel, one
+// per seeds[i] (seeds may be NULL for random). usedSeeds, if given, receives
+// the seed each variant was built from. Every build carries job's deadline
+// and cancel flag (job may be NULL) and comes back NULL once the job stops.
+// Returns k scripts, each NULL if its build failed; free the entries and the array.
+char** GenerateVariants(const BytecodeChunk* chunk, int k, const unsigned long long* seeds,
+                        const char* watermark, size_t watermarkLength,
+                        const ObfContext* job, unsigned long long* usedSeeds);
 
 #endif
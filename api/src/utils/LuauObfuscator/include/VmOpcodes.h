@@ -2,6 +2,7 @@
 #define VM_OPCODES_H
 
 #include "Common.h"
+#include "Context.h"
 
 // ============================================
 // EXTENDED OPCODE SET (50+ opcodes)
@@ -129,10 +130,11 @@ typedef struct {
     int shuffleKey;
     int xorKey;
     int buildId;
+    ObfContext* obf;        // Owning job (random stream)
 } OpcodeTable;
 
 // Function declarations
-OpcodeTable* CreateOpcodeTable();
+OpcodeTable* CreateOpcodeTable(ObfContext* obf);
 void ShuffleOpcodes(OpcodeTable* table);
 int GetShuffledOpcode(OpcodeTable* table, int realOp);
 int GetRealOpcode(OpcodeTable* table, int shuffledOp);
@@ -0,0 +1,187 @@
+#include <pthread.h>
+
+#include "../../include/Common.h"
+#include "../../include/Context.h"
+#include "../../include/Compiler.h"
+#include "../../include/CompileCache.h"
+#include "../../include/Obfuscator.h"
+
+// ============================================
+// COMPILE CACHE
+// ============================================
+
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static CompiledScript* cacheHead = NULL;
+static int cacheCount = 0;
+static int cacheLimit = COMPILE_CACHE_DEFAULT_ENTRIES;
+static unsigned long long cacheTick = 0;
+
+static unsigned long long hashSource(const char* source, size_t length) {
+    unsigned long long hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)source[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static void freeScript(CompiledScript* script) {
+    FreeChunk(script->chunk);
+    free(script->source);
+    free(script);
+}
+
+// Caller holds cacheLock
+static CompiledScript* findScript(unsigned long long hash, const char* source, size_t length) {
+    for (CompiledScript* s = cacheHead; s; s = s->next) {
+        if (s->hash == hash && s->length == length && memcmp(s->source, source, length) == 0) {
+            s->refs++;
+            s->lastUse = ++cacheTick;
+            return s;
+        }
+    }
+    return NULL;
+}
+
+// Caller holds cacheLock. Unlisted entries still in use are freed by their
+// last ReleaseCompiledScript; idle ones are returned through *idle.
+static void evictOver(int limit, CompiledScript** idle) {
+    while (cacheCount > limit) {
+        CompiledScript** oldest = &cacheHead;
+        for (CompiledScript** link = &cacheHead; *link; link = &(*link)->next) {
+            if ((*link)->lastUse < (*oldest)->lastUse) oldest = link;
+        }
+
+        CompiledScript* victim = *oldest;
+        *oldest = victim->next;
+        cacheCount--;
+        victim->cached = 0;
+        if (victim->refs == 0) {
+            victim->next = *idle;
+            *idle = victim;
+        }
+    }
+}
+
+static void freeIdle(CompiledScript* idle) {
+    while (idle) {
+        CompiledScript* next = idle->next;
+        freeScript(idle);
+        idle = next;
+    }
+}
+
+static BytecodeChunk* compileSource(const char* source, size_t length, const ObfContext* job,
+                                    char* errorMsg, int errorSize) {
+    // The compiler draws no randomness; the context only numbers functions
+    // and carries the job's deadline, so a chunk is the same whichever job
+    // compiled it
+    ObfContext* obf = CreateObfContext(1);
+    if (!obf) {
+        snprintf(errorMsg, errorSize, "Out of memory");
+        return NULL;
+    }
+    if (job) {
+        obf->deadline = job->deadline;
+        obf->cancel = job->cancel;
+    }
+
+    CompilerState* state = CreateCompilerState(source, (int)length, obf);
+    BytecodeChunk* chunk = Compile(state);
+
+    if (state->hadError || !chunk) {
+        snprintf(errorMsg, errorSize, "Compilation failed: %s", state->errorMsg);
+        chunk = NULL;
+    }
+
+    FreeCompilerState(state);
+    FreeObfContext(obf);
+    return chunk;
+}
+
+CompiledScript* AcquireCompiledScript(const char* source, size_t length, int useCache,
+                                      const ObfContext* job, char* errorMsg, int errorSize) {
+    // The caller's buffer is compiled in place; only a cached entry keeps a
+    // copy of it, as the key
+    unsigned long long hash = hashSource(source, length);
+    CompiledScript* script = NULL;
+
+    if (useCache) {
+        pthread_mutex_lock(&cacheLock);
+        script = cacheLimit > 0 ? findScript(hash, source, length) : NULL;
+        pthread_mutex_unlock(&cacheLock);
+        if (script) return script;
+    }
+
+    // Compile outside the lock so a large script never stalls other jobs
+    BytecodeChunk* chunk = compileSource(source, length, job, errorMsg, errorSize);
+    if (!chunk) return NULL;
+
+    script = (CompiledScript*)calloc(1, sizeof(CompiledScript));
+    if (!script) {
+        FreeChunk(chunk);
+        snprintf(errorMsg, errorSize, "Out of memory");
+        return NULL;
+    }
+    script->length = length;
+    script->hash = hash;
+    script->chunk = chunk;
+    script->refs = 1;
+
+    if (!useCache) return script;
+
+    // Uncacheable without its key, but the chunk is still good for this job
+    script->source = (char*)malloc(length ? length : 1);
+    if (!script->source) return script;
+    memcpy(script->source, source, length);
+
+    CompiledScript* idle = NULL;
+    pthread_mutex_lock(&cacheLock);
+    if (cacheLimit > 0) {
+        // Another job may have compiled the same script meanwhile
+        CompiledScript* existing = findScript(hash, source, length);
+        if (existing) {
+            idle = script;
+            script = existing;
+        } else {
+            script->cached = 1;
+            script->lastUse = ++cacheTick;
+            script->next = cacheHead;
+            cacheHead = script;
+            cacheCount++;
+            evictOver(cacheLimit, &idle);
+        }
+    }
+    pthread_mutex_unlock(&cacheLock);
+
+    freeIdle(idle);
+    return script;
+}
+
+void RetainCompiledScript(CompiledScript* script) {
+    pthread_mutex_lock(&cacheLock);
+    script->refs++;
+    pthread_mutex_unlock(&cacheLock);
+}
+
+void ReleaseCompiledScript(CompiledScript* script) {
+    if (!script) return;
+
+    pthread_mutex_lock(&cacheLock);
+    int unused = --script->refs == 0 && !script->cached;
+    pthread_mutex_unlock(&cacheLock);
+
+    if (unused) freeScript(script);
+}
+
+void SetCompileCacheLimit(int entries) {
+    if (entries < 0) entries = 0;
+
+    CompiledScript* idle = NULL;
+    pthread_mutex_lock(&cacheLock);
+    cacheLimit = entries;
+    evictOver(entries, &idle);
+    pthread_mutex_unlock(&cacheLock);
+
+    freeIdle(idle);
+}
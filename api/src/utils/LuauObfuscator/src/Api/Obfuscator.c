@@ -0,0 +1,179 @@
+#include "../../include/Common.h"
+#include "../../include/Utils.h"
+#include "../../include/BytecodeBuilder.h"
+#include "../../include/VmGenerator.h"
+#include "../../include/CompileCache.h"
+#include "../../include/VariantPool.h"
+#include "../../include/Obfuscator.h"
+
+// Map an abandoned context onto a result status (OBF_OK while it may go on)
+static int abandoned(ObfContext* obf, ObfResult* result) {
+    switch (ContextState(obf)) {
+        case CONTEXT_CANCELLED:
+            snprintf(result->errorMsg, sizeof(result->errorMsg), "Job cancelled");
+            return result->status = OBF_CANCELLED;
+        case CONTEXT_EXPIRED:
+            snprintf(result->errorMsg, sizeof(result->errorMsg), "Job deadline exceeded");
+            return result->status = OBF_TIMEOUT;
+        default:
+            return OBF_OK;
+    }
+}
+
+static int fail(ObfResult* result, const char* msg) {
+    if (msg != result->errorMsg) {
+        snprintf(result->errorMsg, sizeof(result->errorMsg), "%s", msg);
+    }
+    result->status = OBF_ERROR;
+    return OBF_ERROR;
+}
+
+// Fetch the compiled chunk for the source (fills result on error); obf may be NULL
+static CompiledScript* compileBuffer(const char* src, size_t len, const ObfOptions* options,
+                                     ObfContext* obf, ObfResult* result) {
+    int useCache = !(options && (options->options & OBF_OPT_NO_CACHE));
+    CompiledScript* script = AcquireCompiledScript(src, len, useCache, obf,
+                                                   result->errorMsg, sizeof(result->errorMsg));
+    if (!script) fail(result, result->errorMsg);
+    return script;
+}
+
+// Shared by ObfuscateBuffer and ObfuscatePooled (pool may be NULL)
+static int obfuscate(const char* src, size_t len, const ObfOptions* options, ObfResult* result,
+                     VariantPool* pool, const char* key, size_t keyLength) {
+    if (!result) return OBF_ERROR;
+    memset(result, 0, sizeof(ObfResult));
+
+    if (!src) return fail(result, "No source given");
+
+    const char* watermark = options ? options->watermark : NULL;
+    size_t watermarkLen = watermark ? options->watermarkLength : 0;
+    unsigned long long seed = options ? options->seed : 0;
+
+    if (watermarkLen > 0xFFFF) return fail(result, "Watermark too long");
+
+    // Everything random or counted for this job lives here, so calls never share state
+    ObfContext* obf = CreateObfContext(seed);
+    if (!obf) return fail(result, "Out of memory");
+    if (options && options->timeoutMs) {
+        obf->deadline = MonotonicMs() + options->timeoutMs;
+    }
+    obf->cancel = options ? options->cancel : NULL;
+
+    // Compile and generate also check the context inside their loops and
+    // come back empty-handed once the job is stopped
+    CompiledScript* script = NULL;
+    char* output = NULL;
+    if (abandoned(obf, result) == OBF_OK) {
+        script = compileBuffer(src, len, options, obf, result);
+    }
+
+    if (script && abandoned(obf, result) == OBF_OK) {
+        // A pooled build only needs its watermark patched in
+        ScriptParts* ready = pool ? TakePooledVariant(pool, key, keyLength, script) : NULL;
+        if (ready) {
+            output = AssembleScript(ready, watermark, watermarkLen);
+            result->seed = ready->seed;
+            FreeScriptParts(ready);
+        } else {
+            output = GenerateObfuscatedScript(script->chunk, watermark, watermarkLen, obf);
+            result->seed = obf->seed;
+        }
+        result->constantCount = script->chunk->ConstantCount;
+        result->instructionCount = script->chunk->Count;
+    }
+    ReleaseCompiledScript(script);
+
+    if (abandoned(obf, result) != OBF_OK) {
+        free(output);
+        output = NULL;
+    }
+    FreeObfContext(obf);
+
+    if (result->status != OBF_OK) return result->status;
+    if (!output) return fail(result, "Script generation failed");
+
+    result->output = output;
+    result->outputLength = strlen(output);
+    return OBF_OK;
+}
+
+int ObfuscateBuffer(const char* src, size_t len, const ObfOptions* options, ObfResult* result) {
+    return obfuscate(src, len, options, result, NULL, NULL, 0);
+}
+
+int ObfuscatePooled(VariantPool* pool, const char* key, size_t keyLength,
+                    const char* src, size_t len, const ObfOptions* options, ObfResult* result) {
+    if (!key || (options && options->seed)) pool = NULL;
+    return obfuscate(src, len, options, result, pool, key, keyLength);
+}
+
+int ObfuscateVariants(const char* src, size_t len, int count, const unsigned long long* seeds,
+                      const ObfOptions* options, ObfResult* results) {
+    if (!results || count <= 0) return OBF_ERROR;
+    memset(results, 0, count * sizeof(ObfResult));
+
+    const char* watermark = options ? options->watermark : NULL;
+    size_t watermarkLen = watermark ? options->watermarkLength : 0;
+
+    const char* error = NULL;
+    if (!src) error = "No source given";
+    else if (watermarkLen > 0xFFFF) error = "Watermark too long";
+
+    // Only carries the deadline and cancel flag; each variant draws from its own context
+    ObfContext* job = error ? NULL : CreateObfContext(1);
+    if (!error && !job) error = "Out of memory";
+    if (job) {
+        if (options && options->timeoutMs) {
+            job->deadline = MonotonicMs() + options->timeoutMs;
+        }
+        job->cancel = options ? options->cancel : NULL;
+    }
+
+    CompiledScript* script = error ? NULL : compileBuffer(src, len, options, job, &results[0]);
+    if (!error && !script) error = results[0].errorMsg;
+
+    unsigned long long* usedSeeds = (unsigned long long*)calloc(count, sizeof(unsigned long long));
+    char** outputs = script && usedSeeds
+        ? GenerateVariants(script->chunk, count, seeds, watermark, watermarkLen, job, usedSeeds)
+        : NULL;
+    if (script && !outputs) error = "Out of memory";
+
+    // A stopped job fails every variant the same way, even those that finished
+    ObfResult stopped;
+    memset(&stopped, 0, sizeof(ObfResult));
+    if (job) abandoned(job, &stopped);
+
+    int status = OBF_OK;
+    for (int i = 0; i < count; i++) {
+        ObfResult* result = &results[i];
+        if (stopped.status != OBF_OK) {
+            free(outputs ? outputs[i] : NULL);
+            *result = stopped;
+        } else if (error) {
+            fail(result, error);
+        } else if (!outputs[i]) {
+            fail(result, "Script generation failed");
+        } else {
+            result->output = outputs[i];
+            result->outputLength = strlen(outputs[i]);
+            result->constantCount = script->chunk->ConstantCount;
+            result->instructionCount = script->chunk->Count;
+            result->seed = usedSeeds[i];
+        }
+        if (result->status != OBF_OK) status = stopped.status != OBF_OK ? stopped.status : OBF_ERROR;
+    }
+
+    FreeObfContext(job);
+    free(usedSeeds);
+    free(outputs);
+    ReleaseCompiledScript(script);
+    return status;
+}
+
+void FreeObfResult(ObfResult* result) {
+    if (!result) return;
+    free(result->output);
+    result->output = NULL;
+    result->outputLength = 0;
+}
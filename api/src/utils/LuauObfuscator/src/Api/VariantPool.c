@@ -0,0 +1,201 @@
+#include <pthread.h>
+
+#include "../../include/Common.h"
+#include "../../include/Context.h"
+#include "../../include/VariantPool.h"
+
+// ============================================
+// VARIANT POOL
+// ============================================
+
+struct VariantPool {
+    pthread_mutex_t lock;
+    PoolSlot* slots;
+    int slotCount;
+    int highWater;              // Builds kept per script
+    int maxScripts;             // Least recently used scripts beyond this are dropped
+    unsigned long long tick;
+};
+
+VariantPool* CreateVariantPool(int highWater, int maxScripts) {
+    if (highWater <= 0) return NULL;
+
+    VariantPool* pool = (VariantPool*)calloc(1, sizeof(VariantPool));
+    if (!pool) return NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->highWater = highWater;
+    pool->maxScripts = maxScripts > 0 ? maxScripts : VARIANT_POOL_DEFAULT_SCRIPTS;
+    return pool;
+}
+
+// Caller holds the pool lock; builds go to *discard to be freed after unlocking
+static void dropBuilds(PoolSlot* slot, ScriptParts*** discard, int* discardCount) {
+    *discard = slot->ready;
+    *discardCount = slot->readyCount;
+    slot->ready = NULL;
+    slot->readyCount = 0;
+}
+
+static void freeBuilds(ScriptParts** builds, int count) {
+    for (int i = 0; i < count; i++) {
+        FreeScriptParts(builds[i]);
+    }
+    free(builds);
+}
+
+static void freeSlot(PoolSlot* slot) {
+    freeBuilds(slot->ready, slot->readyCount);
+    ReleaseCompiledScript(slot->script);
+    free(slot->key);
+    free(slot);
+}
+
+// Caller holds the pool lock. Unlinks the least recently used slot; it is
+// returned for freeing unless a refill still uses it.
+static PoolSlot* evictOldest(VariantPool* pool) {
+    PoolSlot** oldest = &pool->slots;
+    for (PoolSlot** link = &pool->slots; *link; link = &(*link)->next) {
+        if ((*link)->lastUse < (*oldest)->lastUse) oldest = link;
+    }
+
+    PoolSlot* victim = *oldest;
+    *oldest = victim->next;
+    pool->slotCount--;
+    victim->next = NULL;
+    victim->dropped = 1;
+    return victim->building == 0 ? victim : NULL;
+}
+
+ScriptParts* TakePooledVariant(VariantPool* pool, const char* key, size_t keyLength,
+                               CompiledScript* script) {
+    PoolSlot* slot = NULL;
+    PoolSlot* evicted = NULL;
+    CompiledScript* stale = NULL;
+    ScriptParts** discard = NULL;
+    int discardCount = 0;
+    ScriptParts* parts = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    for (slot = pool->slots; slot; slot = slot->next) {
+        if (slot->keyLength == keyLength && memcmp(slot->key, key, keyLength) == 0) break;
+    }
+
+    if (!slot) {
+        slot = (PoolSlot*)calloc(1, sizeof(PoolSlot));
+        if (slot) slot->ready = (ScriptParts**)calloc(pool->highWater, sizeof(ScriptParts*));
+        if (slot) slot->key = (char*)malloc(keyLength + 1);
+        if (!slot || !slot->ready || !slot->key) {
+            if (slot) {
+                free(slot->ready);
+                free(slot);
+            }
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        memcpy(slot->key, key, keyLength);
+        slot->key[keyLength] = '\0';
+        slot->keyLength = keyLength;
+        RetainCompiledScript(script);
+        slot->script = script;
+
+        if (pool->slotCount >= pool->maxScripts) evicted = evictOldest(pool);
+        slot->next = pool->slots;
+        pool->slots = slot;
+        pool->slotCount++;
+    } else if (slot->script != script) {
+        // Same content recompiled (cache eviction) keeps the builds
+        if (slot->script->hash != script->hash || slot->script->length != script->length) {
+            dropBuilds(slot, &discard, &discardCount);
+            slot->ready = (ScriptParts**)calloc(pool->highWater, sizeof(ScriptParts*));
+            slot->generation++;
+        }
+        stale = slot->script;
+        RetainCompiledScript(script);
+        slot->script = script;
+    }
+
+    if (slot->ready && slot->readyCount > 0) {
+        parts = slot->ready[--slot->readyCount];
+    }
+    slot->lastUse = ++pool->tick;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (evicted) freeSlot(evicted);
+    ReleaseCompiledScript(stale);
+    freeBuilds(discard, discardCount);
+    return parts;
+}
+
+int RefillVariantPool(VariantPool* pool) {
+    if (!pool) return 0;
+
+    // Top up the most depleted script first
+    pthread_mutex_lock(&pool->lock);
+    PoolSlot* slot = NULL;
+    int best = pool->highWater;
+    for (PoolSlot* s = pool->slots; s; s = s->next) {
+        int stocked = s->readyCount + s->building;
+        if (s->ready && stocked < best) {
+            best = stocked;
+            slot = s;
+        }
+    }
+    if (!slot) {
+        pthread_mutex_unlock(&pool->lock);
+        return 0;
+    }
+    slot->building++;
+    int generation = slot->generation;
+    CompiledScript* script = slot->script;
+    RetainCompiledScript(script);
+    pthread_mutex_unlock(&pool->lock);
+
+    ScriptParts* parts = NULL;
+    ObfContext* obf = CreateObfContext(0);
+    if (obf) {
+        parts = GenerateScriptParts(script->chunk, obf);
+        FreeObfContext(obf);
+    }
+
+    PoolSlot* orphan = NULL;
+    pthread_mutex_lock(&pool->lock);
+    slot->building--;
+    if (parts && !slot->dropped && slot->generation == generation && slot->ready &&
+        slot->readyCount < pool->highWater) {
+        slot->ready[slot->readyCount++] = parts;
+        parts = NULL;
+    }
+    if (slot->dropped && slot->building == 0) orphan = slot;
+    pthread_mutex_unlock(&pool->lock);
+
+    FreeScriptParts(parts);
+    if (orphan) freeSlot(orphan);
+    ReleaseCompiledScript(script);
+    return 1;
+}
+
+int VariantPoolDeficit(VariantPool* pool) {
+    if (!pool) return 0;
+
+    int missing = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (PoolSlot* s = pool->slots; s; s = s->next) {
+        int stocked = s->readyCount + s->building;
+        if (s->ready && stocked < pool->highWater) missing += pool->highWater - stocked;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return missing;
+}
+
+void FreeVariantPool(VariantPool* pool) {
+    if (!pool) return;
+
+    PoolSlot* slot = pool->slots;
+    while (slot) {
+        PoolSlot* next = slot->next;
+        freeSlot(slot);
+        slot = next;
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
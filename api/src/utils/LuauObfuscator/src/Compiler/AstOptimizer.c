@@ -0,0 +1,607 @@
+#include "../../include/AstOptimizer.h"
+#include "../../include/Intern.h"
+#include <math.h>
+#include <stdint.h>
+
+// Longest string a .. of literals is folded into; longer ones concatenate at run time
+#define MAX_FOLDED_STRING 4096
+
+typedef struct {
+    const char* name;       // Interned
+    ASTNode* value;         // Literal the local always holds, or NULL
+} ScopeEntry;
+
+typedef struct {
+    Parser* parser;
+
+    // Locals visible at the current point, innermost last
+    ScopeEntry* scope;
+    int scopeCount;
+    int scopeCapacity;
+
+    // Names that are the target of an assignment anywhere in the chunk (sorted)
+    const char** assigned;
+    int assignedCount;
+    int assignedCapacity;
+
+    const char* self;       // Interned "self", the implicit parameter of methods
+    int noLocals;           // Out of memory: stop treating locals as constants
+} Optimizer;
+
+// ============================================
+// ASSIGNED NAMES
+// ============================================
+
+static void addAssigned(Optimizer* opt, const char* name) {
+    if (opt->assignedCount == opt->assignedCapacity) {
+        int capacity = opt->assignedCapacity ? opt->assignedCapacity * 2 : 32;
+        const char** grown = (const char**)ArenaGrow(opt->parser->arena, (void*)opt->assigned,
+            sizeof(const char*) * opt->assignedCapacity, sizeof(const char*) * capacity);
+        if (!grown) {
+            opt->noLocals = 1;
+            return;
+        }
+        opt->assigned = grown;
+        opt->assignedCapacity = capacity;
+    }
+    opt->assigned[opt->assignedCount++] = name;
+}
+
+static void collectAssigned(Optimizer* opt, ASTNode* node);
+
+static void collectList(Optimizer* opt, NodeList* list) {
+    for (int i = 0; i < list->count; i++) {
+        collectAssigned(opt, list->items[i]);
+    }
+}
+
+// Records every name written by an assignment or a `function name()` statement.
+// Shadowing is ignored: a local sharing its name with any assigned variable is
+// simply never treated as constant.
+static void collectAssigned(Optimizer* opt, ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_CHUNK:
+        case NODE_BLOCK:
+            collectList(opt, &node->data.block.statements);
+            break;
+        case NODE_LOCAL:
+            collectList(opt, &node->data.local.values);
+            break;
+        case NODE_ASSIGN:
+            for (int i = 0; i < node->data.assign.targets.count; i++) {
+                ASTNode* target = node->data.assign.targets.items[i];
+                if (target && target->type == NODE_NAME) {
+                    addAssigned(opt, target->data.string);
+                } else {
+                    collectAssigned(opt, target);
+                }
+            }
+            collectList(opt, &node->data.assign.values);
+            break;
+        case NODE_IF:
+            collectAssigned(opt, node->data.ifstmt.condition);
+            collectAssigned(opt, node->data.ifstmt.thenBlock);
+            collectList(opt, &node->data.ifstmt.elseifs);
+            collectAssigned(opt, node->data.ifstmt.elseBlock);
+            break;
+        case NODE_WHILE:
+        case NODE_REPEAT:
+            collectAssigned(opt, node->data.whilestmt.condition);
+            collectAssigned(opt, node->data.whilestmt.body);
+            break;
+        case NODE_FOR_NUM:
+            collectAssigned(opt, node->data.fornum.start);
+            collectAssigned(opt, node->data.fornum.limit);
+            collectAssigned(opt, node->data.fornum.step);
+            collectAssigned(opt, node->data.fornum.body);
+            break;
+        case NODE_FOR_IN:
+            collectList(opt, &node->data.forin.iterators);
+            collectAssigned(opt, node->data.forin.body);
+            break;
+        case NODE_FUNCTION:
+            if (node->data.func.name) addAssigned(opt, node->data.func.name);
+            collectAssigned(opt, node->data.func.body);
+            break;
+        case NODE_LOCAL_FUNCTION:
+            collectAssigned(opt, node->data.func.body);
+            break;
+        case NODE_RETURN:
+            collectList(opt, &node->data.ret.values);
+            break;
+        case NODE_CALL:
+            collectAssigned(opt, node->data.call.func);
+            collectList(opt, &node->data.call.args);
+            break;
+        case NODE_METHOD_CALL:
+            collectAssigned(opt, node->data.methodcall.object);
+            collectList(opt, &node->data.methodcall.args);
+            break;
+        case NODE_INDEX:
+            collectAssigned(opt, node->data.index.object);
+            collectAssigned(opt, node->data.index.key);
+            break;
+        case NODE_DOT_INDEX:
+            collectAssigned(opt, node->data.dotindex.object);
+            break;
+        case NODE_BINOP:
+            collectAssigned(opt, node->data.binop.left);
+            collectAssigned(opt, node->data.binop.right);
+            break;
+        case NODE_UNOP:
+            collectAssigned(opt, node->data.unop.operand);
+            break;
+        case NODE_TABLE:
+            collectList(opt, &node->data.table.fields);
+            break;
+        case NODE_TABLE_FIELD:
+            collectAssigned(opt, node->data.field.key);
+            collectAssigned(opt, node->data.field.value);
+            break;
+        default:
+            break;
+    }
+}
+
+static int comparePointers(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t)*(const char* const*)a;
+    uintptr_t y = (uintptr_t)*(const char* const*)b;
+    return (x > y) - (x < y);
+}
+
+static int isAssigned(Optimizer* opt, const char* name) {
+    if (opt->assignedCount == 0) return 0;
+    return bsearch(&name, opt->assigned, opt->assignedCount, sizeof(const char*), comparePointers) != NULL;
+}
+
+// ============================================
+// SCOPE
+// ============================================
+
+static void declare(Optimizer* opt, const char* name, ASTNode* value) {
+    if (opt->scopeCount == opt->scopeCapacity) {
+        int capacity = opt->scopeCapacity ? opt->scopeCapacity * 2 : 64;
+        ScopeEntry* grown = (ScopeEntry*)ArenaGrow(opt->parser->arena, opt->scope,
+            sizeof(ScopeEntry) * opt->scopeCapacity, sizeof(ScopeEntry) * capacity);
+        if (!grown) {
+            // A lost declaration could let an outer constant leak past it
+            opt->noLocals = 1;
+            return;
+        }
+        opt->scope = grown;
+        opt->scopeCapacity = capacity;
+    }
+
+    if (value && isAssigned(opt, name)) value = NULL;
+    opt->scope[opt->scopeCount].name = name;
+    opt->scope[opt->scopeCount].value = value;
+    opt->scopeCount++;
+}
+
+// Literal a name always reads as, or NULL
+static ASTNode* constantValue(Optimizer* opt, const char* name) {
+    if (opt->noLocals) return NULL;
+    for (int i = opt->scopeCount - 1; i >= 0; i--) {
+        if (opt->scope[i].name == name) return opt->scope[i].value;
+    }
+    return NULL;    // Global
+}
+
+// ============================================
+// EXPRESSIONS
+// ============================================
+
+static int isLiteral(const ASTNode* node) {
+    return node->type == NODE_NUMBER || node->type == NODE_STRING ||
+           node->type == NODE_BOOL || node->type == NODE_NIL;
+}
+
+static int isTruthy(const ASTNode* node) {
+    return node->type != NODE_NIL && !(node->type == NODE_BOOL && !node->data.boolean);
+}
+
+// Literals are kept as written, so text with escapes is left for the runtime
+static int hasEscapes(const char* str) {
+    return strchr(str, '\\') != NULL;
+}
+
+// Calls and ... lose their extra values when wrapped in and/or
+static int isMultiValue(const ASTNode* node) {
+    return node->type == NODE_CALL || node->type == NODE_METHOD_CALL || node->type == NODE_VARARG;
+}
+
+static void makeNumber(ASTNode* node, double value) {
+    node->type = NODE_NUMBER;
+    node->data.number = value;
+}
+
+static void makeBool(ASTNode* node, int value) {
+    node->type = NODE_BOOL;
+    node->data.boolean = value;
+}
+
+static int foldArithmetic(const char* op, double a, double b, double* out) {
+    double result;
+    switch (op[0]) {
+        case '+': result = a + b; break;
+        case '-': result = a - b; break;
+        case '*': result = a * b; break;
+        case '/':
+            if (b == 0) return 0;
+            result = a / b;
+            break;
+        case '%':
+            if (b == 0) return 0;
+            result = a - floor(a / b) * b;
+            break;
+        case '^': result = pow(a, b); break;
+        default: return 0;
+    }
+
+    if (!isfinite(result)) return 0;
+    *out = result;
+    return 1;
+}
+
+// Text of a .. operand; numbers only where every runtime prints them alike
+static const char* concatText(const ASTNode* node, char* buf, size_t size) {
+    if (node->type == NODE_STRING) {
+        return hasEscapes(node->data.string) ? NULL : node->data.string;
+    }
+    if (node->type == NODE_NUMBER) {
+        double value = node->data.number;
+        if (value != floor(value) || fabs(value) >= 1e14 || (value == 0 && signbit(value))) return NULL;
+        snprintf(buf, size, "%.0f", value);
+        return buf;
+    }
+    return NULL;
+}
+
+static int foldConcat(Optimizer* opt, ASTNode* node, ASTNode* left, ASTNode* right) {
+    char leftBuf[32], rightBuf[32];
+    const char* a = concatText(left, leftBuf, sizeof(leftBuf));
+    const char* b = concatText(right, rightBuf, sizeof(rightBuf));
+    if (!a || !b) return 0;
+
+    size_t lenA = strlen(a), lenB = strlen(b);
+    if (lenA + lenB > MAX_FOLDED_STRING) return 0;
+
+    char* joined = (char*)malloc(lenA + lenB + 1);
+    if (!joined) return 0;
+    memcpy(joined, a, lenA);
+    memcpy(joined + lenA, b, lenB);
+    const char* interned = InternString(opt->parser->strings, joined, (int)(lenA + lenB));
+    free(joined);
+    if (!interned) return 0;
+
+    node->type = NODE_STRING;
+    node->data.string = interned;
+    return 1;
+}
+
+static int foldEquality(const ASTNode* a, const ASTNode* b, int* equal) {
+    if (a->type != b->type) {
+        *equal = 0;
+        return 1;
+    }
+
+    switch (a->type) {
+        case NODE_NIL: *equal = 1; return 1;
+        case NODE_BOOL: *equal = a->data.boolean == b->data.boolean; return 1;
+        case NODE_NUMBER: *equal = a->data.number == b->data.number; return 1;
+        case NODE_STRING:
+            // Interned, so equal text is the same pointer
+            if (a->data.string == b->data.string) {
+                *equal = 1;
+                return 1;
+            }
+            if (hasEscapes(a->data.string) || hasEscapes(b->data.string)) return 0;
+            *equal = 0;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void foldBinop(Optimizer* opt, ASTNode* node) {
+    const char* op = node->data.binop.op;
+    ASTNode* left = node->data.binop.left;
+    ASTNode* right = node->data.binop.right;
+
+    // A constant left operand decides and/or on its own
+    if (strcmp(op, "and") == 0 || strcmp(op, "or") == 0) {
+        if (!isLiteral(left)) return;
+        int takeLeft = (op[0] == 'a') ? !isTruthy(left) : isTruthy(left);
+        if (takeLeft) {
+            *node = *left;
+        } else if (!isMultiValue(right)) {
+            *node = *right;
+        }
+        return;
+    }
+
+    if (!isLiteral(left) || !isLiteral(right)) return;
+
+    if (strcmp(op, "..") == 0) {
+        foldConcat(opt, node, left, right);
+        return;
+    }
+
+    if (strcmp(op, "==") == 0 || strcmp(op, "~=") == 0) {
+        int equal;
+        if (foldEquality(left, right, &equal)) makeBool(node, op[0] == '=' ? equal : !equal);
+        return;
+    }
+
+    // Everything else only folds on numbers (strings would need runtime coercion)
+    if (left->type != NODE_NUMBER || right->type != NODE_NUMBER) return;
+    double a = left->data.number, b = right->data.number;
+
+    if (strcmp(op, "<") == 0) makeBool(node, a < b);
+    else if (strcmp(op, "<=") == 0) makeBool(node, a <= b);
+    else if (strcmp(op, ">") == 0) makeBool(node, a > b);
+    else if (strcmp(op, ">=") == 0) makeBool(node, a >= b);
+    else {
+        double result;
+        if (foldArithmetic(op, a, b, &result)) makeNumber(node, result);
+    }
+}
+
+static void foldUnop(ASTNode* node) {
+    const char* op = node->data.unop.op;
+    ASTNode* operand = node->data.unop.operand;
+
+    if (strcmp(op, "not") == 0) {
+        if (isLiteral(operand)) makeBool(node, !isTruthy(operand));
+    } else if (strcmp(op, "-") == 0) {
+        if (operand->type == NODE_NUMBER) makeNumber(node, -operand->data.number);
+    } else if (strcmp(op, "#") == 0) {
+        if (operand->type == NODE_STRING && !hasEscapes(operand->data.string)) {
+            makeNumber(node, (double)strlen(operand->data.string));
+        }
+    }
+}
+
+static void foldExpression(Optimizer* opt, ASTNode* node);
+static void foldStatements(Optimizer* opt, ASTNode* block);
+static void foldBlock(Optimizer* opt, ASTNode* block);
+
+static void foldList(Optimizer* opt, NodeList* list) {
+    for (int i = 0; i < list->count; i++) {
+        foldExpression(opt, list->items[i]);
+    }
+}
+
+static void foldFunction(Optimizer* opt, ASTNode* node) {
+    int mark = opt->scopeCount;
+    if (node->data.func.name && strchr(node->data.func.name, ':')) {
+        declare(opt, opt->self, NULL);
+    }
+    for (int i = 0; i < node->data.func.params.count; i++) {
+        declare(opt, node->data.func.params.items[i]->data.string, NULL);
+    }
+    foldBlock(opt, node->data.func.body);
+    opt->scopeCount = mark;
+}
+
+static void foldExpression(Optimizer* opt, ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_NAME: {
+            ASTNode* value = constantValue(opt, node->data.string);
+            if (value) {
+                node->type = value->type;
+                node->data = value->data;
+            }
+            break;
+        }
+        case NODE_BINOP:
+            foldExpression(opt, node->data.binop.left);
+            foldExpression(opt, node->data.binop.right);
+            foldBinop(opt, node);
+            break;
+        case NODE_UNOP:
+            foldExpression(opt, node->data.unop.operand);
+            foldUnop(node);
+            break;
+        case NODE_CALL:
+            foldExpression(opt, node->data.call.func);
+            foldList(opt, &node->data.call.args);
+            break;
+        case NODE_METHOD_CALL:
+            foldExpression(opt, node->data.methodcall.object);
+            foldList(opt, &node->data.methodcall.args);
+            break;
+        case NODE_INDEX:
+            foldExpression(opt, node->data.index.object);
+            foldExpression(opt, node->data.index.key);
+            break;
+        case NODE_DOT_INDEX:
+            foldExpression(opt, node->data.dotindex.object);
+            break;
+        case NODE_TABLE:
+            foldList(opt, &node->data.table.fields);
+            break;
+        case NODE_TABLE_FIELD:
+            foldExpression(opt, node->data.field.key);
+            foldExpression(opt, node->data.field.value);
+            break;
+        case NODE_FUNCTION:
+            foldFunction(opt, node);
+            break;
+        default:
+            break;
+    }
+}
+
+// ============================================
+// STATEMENTS
+// ============================================
+
+// Keeps the arm of an if that can run; returns the statement to compile in its
+// place (a block when the arm is known), or NULL when nothing runs
+static ASTNode* foldIf(Optimizer* opt, ASTNode* node) {
+    NodeList* elseifs = &node->data.ifstmt.elseifs;
+    int next = 0;
+
+    // Constant leading conditions: take that arm, or promote the next one
+    for (;;) {
+        foldExpression(opt, node->data.ifstmt.condition);
+        ASTNode* cond = node->data.ifstmt.condition;
+        if (!isLiteral(cond)) break;
+
+        if (isTruthy(cond)) {
+            foldBlock(opt, node->data.ifstmt.thenBlock);
+            return node->data.ifstmt.thenBlock;
+        }
+        if (next < elseifs->count) {
+            ASTNode* arm = elseifs->items[next++];
+            node->data.ifstmt.condition = arm->data.ifstmt.condition;
+            node->data.ifstmt.thenBlock = arm->data.ifstmt.thenBlock;
+            continue;
+        }
+        foldBlock(opt, node->data.ifstmt.elseBlock);
+        return node->data.ifstmt.elseBlock;
+    }
+
+    foldBlock(opt, node->data.ifstmt.thenBlock);
+
+    // A false elseif never runs; a true one is the else and ends the chain
+    int kept = 0;
+    for (int i = next; i < elseifs->count; i++) {
+        ASTNode* arm = elseifs->items[i];
+        foldExpression(opt, arm->data.ifstmt.condition);
+        ASTNode* cond = arm->data.ifstmt.condition;
+
+        if (isLiteral(cond)) {
+            if (isTruthy(cond)) {
+                node->data.ifstmt.elseBlock = arm->data.ifstmt.thenBlock;
+                break;
+            }
+            continue;
+        }
+        foldBlock(opt, arm->data.ifstmt.thenBlock);
+        elseifs->items[kept++] = arm;
+    }
+    elseifs->count = kept;
+
+    foldBlock(opt, node->data.ifstmt.elseBlock);
+    return node;
+}
+
+// Returns the statement to compile in node's place, or NULL to drop it
+static ASTNode* foldStatement(Optimizer* opt, ASTNode* node) {
+    if (!node) return NULL;
+
+    switch (node->type) {
+        case NODE_LOCAL: {
+            NodeList* values = &node->data.local.values;
+            foldList(opt, values);
+            for (int i = 0; i < node->data.local.names.count; i++) {
+                ASTNode* value = i < values->count ? values->items[i] : NULL;
+                declare(opt, node->data.local.names.items[i]->data.string,
+                        value && isLiteral(value) ? value : NULL);
+            }
+            break;
+        }
+        case NODE_ASSIGN:
+            // Assigned names are never constant, so targets fold like expressions
+            foldList(opt, &node->data.assign.targets);
+            foldList(opt, &node->data.assign.values);
+            break;
+        case NODE_IF:
+            return foldIf(opt, node);
+        case NODE_WHILE:
+            foldExpression(opt, node->data.whilestmt.condition);
+            if (isLiteral(node->data.whilestmt.condition) && !isTruthy(node->data.whilestmt.condition)) {
+                return NULL;
+            }
+            foldBlock(opt, node->data.whilestmt.body);
+            break;
+        case NODE_REPEAT: {
+            // until still sees the body's locals
+            int mark = opt->scopeCount;
+            foldStatements(opt, node->data.whilestmt.body);
+            foldExpression(opt, node->data.whilestmt.condition);
+            opt->scopeCount = mark;
+            break;
+        }
+        case NODE_FOR_NUM: {
+            foldExpression(opt, node->data.fornum.start);
+            foldExpression(opt, node->data.fornum.limit);
+            foldExpression(opt, node->data.fornum.step);
+            int mark = opt->scopeCount;
+            declare(opt, node->data.fornum.var, NULL);
+            foldBlock(opt, node->data.fornum.body);
+            opt->scopeCount = mark;
+            break;
+        }
+        case NODE_FOR_IN: {
+            foldList(opt, &node->data.forin.iterators);
+            int mark = opt->scopeCount;
+            for (int i = 0; i < node->data.forin.names.count; i++) {
+                declare(opt, node->data.forin.names.items[i]->data.string, NULL);
+            }
+            foldBlock(opt, node->data.forin.body);
+            opt->scopeCount = mark;
+            break;
+        }
+        case NODE_LOCAL_FUNCTION:
+            declare(opt, node->data.func.name, NULL);
+            foldFunction(opt, node);
+            break;
+        case NODE_FUNCTION:
+            foldFunction(opt, node);
+            break;
+        case NODE_RETURN:
+            foldList(opt, &node->data.ret.values);
+            break;
+        case NODE_CALL:
+        case NODE_METHOD_CALL:
+            foldExpression(opt, node);
+            break;
+        case NODE_BLOCK:
+            foldBlock(opt, node);
+            break;
+        default:
+            break;
+    }
+    return node;
+}
+
+// Leaves the block's locals declared for the caller to drop
+static void foldStatements(Optimizer* opt, ASTNode* block) {
+    if (!block) return;
+
+    NodeList* statements = &block->data.block.statements;
+    int kept = 0;
+    for (int i = 0; i < statements->count; i++) {
+        ASTNode* statement = foldStatement(opt, statements->items[i]);
+        if (statement) statements->items[kept++] = statement;
+    }
+    statements->count = kept;
+}
+
+static void foldBlock(Optimizer* opt, ASTNode* block) {
+    int mark = opt->scopeCount;
+    foldStatements(opt, block);
+    opt->scopeCount = mark;
+}
+
+void OptimizeAst(ASTNode* root, Parser* parser) {
+    if (!root || !parser) return;
+
+    Optimizer opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.parser = parser;
+    opt.self = InternString(parser->strings, "self", 4);
+    if (!opt.self) opt.noLocals = 1;
+
+    collectAssigned(&opt, root);
+    if (opt.assignedCount > 0) qsort(opt.assigned, opt.assignedCount, sizeof(const char*), comparePointers);
+
+    foldBlock(&opt, root);
+}
@@ -6,7 +6,15 @@ BytecodeChunk* CreateChunk() {
     chunk->Capacity = 32;
     chunk->Instructions = (Instruction*)malloc(sizeof(Instruction) * chunk->Capacity);
     chunk->ConstantCount = 0;
-    chunk->Constants = (char**)malloc(sizeof(char*) * 32); 
+    chunk->ConstantCapacity = 32;
+    chunk->Constants = (Constant*)malloc(sizeof(Constant) * chunk->ConstantCapacity);
+    chunk->ParamCount = 0;
+    chunk->MaxStack = 0;
+    chunk->Upvalues = NULL;
+    chunk->UpvalueCount = 0;
+    chunk->Children = NULL;
+    chunk->ChildCount = 0;
+    chunk->ChildCapacity = 0;
     return chunk;
 }
 
@@ -22,16 +30,193 @@ void AddInstruction(BytecodeChunk* chunk, OpCode op, int a, int b, int c) {
     chunk->Count++;
 }
 
-void AddConstant(BytecodeChunk* chunk, const char* str) {
-    chunk->Constants[chunk->ConstantCount] = strdup(str);
-    chunk->ConstantCount++;
+int AddChild(BytecodeChunk* chunk, BytecodeChunk* child) {
+    if (chunk->ChildCount >= chunk->ChildCapacity) {
+        chunk->ChildCapacity = chunk->ChildCapacity ? chunk->ChildCapacity * 2 : 4;
+        chunk->Children = (BytecodeChunk**)realloc(chunk->Children, sizeof(BytecodeChunk*) * chunk->ChildCapacity);
+    }
+    chunk->Children[chunk->ChildCount] = child;
+    return chunk->ChildCount++;
+}
+
+static Constant* pushConstant(BytecodeChunk* chunk, ConstantType type) {
+    if (chunk->ConstantCount >= chunk->ConstantCapacity) {
+        chunk->ConstantCapacity *= 2;
+        chunk->Constants = (Constant*)realloc(chunk->Constants, sizeof(Constant) * chunk->ConstantCapacity);
+    }
+    Constant* k = &chunk->Constants[chunk->ConstantCount++];
+    memset(k, 0, sizeof(Constant));
+    k->Type = type;
+    return k;
+}
+
+void AddStringConstant(BytecodeChunk* chunk, const char* str, int length) {
+    Constant* k = pushConstant(chunk, CONST_STRING);
+    k->String = (char*)malloc(length + 1);
+    memcpy(k->String, str, length);
+    k->String[length] = '\0';
+    k->Length = length;
+}
+
+void AddNumberConstant(BytecodeChunk* chunk, double value) {
+    pushConstant(chunk, CONST_NUMBER)->Number = value;
+}
+
+int VarintSize(unsigned int value) {
+    int size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+int WriteVarint(unsigned char* out, unsigned int value) {
+    int pos = 0;
+    while (value >= 0x80) {
+        out[pos++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[pos++] = (unsigned char)value;
+    return pos;
+}
+
+int ReadVarint(const unsigned char* data, int length, int* pos, unsigned int* value) {
+    unsigned int result = 0;
+    for (int shift = 0; shift < 35 && *pos < length; shift += 7) {
+        unsigned char byte = data[(*pos)++];
+        result |= (unsigned int)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Signed B operands (jump offsets) map 0,-1,1,-2.. to 0,1,2,3..
+static unsigned int zigzag(int value) {
+    return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+}
+
+// Integral values in int32 range take the short form (-0 keeps its sign bit)
+static int isInt32(double value) {
+    return value >= -2147483648.0 && value <= 2147483647.0 && value == (double)(int)value &&
+           !(value == 0 && 1 / value < 0);
+}
+
+int ConstantSize(const Constant* k) {
+    switch (k->Type) {
+        case CONST_NUMBER: return isInt32(k->Number) ? 5 : 9;
+        case CONST_STRING: return 1 + VarintSize(k->Length) + k->Length;
+        default: return 1;
+    }
+}
+
+int WriteConstant(unsigned char* out, const Constant* k) {
+    switch (k->Type) {
+        case CONST_NIL:
+            out[0] = KTAG_NIL;
+            return 1;
+        case CONST_BOOL:
+            out[0] = k->Boolean ? KTAG_TRUE : KTAG_FALSE;
+            return 1;
+        case CONST_NUMBER: {
+            if (isInt32(k->Number)) {
+                unsigned int v = (unsigned int)(int)k->Number;
+                out[0] = KTAG_INT;
+                for (int i = 0; i < 4; i++) out[1 + i] = (unsigned char)(v >> (8 * i));
+                return 5;
+            }
+            unsigned long long bits;
+            memcpy(&bits, &k->Number, sizeof(bits));
+            out[0] = KTAG_DOUBLE;
+            for (int i = 0; i < 8; i++) out[1 + i] = (unsigned char)(bits >> (8 * i));
+            return 9;
+        }
+        case CONST_STRING: {
+            out[0] = KTAG_STRING;
+            int pos = 1 + WriteVarint(out + 1, (unsigned int)k->Length);
+            memcpy(out + pos, k->String, k->Length);
+            return pos + k->Length;
+        }
+    }
+    return 0;
+}
+
+int InstructionSize(const Instruction* ins) {
+    return 1 + VarintSize((unsigned int)ins->A) + VarintSize(zigzag(ins->B)) +
+           VarintSize((unsigned int)ins->C);
+}
+
+int WriteInstruction(unsigned char* out, int op, const Instruction* ins) {
+    int pos = 0;
+    out[pos++] = (unsigned char)op;
+    pos += WriteVarint(out + pos, (unsigned int)ins->A);
+    pos += WriteVarint(out + pos, zigzag(ins->B));
+    pos += WriteVarint(out + pos, (unsigned int)ins->C);
+    return pos;
+}
+
+int PrototypeSize(const BytecodeChunk* chunk) {
+    int size = VarintSize(chunk->ConstantCount);
+    for (int i = 0; i < chunk->ConstantCount; i++) {
+        size += ConstantSize(&chunk->Constants[i]);
+    }
+    size += VarintSize(chunk->ParamCount);
+    size += VarintSize(chunk->MaxStack);
+    size += VarintSize(chunk->UpvalueCount);
+    for (int i = 0; i < chunk->UpvalueCount; i++) {
+        size += 1 + VarintSize(chunk->Upvalues[i].Index);
+    }
+    size += VarintSize(chunk->Count);
+    for (int i = 0; i < chunk->Count; i++) {
+        size += InstructionSize(&chunk->Instructions[i]);
+    }
+    size += VarintSize(chunk->ChildCount);
+    for (int i = 0; i < chunk->ChildCount; i++) {
+        size += PrototypeSize(chunk->Children[i]);
+    }
+    return size;
+}
+
+int WritePrototype(unsigned char* out, const BytecodeChunk* chunk, const int* opcodeMap,
+                   int* constantsEnd) {
+    int pos = WriteVarint(out, (unsigned int)chunk->ConstantCount);
+    for (int i = 0; i < chunk->ConstantCount; i++) {
+        pos += WriteConstant(out + pos, &chunk->Constants[i]);
+    }
+    if (constantsEnd) *constantsEnd = pos;
+    
+    pos += WriteVarint(out + pos, (unsigned int)chunk->ParamCount);
+    pos += WriteVarint(out + pos, (unsigned int)chunk->MaxStack);
+    pos += WriteVarint(out + pos, (unsigned int)chunk->UpvalueCount);
+    for (int i = 0; i < chunk->UpvalueCount; i++) {
+        out[pos++] = (unsigned char)chunk->Upvalues[i].IsLocal;
+        pos += WriteVarint(out + pos, (unsigned int)chunk->Upvalues[i].Index);
+    }
+    
+    pos += WriteVarint(out + pos, (unsigned int)chunk->Count);
+    for (int i = 0; i < chunk->Count; i++) {
+        const Instruction* ins = &chunk->Instructions[i];
+        pos += WriteInstruction(out + pos, opcodeMap ? opcodeMap[ins->Op] : (int)ins->Op, ins);
+    }
+    
+    pos += WriteVarint(out + pos, (unsigned int)chunk->ChildCount);
+    for (int i = 0; i < chunk->ChildCount; i++) {
+        pos += WritePrototype(out + pos, chunk->Children[i], opcodeMap, NULL);
+    }
+    return pos;
 }
 
 void FreeChunk(BytecodeChunk* chunk) {
     if (chunk) {
         free(chunk->Instructions);
-        for(int i=0; i<chunk->ConstantCount; i++) free(chunk->Constants[i]);
+        for(int i=0; i<chunk->ConstantCount; i++) free(chunk->Constants[i].String);
         free(chunk->Constants);
+        free(chunk->Upvalues);
+        for(int i=0; i<chunk->ChildCount; i++) FreeChunk(chunk->Children[i]);
+        free(chunk->Children);
         free(chunk);
     }
 }
@@ -1,14 +1,14 @@
 #include "../../include/Compiler.h"
+#include "../../include/AstOptimizer.h"
+#include "../../include/Peephole.h"
+#include "../../include/RegAlloc.h"
 #include "../../include/Utils.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 static void compileNode(CompilerState* state, ASTNode* node);
-static void compileExpression(CompilerState* state, ASTNode* node);
 static void compileStatement(CompilerState* state, ASTNode* node);
-static void astToLua(ASTNode* node, char* buf, int bufSize, int* pos);
-static int funcCounter = 0;
 
 static Compiler* currentCompiler(CompilerState* state) {
     return state->current;
@@ -18,31 +18,103 @@ static BytecodeChunk* currentChunk(CompilerState* state) {
     return state->current->chunk;
 }
 
-static void emitByte(CompilerState* state, int byte) {
-    // We'll encode as instruction with just opcode
-}
-
 static int emitInstruction(CompilerState* state, OpCode op, int a, int b, int c) {
     AddInstruction(currentChunk(state), op, a, b, c);
     return currentChunk(state)->Count - 1;
 }
 
-static int addConstant(CompilerState* state, const char* value) {
-    BytecodeChunk* chunk = currentChunk(state);
-    // Check if constant already exists
-    for (int i = 0; i < chunk->ConstantCount; i++) {
-        if (strcmp(chunk->Constants[i], value) == 0) {
-            return i;
+static const char* intern(CompilerState* state, const char* str) {
+    return InternString(state->parser->strings, str, (int)strlen(str));
+}
+
+// ConstantSlot.type
+#define CONSTANT_KEY_STRING 1
+#define CONSTANT_KEY_NUMBER 2
+
+static unsigned int hashConstantKey(int type, const unsigned char* key, int length) {
+    unsigned int hash = 2166136261u ^ (unsigned int)type;
+    for (int i = 0; i < length; i++) {
+        hash ^= key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static ConstantSlot* findConstantSlot(ConstantSlot* slots, int capacity, int type,
+                                      const unsigned char* key, int length, unsigned int hash) {
+    int mask = capacity - 1;
+    for (int i = hash & mask; ; i = (i + 1) & mask) {
+        ConstantSlot* slot = &slots[i];
+        if (!slot->type) return slot;
+        if (slot->hash == hash && slot->type == type && slot->length == length &&
+            memcmp(slot->key, key, length) == 0) {
+            return slot;
+        }
+    }
+}
+
+static void growConstantSlots(CompilerState* state, Compiler* compiler) {
+    int capacity = compiler->constantSlotCapacity == 0 ? 64 : compiler->constantSlotCapacity * 2;
+    ConstantSlot* slots = (ConstantSlot*)ArenaAlloc(state->parser->arena, sizeof(ConstantSlot) * capacity);
+    
+    for (int i = 0; i < compiler->constantSlotCapacity; i++) {
+        ConstantSlot* old = &compiler->constantSlots[i];
+        if (old->type) {
+            *findConstantSlot(slots, capacity, old->type, old->key, old->length, old->hash) = *old;
         }
     }
-    AddConstant(chunk, value);
-    return chunk->ConstantCount - 1;
+    compiler->constantSlots = slots;
+    compiler->constantSlotCapacity = capacity;
+}
+
+// Index of the constant with this (type, key), appending value if it is new
+static int internConstant(CompilerState* state, int type, const void* key, int length,
+                          const Constant* value) {
+    Compiler* compiler = currentCompiler(state);
+    BytecodeChunk* chunk = currentChunk(state);
+    
+    if ((compiler->constantSlotCount + 1) * 2 > compiler->constantSlotCapacity) {
+        growConstantSlots(state, compiler);
+    }
+    
+    unsigned int hash = hashConstantKey(type, (const unsigned char*)key, length);
+    ConstantSlot* slot = findConstantSlot(compiler->constantSlots, compiler->constantSlotCapacity,
+                                          type, (const unsigned char*)key, length, hash);
+    if (slot->type) return slot->index;
+    
+    if (value->Type == CONST_NUMBER) AddNumberConstant(chunk, value->Number);
+    else AddStringConstant(chunk, value->String, value->Length);
+    slot->type = type;
+    slot->hash = hash;
+    slot->length = length;
+    memcpy(slot->key, key, length);
+    slot->index = chunk->ConstantCount - 1;
+    compiler->constantSlotCount++;
+    return slot->index;
 }
 
+// value must be interned (AST strings are)
+static int addConstant(CompilerState* state, const char* value) {
+    Constant k = { CONST_STRING, 0, 0, (char*)value, (int)strlen(value) };
+    return internConstant(state, CONSTANT_KEY_STRING, &value, sizeof(value), &k);
+}
+
+// Keyed by the double's bits, so 1 and "1" stay distinct constants
 static int addNumberConstant(CompilerState* state, double value) {
-    char buf[64];
-    snprintf(buf, 64, "%.17g", value);
-    return addConstant(state, buf);
+    Constant k = { CONST_NUMBER, 0, value, NULL, 0 };
+    return internConstant(state, CONSTANT_KEY_NUMBER, &value, sizeof(value), &k);
+}
+
+// 1 once the job behind this compile is cancelled or out of time (also on
+// any earlier error); compilation unwinds from the next check
+static int abandoned(CompilerState* state) {
+    if (state->hadError) return 1;
+    int why = ContextState(state->obf);
+    if (why == CONTEXT_RUNNING) return 0;
+    state->hadError = 1;
+    snprintf(state->errorMsg, 256, "%s",
+             why == CONTEXT_CANCELLED ? "Job cancelled" : "Job deadline exceeded");
+    return 1;
 }
 
 static void initCompiler(CompilerState* state, Compiler* compiler) {
@@ -56,18 +128,60 @@ static void initCompiler(CompilerState* state, Compiler* compiler) {
     compiler->breakJumps = NULL;
     compiler->breakCount = 0;
     compiler->breakCapacity = 0;
+    compiler->loopLocals = -1;
+    compiler->constantSlots = NULL;
+    compiler->constantSlotCount = 0;
+    compiler->constantSlotCapacity = 0;
     state->current = compiler;
 }
 
 static int resolveLocal(Compiler* compiler, const char* name) {
     for (int i = compiler->localCount - 1; i >= 0; i--) {
-        if (strcmp(compiler->locals[i].name, name) == 0) {
+        if (compiler->locals[i].name == name) {
             return compiler->locals[i].slot;
         }
     }
     return -1;
 }
 
+static int addUpvalue(CompilerState* state, Compiler* compiler, const char* name, int index, int isLocal) {
+    for (int i = 0; i < compiler->upvalueCount; i++) {
+        Upvalue* upvalue = &compiler->upvalues[i];
+        if (upvalue->index == index && upvalue->isLocal == isLocal) return i;
+    }
+    
+    if (compiler->upvalueCount >= MAX_UPVALUES) {
+        state->hadError = 1;
+        snprintf(state->errorMsg, 256, "Too many upvalues");
+        return 0;
+    }
+    
+    Upvalue* upvalue = &compiler->upvalues[compiler->upvalueCount];
+    upvalue->name = name;
+    upvalue->index = index;
+    upvalue->isLocal = isLocal;
+    return compiler->upvalueCount++;
+}
+
+// Upvalue index of name in compiler, capturing it from the enclosing
+// functions on first use; -1 if it is a global
+static int resolveUpvalue(CompilerState* state, Compiler* compiler, const char* name) {
+    if (compiler->enclosing == NULL) return -1;
+    
+    int local = resolveLocal(compiler->enclosing, name);
+    if (local != -1) {
+        compiler->enclosing->locals[local].captured = 1;
+        return addUpvalue(state, compiler, name, local, 1);
+    }
+    
+    int upvalue = resolveUpvalue(state, compiler->enclosing, name);
+    if (upvalue != -1) {
+        return addUpvalue(state, compiler, name, upvalue, 0);
+    }
+    return -1;
+}
+
+// name must be interned
 static int addLocal(CompilerState* state, const char* name) {
     Compiler* compiler = currentCompiler(state);
     if (compiler->localCount >= MAX_LOCALS) {
@@ -77,9 +191,10 @@ static int addLocal(CompilerState* state, const char* name) {
     }
     
     Local* local = &compiler->locals[compiler->localCount++];
-    local->name = strdup(name);
+    local->name = name;
     local->depth = compiler->scopeDepth;
     local->slot = compiler->localCount - 1;
+    local->captured = 0;
     
     // Keep stackTop in sync with locals
     if (compiler->stackTop < compiler->localCount) {
@@ -100,15 +215,25 @@ static void endScope(CompilerState* state) {
     Compiler* compiler = currentCompiler(state);
     compiler->scopeDepth--;
     
+    // Closures keep captured locals alive; detach them before the slots are reused
+    int close = -1;
     while (compiler->localCount > 0 && 
            compiler->locals[compiler->localCount - 1].depth > compiler->scopeDepth) {
-        free(compiler->locals[compiler->localCount - 1].name);
         compiler->localCount--;
+        if (compiler->locals[compiler->localCount].captured) close = compiler->localCount;
+    }
+    if (close >= 0) {
+        emitInstruction(state, OP_CLOSE, close, 0, 0);
     }
 }
 
 static int allocReg(CompilerState* state) {
     Compiler* compiler = currentCompiler(state);
+    if (compiler->stackTop >= RK_CONSTANT && !state->hadError) {
+        // Higher registers would read as constants in RK operands
+        state->hadError = 1;
+        snprintf(state->errorMsg, 256, "Expression needs too many registers");
+    }
     int reg = compiler->stackTop++;
     if (compiler->stackTop > compiler->maxStack) {
         compiler->maxStack = compiler->stackTop;
@@ -138,58 +263,160 @@ static void compileNil(CompilerState* state, ASTNode* node, int reg) {
     emitInstruction(state, OP_LOADNIL, reg, 0, 0);
 }
 
-static void compileName(CompilerState* state, ASTNode* node, int reg) {
-    const char* name = node->data.string;
+static void loadName(CompilerState* state, const char* name, int reg) {
     int local = resolveLocal(currentCompiler(state), name);
     
     if (local != -1) {
         if (local != reg) {
             emitInstruction(state, OP_MOVE, reg, local, 0);
         }
+        return;
+    }
+    
+    int upvalue = resolveUpvalue(state, currentCompiler(state), name);
+    if (upvalue != -1) {
+        emitInstruction(state, OP_GETUPVAL, reg, upvalue, 0);
     } else {
         int constIdx = addConstant(state, name);
         emitInstruction(state, OP_GETGLOBAL, reg, constIdx, 0);
     }
 }
 
+static void storeName(CompilerState* state, const char* name, int reg) {
+    int local = resolveLocal(currentCompiler(state), name);
+    if (local != -1) {
+        if (local != reg) {
+            emitInstruction(state, OP_MOVE, local, reg, 0);
+        }
+        return;
+    }
+    
+    int upvalue = resolveUpvalue(state, currentCompiler(state), name);
+    if (upvalue != -1) {
+        emitInstruction(state, OP_SETUPVAL, reg, upvalue, 0);
+    } else {
+        int constIdx = addConstant(state, name);
+        emitInstruction(state, OP_SETGLOBAL, reg, constIdx, 0);
+    }
+}
+
+static void compileName(CompilerState* state, ASTNode* node, int reg) {
+    loadName(state, node->data.string, reg);
+}
+
 static void compileExpressionToReg(CompilerState* state, ASTNode* node, int reg);
+static void compileClosure(CompilerState* state, ASTNode* node, int reg, int isMethod);
+
+// Reserve registers up to and including reg, so temporaries land above it
+static void reserveTo(CompilerState* state, int reg) {
+    while (currentCompiler(state)->stackTop <= reg) allocReg(state);
+}
+
+// RK operand for node: literals and locals are read in place, anything else
+// is computed into a fresh temporary (counted in *temps for the caller to free)
+static int compileRK(CompilerState* state, ASTNode* node, int* temps) {
+    if (node->type == NODE_NUMBER) {
+        return addNumberConstant(state, node->data.number) + RK_CONSTANT;
+    }
+    if (node->type == NODE_STRING) {
+        return addConstant(state, node->data.string) + RK_CONSTANT;
+    }
+    if (node->type == NODE_NAME) {
+        int local = resolveLocal(currentCompiler(state), node->data.string);
+        if (local != -1) return local;
+    }
+    
+    int reg = allocReg(state);
+    (*temps)++;
+    compileExpressionToReg(state, node, reg);
+    return reg;
+}
+
+static void freeRegs(CompilerState* state, int count) {
+    while (count-- > 0) freeReg(state);
+}
+
+// Calls and ... give every value they have unless wrapped in parentheses
+static int isMultiValue(ASTNode* node) {
+    return !node->parenthesized &&
+           (node->type == NODE_CALL || node->type == NODE_METHOD_CALL || node->type == NODE_VARARG);
+}
+
+static void compileMulti(CompilerState* state, ASTNode* node, int reg, int results);
+
+// Evaluates list into consecutive registers from base. Exactly want values
+// are left there (nil padded; extra expressions still run); with MULTRET the
+// last call or ... keeps all its values, and 1 is returned when it did so and
+// set the top of the frame instead of a fixed count.
+static int compileList(CompilerState* state, NodeList* list, int base, int want) {
+    int count = list->count;
+    for (int i = 0; i < count; i++) {
+        ASTNode* node = list->items[i];
+        reserveTo(state, base + i);
+        if (i == count - 1 && isMultiValue(node)) {
+            int results = want == MULTRET ? MULTRET : (want > i ? want - i : 0);
+            if (results > 1) reserveTo(state, base + i + results - 1);
+            compileMulti(state, node, base + i, results);
+            return results == MULTRET;
+        }
+        compileExpressionToReg(state, node, base + i);
+    }
+    if (want != MULTRET && count < want) {
+        reserveTo(state, base + want - 1);
+        emitInstruction(state, OP_LOADNIL, base + count, want - count - 1, 0);
+    }
+    return 0;
+}
 
-static void compileCall(CompilerState* state, ASTNode* node, int reg) {
+// results values land from reg up; MULTRET keeps them all and sets the top
+static void compileCall(CompilerState* state, ASTNode* node, int reg, int results) {
+    int top = currentCompiler(state)->stackTop;
+    
     // Compile function
     compileExpressionToReg(state, node->data.call.func, reg);
     
-    // Compile arguments
+    // Arguments follow it; B = 0 passes everything up to the top
     int argCount = node->data.call.args.count;
-    for (int i = 0; i < argCount; i++) {
-        compileExpressionToReg(state, node->data.call.args.items[i], reg + 1 + i);
-    }
+    int open = compileList(state, &node->data.call.args, reg + 1, MULTRET);
+    currentCompiler(state)->stackTop = top;
     
     // Call: A = base, B = arg count + 1, C = return count + 1
-    emitInstruction(state, OP_CALL, reg, argCount + 1, 2);
+    emitInstruction(state, OP_CALL, reg, open ? 0 : argCount + 1, results + 1);
 }
 
-static void compileMethodCall(CompilerState* state, ASTNode* node, int reg) {
+static void compileMethodCall(CompilerState* state, ASTNode* node, int reg, int results) {
+    int top = currentCompiler(state)->stackTop;
+    
     // Compile object
     compileExpressionToReg(state, node->data.methodcall.object, reg);
     
     // SELF instruction: A[A+1] = A[B], A = A
     int methodIdx = addConstant(state, node->data.methodcall.method);
-    emitInstruction(state, OP_SELF, reg, reg, methodIdx | 0x100); // Mark as constant
+    emitInstruction(state, OP_SELF, reg, reg, methodIdx + RK_CONSTANT); // Mark as constant
     
     // Compile arguments (after self)
     int argCount = node->data.methodcall.args.count;
-    for (int i = 0; i < argCount; i++) {
-        compileExpressionToReg(state, node->data.methodcall.args.items[i], reg + 2 + i);
-    }
+    int open = compileList(state, &node->data.methodcall.args, reg + 2, MULTRET);
+    currentCompiler(state)->stackTop = top;
     
     // Call with self as first arg
-    emitInstruction(state, OP_CALL, reg, argCount + 2, 2);
+    emitInstruction(state, OP_CALL, reg, open ? 0 : argCount + 2, results + 1);
+}
+
+static void compileMulti(CompilerState* state, ASTNode* node, int reg, int results) {
+    switch (node->type) {
+        case NODE_CALL: compileCall(state, node, reg, results); break;
+        case NODE_METHOD_CALL: compileMethodCall(state, node, reg, results); break;
+        default:
+            if (results != 0) emitInstruction(state, OP_VARARG, reg, results + 1, 0);
+            break;
+    }
 }
 
 static void compileDotIndex(CompilerState* state, ASTNode* node, int reg) {
     compileExpressionToReg(state, node->data.dotindex.object, reg);
     int fieldIdx = addConstant(state, node->data.dotindex.field);
-    emitInstruction(state, OP_GETTABLE, reg, reg, fieldIdx | 0x100); // Constant flag
+    emitInstruction(state, OP_GETTABLE, reg, reg, fieldIdx + RK_CONSTANT); // Constant flag
 }
 
 static void compileIndex(CompilerState* state, ASTNode* node, int reg) {
@@ -201,75 +428,63 @@ static void compileIndex(CompilerState* state, ASTNode* node, int reg) {
 }
 
 static void compileTable(CompilerState* state, ASTNode* node, int reg) {
+    // List items are staged in the registers right above the table
+    if (currentCompiler(state)->stackTop > reg + 1) {
+        int tableReg = allocReg(state);
+        compileTable(state, node, tableReg);
+        emitInstruction(state, OP_MOVE, reg, tableReg, 0);
+        freeReg(state);
+        return;
+    }
+    
+    NodeList* fields = &node->data.table.fields;
     int arraySize = 0;
     int hashSize = 0;
-    
-    for (int i = 0; i < node->data.table.fields.count; i++) {
-        ASTNode* field = node->data.table.fields.items[i];
-        if (field->type == NODE_TABLE_FIELD) {
-            ASTNode* key = field->data.field.key;
-            if (key == NULL) {
-                arraySize++;
-            } else if (key->type == NODE_NUMBER) {
-                arraySize++;
-            } else {
-                hashSize++;
-            }
-        } else {
-            // Direct value (array element)
-            arraySize++;
-        }
+    for (int i = 0; i < fields->count; i++) {
+        if (fields->items[i]->data.field.key == NULL) arraySize++;
+        else hashSize++;
     }
     
     emitInstruction(state, OP_NEWTABLE, reg, arraySize, hashSize);
     
-    int arrayIdx = 1;
-    for (int i = 0; i < node->data.table.fields.count; i++) {
-        ASTNode* field = node->data.table.fields.items[i];
+    // SETLIST A B C stores B staged items at list indices (C - 1) * FIELDS_PER_FLUSH + 1 on
+    int top = currentCompiler(state)->stackTop;
+    int pending = 0;
+    int stored = 0;
+    for (int i = 0; i < fields->count; i++) {
+        ASTNode* key = fields->items[i]->data.field.key;
+        ASTNode* value = fields->items[i]->data.field.value;
         
-        if (field->type != NODE_TABLE_FIELD) {
-            // Direct value - array element
-            int valReg = allocReg(state);
-            compileExpressionToReg(state, field, valReg);
-            emitInstruction(state, OP_SETLIST, reg, 1, arrayIdx++);
-            freeReg(state);
+        if (key == NULL) {
+            reserveTo(state, reg + 1 + pending);
+            if (i == fields->count - 1 && isMultiValue(value)) {
+                // {..., f()} takes every value, up to the top
+                compileMulti(state, value, reg + 1 + pending, MULTRET);
+                emitInstruction(state, OP_SETLIST, reg, 0, stored / FIELDS_PER_FLUSH + 1);
+                pending = 0;
+                break;
+            }
+            compileExpressionToReg(state, value, reg + 1 + pending);
+            if (++pending == FIELDS_PER_FLUSH) {
+                emitInstruction(state, OP_SETLIST, reg, pending, stored / FIELDS_PER_FLUSH + 1);
+                stored += pending;
+                pending = 0;
+                currentCompiler(state)->stackTop = top;
+            }
             continue;
         }
         
-        ASTNode* key = field->data.field.key;
-        ASTNode* value = field->data.field.value;
-        
-        if (key == NULL) {
-            // Array element without explicit key
-            int valReg = allocReg(state);
-            compileExpressionToReg(state, value, valReg);
-            emitInstruction(state, OP_SETLIST, reg, 1, arrayIdx++);
-            freeReg(state);
-        } else if (key->type == NODE_NUMBER) {
-            // Numeric key
-            int valReg = allocReg(state);
-            compileExpressionToReg(state, value, valReg);
-            emitInstruction(state, OP_SETLIST, reg, 1, arrayIdx++);
-            freeReg(state);
-        } else if (key->type == NODE_STRING || key->type == NODE_NAME) {
-            // String/name key - hash element
-            int valReg = allocReg(state);
-            const char* keyStr = key->data.string;
-            int keyIdx = addConstant(state, keyStr);
-            compileExpressionToReg(state, value, valReg);
-            emitInstruction(state, OP_SETTABLE, reg, keyIdx | 0x100, valReg);
-            freeReg(state);
-        } else {
-            // Expression key
-            int keyReg = allocReg(state);
-            int valReg = allocReg(state);
-            compileExpressionToReg(state, key, keyReg);
-            compileExpressionToReg(state, value, valReg);
-            emitInstruction(state, OP_SETTABLE, reg, keyReg, valReg);
-            freeReg(state);
-            freeReg(state);
-        }
+        // Keyed field; temporaries go above the staged items
+        int temps = 0;
+        int keyReg = compileRK(state, key, &temps);
+        int valReg = compileRK(state, value, &temps);
+        emitInstruction(state, OP_SETTABLE, reg, keyReg, valReg);
+        freeRegs(state, temps);
     }
+    if (pending > 0) {
+        emitInstruction(state, OP_SETLIST, reg, pending, stored / FIELDS_PER_FLUSH + 1);
+    }
+    currentCompiler(state)->stackTop = top;
 }
 
 static void compileBinop(CompilerState* state, ASTNode* node, int reg) {
@@ -278,7 +493,7 @@ static void compileBinop(CompilerState* state, ASTNode* node, int reg) {
     // Short-circuit for and/or
     if (strcmp(op, "and") == 0 || strcmp(op, "or") == 0) {
         compileExpressionToReg(state, node->data.binop.left, reg);
-        int jumpIdx = emitInstruction(state, OP_TEST, reg, 0, strcmp(op, "or") == 0 ? 1 : 0);
+        emitInstruction(state, OP_TEST, reg, 0, strcmp(op, "or") == 0 ? 1 : 0);
         int jmpIdx = emitInstruction(state, OP_JMP, 0, 0, 0);
         compileExpressionToReg(state, node->data.binop.right, reg);
         // Patch jump
@@ -286,11 +501,10 @@ static void compileBinop(CompilerState* state, ASTNode* node, int reg) {
         return;
     }
     
-    // Allocate temp registers above current stack to avoid conflicts
-    int leftReg = allocReg(state);
-    int rightReg = allocReg(state);
-    compileExpressionToReg(state, node->data.binop.left, leftReg);
-    compileExpressionToReg(state, node->data.binop.right, rightReg);
+    // Constants and locals are used in place; other operands get temps above the stack
+    int temps = 0;
+    int leftReg = compileRK(state, node->data.binop.left, &temps);
+    int rightReg = compileRK(state, node->data.binop.right, &temps);
     
     OpCode opcode;
     if (strcmp(op, "+") == 0) opcode = OP_ADD;
@@ -309,19 +523,20 @@ static void compileBinop(CompilerState* state, ASTNode* node, int reg) {
     else {
         state->hadError = 1;
         snprintf(state->errorMsg, 256, "Unknown operator: %s", op);
-        freeReg(state);
+        freeRegs(state, temps);
         return;
     }
     
     // Handle comparison operators specially
     if (opcode == OP_EQ || opcode == OP_LT || opcode == OP_LE) {
-        int invert = (strcmp(op, "~=") == 0) ? 1 : 0;
+        // A=1: the JMP to LOADBOOL true runs when the comparison holds
+        int expect = (strcmp(op, "~=") == 0) ? 0 : 1;
         int swapped = (strcmp(op, ">") == 0 || strcmp(op, ">=") == 0);
         
         if (swapped) {
-            emitInstruction(state, opcode, invert, rightReg, leftReg);
+            emitInstruction(state, opcode, expect, rightReg, leftReg);
         } else {
-            emitInstruction(state, opcode, invert, leftReg, rightReg);
+            emitInstruction(state, opcode, expect, leftReg, rightReg);
         }
         emitInstruction(state, OP_JMP, 0, 1, 0);
         emitInstruction(state, OP_LOADBOOL, reg, 0, 1);
@@ -330,8 +545,7 @@ static void compileBinop(CompilerState* state, ASTNode* node, int reg) {
         emitInstruction(state, opcode, reg, leftReg, rightReg);
     }
     
-    freeReg(state);
-    freeReg(state);
+    freeRegs(state, temps);
 }
 
 static void compileUnop(CompilerState* state, ASTNode* node, int reg) {
@@ -354,35 +568,18 @@ static void compileExpressionToReg(CompilerState* state, ASTNode* node, int reg)
         case NODE_BOOL: compileBool(state, node, reg); break;
         case NODE_NIL: compileNil(state, node, reg); break;
         case NODE_NAME: compileName(state, node, reg); break;
-        case NODE_CALL: compileCall(state, node, reg); break;
-        case NODE_METHOD_CALL: compileMethodCall(state, node, reg); break;
+        case NODE_CALL: compileCall(state, node, reg, 1); break;
+        case NODE_METHOD_CALL: compileMethodCall(state, node, reg, 1); break;
         case NODE_DOT_INDEX: compileDotIndex(state, node, reg); break;
         case NODE_INDEX: compileIndex(state, node, reg); break;
         case NODE_TABLE: compileTable(state, node, reg); break;
         case NODE_BINOP: compileBinop(state, node, reg); break;
         case NODE_UNOP: compileUnop(state, node, reg); break;
-        case NODE_FUNCTION: {
-            // Anonymous function - use loadstring approach like local functions
-            char luaCode[4096];
-            int pos = 0;
-            
-            pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, "__lua__--[[%d]]function(", funcCounter++);
-            for (int i = 0; i < node->data.func.params.count; i++) {
-                if (i > 0) pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, ",");
-                ASTNode* param = node->data.func.params.items[i];
-                pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, "%s", param->data.string);
-            }
-            pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, ")");
-            
-            // Convert body to Lua
-            astToLua(node->data.func.body, luaCode, sizeof(luaCode), &pos);
-            
-            pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, " end");
-            
-            int constIdx = addConstant(state, luaCode);
-            emitInstruction(state, OP_CLOSURE, reg, constIdx, node->data.func.params.count);
+        case NODE_FUNCTION: compileClosure(state, node, reg, 0); break;
+        case NODE_VARARG:
+            // First extra argument only
+            emitInstruction(state, OP_VARARG, reg, 2, 0);
             break;
-        }
         default:
             state->hadError = 1;
             snprintf(state->errorMsg, 256, "Cannot compile expression type %d", node->type);
@@ -391,86 +588,54 @@ static void compileExpressionToReg(CompilerState* state, ASTNode* node, int reg)
 }
 
 static void compileLocal(CompilerState* state, ASTNode* node) {
+    Compiler* compiler = currentCompiler(state);
     int count = node->data.local.names.count;
-    int valueCount = node->data.local.values.count;
+    int top = compiler->stackTop;
     
-    // Allocate slots for locals
-    int firstSlot = currentCompiler(state)->localCount;
+    // Values land in the new slots before the names are visible: local x = x
+    int firstSlot = compiler->localCount;
+    compileList(state, &node->data.local.values, firstSlot, count);
+    compiler->stackTop = top;
     
     for (int i = 0; i < count; i++) {
         ASTNode* name = node->data.local.names.items[i];
         addLocal(state, name->data.string);
     }
-    
-    // Compile values
-    for (int i = 0; i < count; i++) {
-        int slot = firstSlot + i;
-        if (i < valueCount) {
-            compileExpressionToReg(state, node->data.local.values.items[i], slot);
-        } else {
-            emitInstruction(state, OP_LOADNIL, slot, 0, 0);
-        }
-    }
 }
 
 static void compileAssign(CompilerState* state, ASTNode* node) {
     int targetCount = node->data.assign.targets.count;
-    int valueCount = node->data.assign.values.count;
     
-    // Compile values to temp registers first
+    // Compile values to temp registers first, one per target
     int baseReg = currentCompiler(state)->stackTop;
-    for (int i = 0; i < valueCount; i++) {
-        int reg = allocReg(state);
-        compileExpressionToReg(state, node->data.assign.values.items[i], reg);
-    }
+    compileList(state, &node->data.assign.values, baseReg, targetCount);
     
     // Assign to targets
     for (int i = 0; i < targetCount; i++) {
         ASTNode* target = node->data.assign.targets.items[i];
-        int valueReg = (i < valueCount) ? baseReg + i : -1;
+        int valueReg = baseReg + i;
         
         if (target->type == NODE_NAME) {
-            const char* name = target->data.string;
-            int local = resolveLocal(currentCompiler(state), name);
-            
-            if (local != -1) {
-                if (valueReg >= 0) {
-                    emitInstruction(state, OP_MOVE, local, valueReg, 0);
-                } else {
-                    emitInstruction(state, OP_LOADNIL, local, 0, 0);
-                }
-            } else {
-                int constIdx = addConstant(state, name);
-                if (valueReg >= 0) {
-                    emitInstruction(state, OP_SETGLOBAL, valueReg, constIdx, 0);
-                } else {
-                    int nilReg = allocReg(state);
-                    emitInstruction(state, OP_LOADNIL, nilReg, 0, 0);
-                    emitInstruction(state, OP_SETGLOBAL, nilReg, constIdx, 0);
-                    freeReg(state);
-                }
-            }
+            storeName(state, target->data.string, valueReg);
         } else if (target->type == NODE_DOT_INDEX) {
             int objReg = allocReg(state);
             compileExpressionToReg(state, target->data.dotindex.object, objReg);
             int fieldIdx = addConstant(state, target->data.dotindex.field);
-            emitInstruction(state, OP_SETTABLE, objReg, fieldIdx | 0x100, valueReg >= 0 ? valueReg : objReg);
+            emitInstruction(state, OP_SETTABLE, objReg, fieldIdx + RK_CONSTANT, valueReg);
             freeReg(state);
         } else if (target->type == NODE_INDEX) {
             int objReg = allocReg(state);
             int keyReg = allocReg(state);
             compileExpressionToReg(state, target->data.index.object, objReg);
             compileExpressionToReg(state, target->data.index.key, keyReg);
-            emitInstruction(state, OP_SETTABLE, objReg, keyReg, valueReg >= 0 ? valueReg : objReg);
+            emitInstruction(state, OP_SETTABLE, objReg, keyReg, valueReg);
             freeReg(state);
             freeReg(state);
         }
     }
     
     // Free value registers
-    for (int i = 0; i < valueCount; i++) {
-        freeReg(state);
-    }
+    currentCompiler(state)->stackTop = baseReg;
 }
 
 static void compileIf(CompilerState* state, ASTNode* node) {
@@ -484,10 +649,9 @@ static void compileIf(CompilerState* state, ASTNode* node) {
             strcmp(op, ">") == 0 || strcmp(op, ">=") == 0 ||
             strcmp(op, "==") == 0 || strcmp(op, "~=") == 0) {
             
-            int leftReg = allocReg(state);
-            int rightReg = allocReg(state);
-            compileExpressionToReg(state, cond->data.binop.left, leftReg);
-            compileExpressionToReg(state, cond->data.binop.right, rightReg);
+            int temps = 0;
+            int leftReg = compileRK(state, cond->data.binop.left, &temps);
+            int rightReg = compileRK(state, cond->data.binop.right, &temps);
             
             OpCode opcode;
             int invert = 0;
@@ -509,8 +673,7 @@ static void compileIf(CompilerState* state, ASTNode* node) {
                 emitInstruction(state, opcode, invert, leftReg, rightReg);
             }
             
-            freeReg(state);
-            freeReg(state);
+            freeRegs(state, temps);
             
             thenJump = emitInstruction(state, OP_JMP, 0, 0, 0);
             goto compile_then;
@@ -535,10 +698,13 @@ compile_then:
     
     // Check if we have else/elseif
     int hasElse = (node->data.ifstmt.elseBlock != NULL) || (node->data.ifstmt.elseifs.count > 0);
-    int elseJump = -1;
+    
+    // Every branch that ran jumps past the rest of the chain
+    int* endJumps = (int*)ArenaAlloc(state->parser->arena, sizeof(int) * (node->data.ifstmt.elseifs.count + 1));
+    int endJumpCount = 0;
     
     if (hasElse) {
-        elseJump = emitInstruction(state, OP_JMP, 0, 0, 0);
+        endJumps[endJumpCount++] = emitInstruction(state, OP_JMP, 0, 0, 0);
     }
     
     // Patch then jump - jumps here if condition was false
@@ -559,14 +725,8 @@ compile_then:
         compileNode(state, elseif->data.ifstmt.thenBlock);
         endScope(state);
         
-        int nextJump = emitInstruction(state, OP_JMP, 0, 0, 0);
+        endJumps[endJumpCount++] = emitInstruction(state, OP_JMP, 0, 0, 0);
         currentChunk(state)->Instructions[elseifJump].B = currentChunk(state)->Count - elseifJump - 1;
-        
-        // Chain jumps to end
-        if (elseJump >= 0) {
-            currentChunk(state)->Instructions[elseJump].B = currentChunk(state)->Count - elseJump - 1;
-        }
-        elseJump = nextJump;
     }
     
     // Compile else block
@@ -576,13 +736,73 @@ compile_then:
         endScope(state);
     }
     
-    // Patch final jump
-    if (elseJump >= 0) {
-        currentChunk(state)->Instructions[elseJump].B = currentChunk(state)->Count - elseJump - 1;
+    // Patch the jumps to the end
+    for (int i = 0; i < endJumpCount; i++) {
+        currentChunk(state)->Instructions[endJumps[i]].B = currentChunk(state)->Count - endJumps[i] - 1;
+    }
+}
+
+// Detach captured loop variables (slots from first up) before the next iteration
+static void closeLoopLocals(CompilerState* state, int first) {
+    Compiler* compiler = currentCompiler(state);
+    for (int i = first; i < compiler->localCount; i++) {
+        if (compiler->locals[i].captured) {
+            emitInstruction(state, OP_CLOSE, i, 0, 0);
+            return;
+        }
+    }
+}
+
+// Saved by beginLoop and restored by endLoop, so loops nest
+typedef struct {
+    int firstBreak;
+    int enclosingLocals;
+} LoopScope;
+
+static void beginLoop(CompilerState* state, LoopScope* loop) {
+    Compiler* compiler = currentCompiler(state);
+    loop->firstBreak = compiler->breakCount;
+    loop->enclosingLocals = compiler->loopLocals;
+    compiler->loopLocals = compiler->localCount;
+}
+
+// Point the loop's breaks at the next instruction, its exit
+static void endLoop(CompilerState* state, LoopScope* loop) {
+    Compiler* compiler = currentCompiler(state);
+    BytecodeChunk* chunk = currentChunk(state);
+    for (int i = loop->firstBreak; i < compiler->breakCount; i++) {
+        int jump = compiler->breakJumps[i];
+        chunk->Instructions[jump].B = chunk->Count - jump - 1;
+    }
+    compiler->breakCount = loop->firstBreak;
+    compiler->loopLocals = loop->enclosingLocals;
+}
+
+static void compileBreak(CompilerState* state) {
+    Compiler* compiler = currentCompiler(state);
+    if (compiler->loopLocals < 0) {
+        state->hadError = 1;
+        snprintf(state->errorMsg, 256, "break outside a loop");
+        return;
+    }
+    // The scopes left by the jump never reach their own CLOSE
+    closeLoopLocals(state, compiler->loopLocals);
+    
+    if (compiler->breakCount >= compiler->breakCapacity) {
+        int capacity = compiler->breakCapacity == 0 ? 8 : compiler->breakCapacity * 2;
+        int* jumps = (int*)ArenaAlloc(state->parser->arena, sizeof(int) * capacity);
+        if (compiler->breakCount > 0) {
+            memcpy(jumps, compiler->breakJumps, sizeof(int) * compiler->breakCount);
+        }
+        compiler->breakJumps = jumps;
+        compiler->breakCapacity = capacity;
     }
+    compiler->breakJumps[compiler->breakCount++] = emitInstruction(state, OP_JMP, 0, 0, 0);
 }
 
 static void compileWhile(CompilerState* state, ASTNode* node) {
+    LoopScope loop;
+    beginLoop(state, &loop);
     int loopStart = currentChunk(state)->Count;
     
     ASTNode* cond = node->data.whilestmt.condition;
@@ -596,10 +816,9 @@ static void compileWhile(CompilerState* state, ASTNode* node) {
             strcmp(op, "==") == 0 || strcmp(op, "~=") == 0) {
             
             // Compile operands
-            int leftReg = allocReg(state);
-            int rightReg = allocReg(state);
-            compileExpressionToReg(state, cond->data.binop.left, leftReg);
-            compileExpressionToReg(state, cond->data.binop.right, rightReg);
+            int temps = 0;
+            int leftReg = compileRK(state, cond->data.binop.left, &temps);
+            int rightReg = compileRK(state, cond->data.binop.right, &temps);
             
             // Determine opcode and whether to swap/invert
             OpCode opcode;
@@ -628,8 +847,7 @@ static void compileWhile(CompilerState* state, ASTNode* node) {
                 emitInstruction(state, opcode, invert, leftReg, rightReg);
             }
             
-            freeReg(state);
-            freeReg(state);
+            freeRegs(state, temps);
             
             // Jump to exit if comparison failed
             exitJump = emitInstruction(state, OP_JMP, 0, 0, 0);
@@ -659,30 +877,60 @@ compile_body:
     
     // Patch exit jump
     currentChunk(state)->Instructions[exitJump].B = currentChunk(state)->Count - exitJump - 1;
+    endLoop(state, &loop);
+}
+
+static void compileRepeat(CompilerState* state, ASTNode* node) {
+    LoopScope loop;
+    beginLoop(state, &loop);
+    int loopStart = currentChunk(state)->Count;
+    
+    // until sees the body's locals, so both share one scope
+    beginScope(state);
+    compileNode(state, node->data.whilestmt.body);
+    int condReg = allocReg(state);
+    compileExpressionToReg(state, node->data.whilestmt.condition, condReg);
+    freeReg(state);
+    closeLoopLocals(state, currentCompiler(state)->loopLocals);
+    
+    // A true condition skips the jump back
+    emitInstruction(state, OP_TEST, condReg, 0, 0);
+    int loopJump = emitInstruction(state, OP_JMP, 0, 0, 0);
+    currentChunk(state)->Instructions[loopJump].B = loopStart - loopJump - 1;
+    endScope(state);
+    
+    endLoop(state, &loop);
 }
 
 static void compileForNum(CompilerState* state, ASTNode* node) {
+    LoopScope loop;
     beginScope(state);
+    beginLoop(state, &loop);
     
     // Internal loop variables
     int base = currentCompiler(state)->localCount;
-    addLocal(state, "(for index)");
-    addLocal(state, "(for limit)");
-    addLocal(state, "(for step)");
-    addLocal(state, node->data.fornum.var);
+    addLocal(state, intern(state, "(for index)"));
+    addLocal(state, intern(state, "(for limit)"));
+    addLocal(state, intern(state, "(for step)"));
     
     // Initialize loop variables
     compileExpressionToReg(state, node->data.fornum.start, base);
     compileExpressionToReg(state, node->data.fornum.limit, base + 1);
     compileExpressionToReg(state, node->data.fornum.step, base + 2);
     
+    // The loop variable is only in scope inside the body
+    addLocal(state, node->data.fornum.var);
+    
     // FORPREP - jumps to FORLOOP
     int prepIdx = emitInstruction(state, OP_FORPREP, base, 0, 0);
     
     int loopStart = currentChunk(state)->Count;
     
-    // Body
+    // Body, scoped so locals captured in it are fresh each iteration
+    beginScope(state);
     compileNode(state, node->data.fornum.body);
+    endScope(state);
+    closeLoopLocals(state, base + 3);
     
     // FORLOOP - jumps back to loopStart if continuing
     int loopIdx = emitInstruction(state, OP_FORLOOP, base, 0, 0);
@@ -692,18 +940,25 @@ static void compileForNum(CompilerState* state, ASTNode* node) {
     // FORLOOP jumps back to loopStart (body start)
     currentChunk(state)->Instructions[loopIdx].B = loopIdx - loopStart + 1;
     
+    endLoop(state, &loop);
     endScope(state);
 }
 
 static void compileForIn(CompilerState* state, ASTNode* node) {
+    LoopScope loop;
     beginScope(state);
+    beginLoop(state, &loop);
     
     int base = currentCompiler(state)->localCount;
     
     // Internal variables: iterator, state, control
-    addLocal(state, "(for generator)");
-    addLocal(state, "(for state)");
-    addLocal(state, "(for control)");
+    addLocal(state, intern(state, "(for generator)"));
+    addLocal(state, intern(state, "(for state)"));
+    addLocal(state, intern(state, "(for control)"));
+    
+    // Initialize iterator: in pairs(t) fills all three from one call
+    compileList(state, &node->data.forin.iterators, base, 3);
+    currentCompiler(state)->stackTop = base + 3;
     
     // User variables
     for (int i = 0; i < node->data.forin.names.count; i++) {
@@ -711,19 +966,17 @@ static void compileForIn(CompilerState* state, ASTNode* node) {
         addLocal(state, name->data.string);
     }
     
-    // Initialize iterator
-    for (int i = 0; i < node->data.forin.iterators.count && i < 3; i++) {
-        compileExpressionToReg(state, node->data.forin.iterators.items[i], base + i);
-    }
-    
     int loopStart = currentChunk(state)->Count;
     
-    // TFORLOOP
+    // TFORLOOP calls the iterator and skips the exit jump while it yields values
     emitInstruction(state, OP_TFORLOOP, base, 0, node->data.forin.names.count);
     int exitJump = emitInstruction(state, OP_JMP, 0, 0, 0);
     
     // Body
+    beginScope(state);
     compileNode(state, node->data.forin.body);
+    endScope(state);
+    closeLoopLocals(state, base + 3);
     
     // Jump back
     int backJump = emitInstruction(state, OP_JMP, 0, 0, 0);
@@ -732,6 +985,7 @@ static void compileForIn(CompilerState* state, ASTNode* node) {
     // Patch exit
     currentChunk(state)->Instructions[exitJump].B = currentChunk(state)->Count - exitJump - 1;
     
+    endLoop(state, &loop);
     endScope(state);
 }
 
@@ -739,265 +993,88 @@ static void compileReturn(CompilerState* state, ASTNode* node) {
     int count = node->data.ret.values.count;
     int base = currentCompiler(state)->stackTop;
     
-    for (int i = 0; i < count; i++) {
-        compileExpressionToReg(state, node->data.ret.values.items[i], base + i);
-    }
+    // B = 0 returns everything up to the top: return f(), return ...
+    int open = compileList(state, &node->data.ret.values, base, MULTRET);
+    currentCompiler(state)->stackTop = base;
     
-    emitInstruction(state, OP_RETURN, base, count + 1, 0);
+    emitInstruction(state, OP_RETURN, base, open ? 0 : count + 1, 0);
 }
 
-// Helper to generate Lua code from AST (simplified)
-static void astToLua(ASTNode* node, char* buf, int bufSize, int* pos);
-
-static void astExprToLua(ASTNode* node, char* buf, int bufSize, int* pos) {
-    if (!node || *pos >= bufSize - 100) return;
+// Compile a function body into a child prototype and load it into reg.
+// Methods (function a:b()) take self as an implicit first parameter.
+static void compileClosure(CompilerState* state, ASTNode* node, int reg, int isMethod) {
+    if (abandoned(state)) return;
+    Compiler compiler;
+    initCompiler(state, &compiler);
+    beginScope(state);
     
-    switch (node->type) {
-        case NODE_NUMBER:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "%.17g", node->data.number);
-            break;
-        case NODE_STRING:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "\"%s\"", node->data.string);
-            break;
-        case NODE_NAME:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "%s", node->data.string);
-            break;
-        case NODE_BOOL:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "%s", node->data.boolean ? "true" : "false");
-            break;
-        case NODE_NIL:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "nil");
-            break;
-        case NODE_BINOP:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "(");
-            astExprToLua(node->data.binop.left, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, "%s", node->data.binop.op);
-            astExprToLua(node->data.binop.right, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, ")");
-            break;
-        case NODE_UNOP:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "(%s", node->data.unop.op);
-            astExprToLua(node->data.unop.operand, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, ")");
-            break;
-        case NODE_CALL:
-            astExprToLua(node->data.call.func, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, "(");
-            for (int i = 0; i < node->data.call.args.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                astExprToLua(node->data.call.args.items[i], buf, bufSize, pos);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, ")");
-            break;
-        case NODE_METHOD_CALL:
-            astExprToLua(node->data.methodcall.object, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, ":%s(", node->data.methodcall.method);
-            for (int i = 0; i < node->data.methodcall.args.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                astExprToLua(node->data.methodcall.args.items[i], buf, bufSize, pos);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, ")");
-            break;
-        case NODE_DOT_INDEX:
-            astExprToLua(node->data.dotindex.object, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, ".%s", node->data.dotindex.field);
-            break;
-        case NODE_INDEX:
-            astExprToLua(node->data.index.object, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, "[");
-            astExprToLua(node->data.index.key, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, "]");
-            break;
-        case NODE_TABLE:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "{");
-            for (int i = 0; i < node->data.table.fields.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                ASTNode* f = node->data.table.fields.items[i];
-                if (f->type == NODE_TABLE_FIELD) {
-                    if (f->data.field.key) {
-                        *pos += snprintf(buf + *pos, bufSize - *pos, "[");
-                        astExprToLua(f->data.field.key, buf, bufSize, pos);
-                        *pos += snprintf(buf + *pos, bufSize - *pos, "]=");
-                    }
-                    astExprToLua(f->data.field.value, buf, bufSize, pos);
-                } else {
-                    astExprToLua(f, buf, bufSize, pos);
-                }
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, "}");
-            break;
-        case NODE_FUNCTION:
-            // Anonymous function / closure
-            *pos += snprintf(buf + *pos, bufSize - *pos, "function(");
-            for (int i = 0; i < node->data.func.params.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                *pos += snprintf(buf + *pos, bufSize - *pos, "%s", node->data.func.params.items[i]->data.string);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, ")");
-            astToLua(node->data.func.body, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, " end");
-            break;
-        default:
-            break;
+    if (isMethod) addLocal(state, intern(state, "self"));
+    for (int i = 0; i < node->data.func.params.count; i++) {
+        addLocal(state, node->data.func.params.items[i]->data.string);
     }
-}
-
-static void astToLua(ASTNode* node, char* buf, int bufSize, int* pos) {
-    if (!node || *pos >= bufSize - 100) return;
+    compiler.chunk->ParamCount = compiler.localCount;
     
-    switch (node->type) {
-        case NODE_BLOCK:
-            for (int i = 0; i < node->data.block.statements.count; i++) {
-                astToLua(node->data.block.statements.items[i], buf, bufSize, pos);
-            }
-            break;
-        case NODE_LOCAL: {
-            *pos += snprintf(buf + *pos, bufSize - *pos, "local ");
-            for (int i = 0; i < node->data.local.names.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                *pos += snprintf(buf + *pos, bufSize - *pos, "%s", node->data.local.names.items[i]->data.string);
-            }
-            if (node->data.local.values.count > 0) {
-                *pos += snprintf(buf + *pos, bufSize - *pos, "=");
-                for (int i = 0; i < node->data.local.values.count; i++) {
-                    if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                    astExprToLua(node->data.local.values.items[i], buf, bufSize, pos);
-                }
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, " ");
-            break;
-        }
-        case NODE_ASSIGN: {
-            for (int i = 0; i < node->data.assign.targets.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                astExprToLua(node->data.assign.targets.items[i], buf, bufSize, pos);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, "=");
-            for (int i = 0; i < node->data.assign.values.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                astExprToLua(node->data.assign.values.items[i], buf, bufSize, pos);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, " ");
-            break;
-        }
-        case NODE_IF: {
-            *pos += snprintf(buf + *pos, bufSize - *pos, "if ");
-            astExprToLua(node->data.ifstmt.condition, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, " then ");
-            astToLua(node->data.ifstmt.thenBlock, buf, bufSize, pos);
-            if (node->data.ifstmt.elseBlock) {
-                *pos += snprintf(buf + *pos, bufSize - *pos, " else ");
-                astToLua(node->data.ifstmt.elseBlock, buf, bufSize, pos);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, " end ");
-            break;
-        }
-        case NODE_WHILE: {
-            *pos += snprintf(buf + *pos, bufSize - *pos, "while ");
-            astExprToLua(node->data.whilestmt.condition, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, " do ");
-            astToLua(node->data.whilestmt.body, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, " end ");
-            break;
-        }
-        case NODE_FOR_NUM: {
-            *pos += snprintf(buf + *pos, bufSize - *pos, "for %s=", node->data.fornum.var);
-            astExprToLua(node->data.fornum.start, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-            astExprToLua(node->data.fornum.limit, buf, bufSize, pos);
-            if (node->data.fornum.step) {
-                *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                astExprToLua(node->data.fornum.step, buf, bufSize, pos);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, " do ");
-            astToLua(node->data.fornum.body, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, " end ");
-            break;
-        }
-        case NODE_FOR_IN: {
-            *pos += snprintf(buf + *pos, bufSize - *pos, "for ");
-            for (int i = 0; i < node->data.forin.names.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                *pos += snprintf(buf + *pos, bufSize - *pos, "%s", node->data.forin.names.items[i]->data.string);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, " in ");
-            for (int i = 0; i < node->data.forin.iterators.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                astExprToLua(node->data.forin.iterators.items[i], buf, bufSize, pos);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, " do ");
-            astToLua(node->data.forin.body, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, " end ");
-            break;
+    compileNode(state, node->data.func.body);
+    emitInstruction(state, OP_RETURN, 0, 1, 0);
+    
+    BytecodeChunk* chunk = compiler.chunk;
+    if (state->hadError) {
+        // Never attached to the parent, so nothing else frees it
+        state->current = compiler.enclosing;
+        FreeChunk(chunk);
+        return;
+    }
+    if (compiler.upvalueCount > 0) {
+        chunk->Upvalues = (UpvalueDesc*)malloc(sizeof(UpvalueDesc) * compiler.upvalueCount);
+        for (int i = 0; i < compiler.upvalueCount; i++) {
+            chunk->Upvalues[i].IsLocal = compiler.upvalues[i].isLocal;
+            chunk->Upvalues[i].Index = compiler.upvalues[i].index;
         }
-        case NODE_RETURN:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "return ");
-            for (int i = 0; i < node->data.ret.values.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                astExprToLua(node->data.ret.values.items[i], buf, bufSize, pos);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, " ");
-            break;
-        case NODE_BREAK:
-            *pos += snprintf(buf + *pos, bufSize - *pos, "break ");
-            break;
-        case NODE_CALL:
-        case NODE_METHOD_CALL:
-            // Expression statements
-            astExprToLua(node, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, " ");
-            break;
-        case NODE_LOCAL_FUNCTION:
-        case NODE_FUNCTION:
-            // Nested function definition
-            if (node->data.func.name) {
-                *pos += snprintf(buf + *pos, bufSize - *pos, "local function %s(", node->data.func.name);
-            } else {
-                *pos += snprintf(buf + *pos, bufSize - *pos, "local function(");
-            }
-            for (int i = 0; i < node->data.func.params.count; i++) {
-                if (i > 0) *pos += snprintf(buf + *pos, bufSize - *pos, ",");
-                *pos += snprintf(buf + *pos, bufSize - *pos, "%s", node->data.func.params.items[i]->data.string);
-            }
-            *pos += snprintf(buf + *pos, bufSize - *pos, ")");
-            astToLua(node->data.func.body, buf, bufSize, pos);
-            *pos += snprintf(buf + *pos, bufSize - *pos, " end ");
-            break;
-        default:
-            break;
+        chunk->UpvalueCount = compiler.upvalueCount;
     }
+    state->current = compiler.enclosing;
+    
+    int index = AddChild(currentChunk(state), chunk);
+    emitInstruction(state, OP_CLOSURE, reg, index, 0);
 }
 
 static void compileFunction(CompilerState* state, ASTNode* node) {
     const char* funcName = node->data.func.name;
-    int funcSlot = -1;
     
-    if (node->type == NODE_LOCAL_FUNCTION && funcName) {
-        funcSlot = addLocal(state, funcName);
+    if (node->type == NODE_LOCAL_FUNCTION) {
+        // Declared before the body so it can call itself
+        int slot = addLocal(state, funcName);
+        if (slot >= 0) compileClosure(state, node, slot, 0);
+        return;
     }
     
-    // Generate Lua code for the function with unique ID to prevent constant reuse
-    char luaCode[4096];
-    int pos = 0;
-    
-    // Add unique identifier comment to prevent constant deduplication
-    pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, "__lua__--[[%d]]function(", funcCounter++);
-    for (int i = 0; i < node->data.func.params.count; i++) {
-        if (i > 0) pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, ",");
-        ASTNode* param = node->data.func.params.items[i];
-        pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, "%s", param->data.string);
+    int reg = allocReg(state);
+    const char* sep = strpbrk(funcName, ".:");
+    if (!sep) {
+        compileClosure(state, node, reg, 0);
+        storeName(state, funcName, reg);
+        freeReg(state);
+        return;
     }
-    pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, ")");
-    
-    // Convert body to Lua
-    astToLua(node->data.func.body, luaCode, sizeof(luaCode), &pos);
-    
-    pos += snprintf(luaCode + pos, sizeof(luaCode) - pos, " end");
     
-    if (funcSlot >= 0) {
-        int constIdx = addConstant(state, luaCode);
-        emitInstruction(state, OP_CLOSURE, funcSlot, constIdx, node->data.func.params.count);
+    // function a.b.c() / a.b:c() stores into the table a.b
+    int objReg = allocReg(state);
+    loadName(state, InternString(state->parser->strings, funcName, (int)(sep - funcName)), objReg);
+    for (;;) {
+        const char* field = sep + 1;
+        const char* next = strpbrk(field, ".:");
+        int fieldIdx = addConstant(state, InternString(state->parser->strings, field,
+                                                       next ? (int)(next - field) : (int)strlen(field)));
+        if (!next) {
+            compileClosure(state, node, reg, *sep == ':');
+            emitInstruction(state, OP_SETTABLE, objReg, fieldIdx + RK_CONSTANT, reg);
+            break;
+        }
+        emitInstruction(state, OP_GETTABLE, objReg, objReg, fieldIdx + RK_CONSTANT);
+        sep = next;
     }
+    freeReg(state);
+    freeReg(state);
 }
 
 static void compileStatement(CompilerState* state, ASTNode* node) {
@@ -1014,6 +1091,9 @@ static void compileStatement(CompilerState* state, ASTNode* node) {
         case NODE_WHILE:
             compileWhile(state, node);
             break;
+        case NODE_REPEAT:
+            compileRepeat(state, node);
+            break;
         case NODE_FOR_NUM:
             compileForNum(state, node);
             break;
@@ -1024,17 +1104,23 @@ static void compileStatement(CompilerState* state, ASTNode* node) {
             compileReturn(state, node);
             break;
         case NODE_BREAK:
-            // TODO: Track break jumps
-            emitInstruction(state, OP_JMP, 0, 0, 0);
+            compileBreak(state);
             break;
         case NODE_FUNCTION:
         case NODE_LOCAL_FUNCTION:
             compileFunction(state, node);
             break;
+        case NODE_BLOCK:
+            // do ... end, or the arm the optimizer kept of a constant if
+            beginScope(state);
+            compileNode(state, node);
+            endScope(state);
+            break;
         case NODE_CALL:
         case NODE_METHOD_CALL: {
+            // Results are dropped: C = 1
             int reg = allocReg(state);
-            compileExpressionToReg(state, node, reg);
+            compileMulti(state, node, reg, 0);
             freeReg(state);
             break;
         }
@@ -1050,6 +1136,7 @@ static void compileNode(CompilerState* state, ASTNode* node) {
         case NODE_CHUNK:
         case NODE_BLOCK:
             for (int i = 0; i < node->data.block.statements.count; i++) {
+                if (abandoned(state)) return;
                 compileStatement(state, node->data.block.statements.items[i]);
             }
             break;
@@ -1059,9 +1146,11 @@ static void compileNode(CompilerState* state, ASTNode* node) {
     }
 }
 
-CompilerState* CreateCompilerState(const char* source) {
+CompilerState* CreateCompilerState(const char* source, int length, ObfContext* obf) {
     CompilerState* state = (CompilerState*)malloc(sizeof(CompilerState));
-    state->parser = CreateParser(source);
+    state->parser = CreateParser(source, length);
+    state->parser->job = obf;
+    state->obf = obf;
     state->current = NULL;
     state->hadError = 0;
     state->errorMsg[0] = '\0';
@@ -1081,10 +1170,12 @@ BytecodeChunk* Compile(CompilerState* state) {
     if (state->parser->hadError) {
         state->hadError = 1;
         strcpy(state->errorMsg, state->parser->errorMsg);
-        FreeAST(ast);
         return NULL;
     }
     
+    if (abandoned(state)) return NULL;
+    OptimizeAst(ast, state->parser);
+    
     Compiler mainCompiler;
     initCompiler(state, &mainCompiler);
     
@@ -1093,12 +1184,22 @@ BytecodeChunk* Compile(CompilerState* state) {
     // Add final return
     emitInstruction(state, OP_RETURN, 0, 1, 0);
     
-    FreeAST(ast);
-    
     if (state->hadError) {
         fprintf(stderr, "[COMPILER ERROR] %s\n", state->errorMsg);
+        FreeChunk(mainCompiler.chunk);
+        return NULL;
+    }
+    // Conditions fold while temporaries are still short-lived; the second
+    // peephole run drops the MOVEs allocation turned into MOVE A A
+    PeepholeOptimize(mainCompiler.chunk);
+    if (!abandoned(state)) AllocateRegisters(mainCompiler.chunk);
+    if (!abandoned(state)) PeepholeOptimize(mainCompiler.chunk);
+    if (abandoned(state)) {
+        FreeChunk(mainCompiler.chunk);
         return NULL;
     }
+    FuseSuperinstructions(mainCompiler.chunk);
     
+
     return mainCompiler.chunk;
 }
@@ -0,0 +1,450 @@
+#include "../../include/Peephole.h"
+
+#define MAX_ROUNDS 8        // Each removal can expose more (e.g. a JMP that now lands on the next op)
+#define MAX_SCAN 256        // Instructions followed when proving a register dead
+#define MAX_BRANCHES 8      // Nested branches followed by the same proof
+
+#define REG_READ  1
+#define REG_WRITE 2         // Always overwritten (conditional writes do not count)
+
+// ============================================
+// INSTRUCTION SHAPE
+// ============================================
+
+// Ops that may skip the instruction after them
+static int isSkip(const Instruction* ins) {
+    switch (ins->Op) {
+        case OP_EQ:
+        case OP_LT:
+        case OP_LE:
+        case OP_TEST:
+        case OP_TESTSET:
+        case OP_TFORLOOP:
+            return 1;
+        case OP_LOADBOOL:
+            return ins->C != 0;
+        default:
+            return 0;
+    }
+}
+
+// Index an explicit jump at pc lands on, or -1
+static int jumpTarget(const Instruction* ins, int pc) {
+    switch (ins->Op) {
+        case OP_JMP:
+        case OP_FORPREP:
+            return pc + 1 + ins->B;
+        case OP_FORLOOP:
+            return pc + 1 - ins->B;
+        default:
+            return -1;
+    }
+}
+
+static void setJumpTarget(Instruction* ins, int pc, int target) {
+    if (ins->Op == OP_FORLOOP) {
+        ins->B = pc + 1 - target;
+    } else {
+        ins->B = target - pc - 1;
+    }
+}
+
+static int inRange(int reg, int first, int last) {
+    return reg >= first && reg <= last;
+}
+
+static int readsRK(int operand, int reg) {
+    return operand < RK_CONSTANT && operand == reg;
+}
+
+// How ins touches reg (REG_* flags); reads happen before writes
+static int regAccess(const BytecodeChunk* chunk, const Instruction* ins, int reg) {
+    int a = ins->A, b = ins->B, c = ins->C;
+    int access = 0;
+
+    switch (ins->Op) {
+        case OP_MOVE:
+        case OP_UNM:
+        case OP_NOT:
+        case OP_LEN:
+            if (b == reg) access |= REG_READ;
+            if (a == reg) access |= REG_WRITE;
+            break;
+        case OP_LOADK:
+        case OP_LOADBOOL:
+        case OP_GETUPVAL:
+        case OP_GETGLOBAL:
+        case OP_NEWTABLE:
+            if (a == reg) access |= REG_WRITE;
+            break;
+        case OP_LOADNIL:
+            if (inRange(reg, a, a + b)) access |= REG_WRITE;
+            break;
+        case OP_GETTABLE:
+            if (b == reg || readsRK(c, reg)) access |= REG_READ;
+            if (a == reg) access |= REG_WRITE;
+            break;
+        case OP_SETGLOBAL:
+        case OP_SETUPVAL:
+        case OP_TEST:
+            if (a == reg) access |= REG_READ;
+            break;
+        case OP_SETTABLE:
+            if (a == reg || readsRK(b, reg) || readsRK(c, reg)) access |= REG_READ;
+            break;
+        case OP_SELF:
+            if (b == reg || readsRK(c, reg)) access |= REG_READ;
+            if (inRange(reg, a, a + 1)) access |= REG_WRITE;
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_POW:
+        case OP_CONCAT:
+            if (readsRK(b, reg) || readsRK(c, reg)) access |= REG_READ;
+            if (a == reg) access |= REG_WRITE;
+            break;
+        case OP_JMP:
+        case OP_FORPREP:
+            if (ins->Op == OP_FORPREP && inRange(reg, a, a + 2)) access |= REG_READ;
+            break;
+        case OP_EQ:
+        case OP_LT:
+        case OP_LE:
+            if (readsRK(b, reg) || readsRK(c, reg)) access |= REG_READ;
+            break;
+        case OP_TESTSET:
+            if (b == reg) access |= REG_READ;
+            break;
+        case OP_CALL:
+            // A count of 0 runs to the top: every register from A may be read,
+            // and how many results get written is unknown
+            if (b == 0 ? reg >= a : inRange(reg, a, a + b - 1)) access |= REG_READ;
+            if (c > 1 && inRange(reg, a, a + c - 2)) access |= REG_WRITE;
+            break;
+        case OP_RETURN:
+            if (b == 0 ? reg >= a : inRange(reg, a, a + b - 2)) access |= REG_READ;
+            break;
+        case OP_FORLOOP:
+            if (inRange(reg, a, a + 2)) access |= REG_READ;
+            break;
+        case OP_TFORLOOP:
+            if (inRange(reg, a, a + 2)) access |= REG_READ;
+            if (inRange(reg, a + 3, a + 2 + c)) access |= REG_WRITE;
+            break;
+        case OP_SETLIST:
+            if (b == 0 ? reg >= a : inRange(reg, a, a + b)) access |= REG_READ;
+            break;
+        case OP_CLOSE:
+            // Detaching copies the value out of the slot
+            if (reg >= a) access |= REG_READ;
+            break;
+        case OP_CLOSURE:
+            if (b >= 0 && b < chunk->ChildCount) {
+                const BytecodeChunk* child = chunk->Children[b];
+                for (int i = 0; i < child->UpvalueCount; i++) {
+                    if (child->Upvalues[i].IsLocal && child->Upvalues[i].Index == reg) access |= REG_READ;
+                }
+            }
+            if (a == reg) access |= REG_WRITE;
+            break;
+        case OP_VARARG:
+            if (b > 1 && inRange(reg, a, a + b - 2)) access |= REG_WRITE;
+            break;
+        default:
+            access |= REG_READ;     // TAILCALL and anything unknown
+            break;
+    }
+    return access;
+}
+
+// ============================================
+// DEAD REGISTER PROOF
+// ============================================
+
+// 1 when no path from pc reads reg before overwriting it. Gives up (0) on
+// long or deeply branching paths; captured registers never reach here.
+static int isDeadFrom(const BytecodeChunk* chunk, int pc, int reg, int branches) {
+    for (int steps = 0; steps < MAX_SCAN; steps++) {
+        if (pc < 0 || pc >= chunk->Count) return pc >= chunk->Count;
+
+        const Instruction* ins = &chunk->Instructions[pc];
+        int access = regAccess(chunk, ins, reg);
+        if (access & REG_READ) return 0;
+        if (access & REG_WRITE) return 1;
+
+        switch (ins->Op) {
+            case OP_RETURN:
+                return 1;
+            case OP_JMP:
+            case OP_FORPREP:
+                pc = jumpTarget(ins, pc);
+                continue;
+            case OP_FORLOOP:
+                if (branches >= MAX_BRANCHES) return 0;
+                if (!isDeadFrom(chunk, jumpTarget(ins, pc), reg, branches + 1)) return 0;
+                pc++;
+                continue;
+            default:
+                break;
+        }
+
+        if (isSkip(ins)) {
+            if (ins->Op == OP_LOADBOOL) {
+                pc += 2;
+                continue;
+            }
+            if (branches >= MAX_BRANCHES) return 0;
+            if (!isDeadFrom(chunk, pc + 2, reg, branches + 1)) return 0;
+        }
+        pc++;
+    }
+    return 0;
+}
+
+// ============================================
+// PASSES
+// ============================================
+
+// Point every JMP past the JMPs it lands on
+static void threadJumps(BytecodeChunk* chunk) {
+    Instruction* code = chunk->Instructions;
+    for (int pc = 0; pc < chunk->Count; pc++) {
+        if (code[pc].Op != OP_JMP) continue;
+
+        int target = jumpTarget(&code[pc], pc);
+        // A cycle (e.g. `while true do end`) just stops the walk
+        for (int hops = 0; hops < chunk->Count; hops++) {
+            if (target < 0 || target >= chunk->Count || code[target].Op != OP_JMP) break;
+            int next = jumpTarget(&code[target], target);
+            if (next == target) break;
+            target = next;
+        }
+        setJumpTarget(&code[pc], pc, target);
+    }
+}
+
+// Number of explicit jumps landing on each index (jumpsTo has Count + 1 entries)
+static void countJumpTargets(const BytecodeChunk* chunk, int* jumpsTo) {
+    for (int pc = 0; pc < chunk->Count; pc++) {
+        int target = jumpTarget(&chunk->Instructions[pc], pc);
+        if (target >= 0 && target <= chunk->Count) jumpsTo[target]++;
+    }
+}
+
+// CMP a B C; JMP 1; LOADBOOL r 0 1; LOADBOOL r 1 0; TEST r _ c; JMP L
+// -> CMP a' B C; JMP L, when nothing else enters the sequence and r is dead after it
+static int foldConditions(BytecodeChunk* chunk, const unsigned char* captured,
+                          const int* jumpsTo, unsigned char* removed) {
+    Instruction* code = chunk->Instructions;
+    int folded = 0;
+
+    for (int pc = 0; pc + 5 < chunk->Count; pc++) {
+        Instruction* cmp = &code[pc];
+        if (cmp->Op != OP_EQ && cmp->Op != OP_LT && cmp->Op != OP_LE) continue;
+        if (pc > 0 && isSkip(&code[pc - 1])) continue;
+
+        int reg = code[pc + 2].A;
+        if (code[pc + 1].Op != OP_JMP || code[pc + 1].B != 1) continue;
+        if (code[pc + 2].Op != OP_LOADBOOL || code[pc + 2].B != 0 || code[pc + 2].C == 0) continue;
+        if (code[pc + 3].Op != OP_LOADBOOL || code[pc + 3].A != reg ||
+            code[pc + 3].B == 0 || code[pc + 3].C != 0) continue;
+        if (code[pc + 4].Op != OP_TEST || code[pc + 4].A != reg) continue;
+        if (code[pc + 5].Op != OP_JMP) continue;
+
+        if (jumpsTo[pc + 2] || jumpsTo[pc + 3] != 1 || jumpsTo[pc + 4] || jumpsTo[pc + 5]) continue;
+        if (reg < 0 || reg >= RK_CONSTANT || captured[reg]) continue;
+
+        int target = jumpTarget(&code[pc + 5], pc + 5);
+        if (!isDeadFrom(chunk, pc + 6, reg, 0) || !isDeadFrom(chunk, target, reg, 0)) continue;
+
+        // r held (cmp == a); TEST falls through when r is truthy and c == 0,
+        // or falsy and c == 1. The new CMP must skip JMP L in exactly that case.
+        if (!code[pc + 4].C) cmp->A = !cmp->A;
+        setJumpTarget(&code[pc + 1], pc + 1, target);
+        for (int i = pc + 2; i <= pc + 5; i++) removed[i] = 1;
+
+        folded++;
+        pc += 5;
+    }
+    return folded;
+}
+
+// MOVE A A and JMP 0, unless they are what a skip skips
+static int markNoOps(const BytecodeChunk* chunk, unsigned char* removed) {
+    const Instruction* code = chunk->Instructions;
+    int count = 0;
+
+    for (int pc = 0; pc < chunk->Count; pc++) {
+        int noOp = (code[pc].Op == OP_MOVE && code[pc].A == code[pc].B) ||
+                   (code[pc].Op == OP_JMP && code[pc].B == 0);
+        if (!noOp || removed[pc]) continue;
+        if (pc > 0 && isSkip(&code[pc - 1])) continue;
+        removed[pc] = 1;
+        count++;
+    }
+    return count;
+}
+
+// Removes what no path from the entry reaches; returns 0 when out of memory
+static int markUnreachable(const BytecodeChunk* chunk, unsigned char* removed, int* removedCount) {
+    const Instruction* code = chunk->Instructions;
+    int count = chunk->Count;
+    unsigned char* reached = (unsigned char*)calloc(count, 1);
+    int* work = (int*)malloc(sizeof(int) * count);
+    if (!reached || !work) {
+        free(reached);
+        free(work);
+        return 0;
+    }
+
+    int top = 0;
+    work[top++] = 0;
+    reached[0] = 1;
+
+    while (top > 0) {
+        int pc = work[--top];
+        const Instruction* ins = &code[pc];
+        int next[2];
+        int nextCount = 0;
+
+        if (ins->Op == OP_RETURN) {
+            // Ends the frame
+        } else if (ins->Op == OP_JMP || ins->Op == OP_FORPREP) {
+            next[nextCount++] = jumpTarget(ins, pc);
+        } else if (ins->Op == OP_LOADBOOL && ins->C) {
+            next[nextCount++] = pc + 2;
+        } else {
+            next[nextCount++] = pc + 1;
+            if (ins->Op == OP_FORLOOP) next[nextCount++] = jumpTarget(ins, pc);
+            else if (isSkip(ins)) next[nextCount++] = pc + 2;
+        }
+
+        for (int i = 0; i < nextCount; i++) {
+            int target = next[i];
+            if (target < 0 || target >= count || reached[target]) continue;
+            reached[target] = 1;
+            work[top++] = target;
+        }
+    }
+
+    for (int pc = 0; pc < count; pc++) {
+        if (!reached[pc] && !removed[pc]) {
+            removed[pc] = 1;
+            (*removedCount)++;
+        }
+    }
+
+    free(reached);
+    free(work);
+    return 1;
+}
+
+// Drop removed instructions and re-aim jumps; a jump to a removed
+// instruction lands on the next one kept
+static int compact(BytecodeChunk* chunk, const unsigned char* removed) {
+    int count = chunk->Count;
+    int* newIndex = (int*)malloc(sizeof(int) * (count + 1));
+    if (!newIndex) return 0;
+
+    int kept = 0;
+    for (int pc = 0; pc < count; pc++) {
+        newIndex[pc] = kept;
+        if (!removed[pc]) kept++;
+    }
+    newIndex[count] = kept;
+
+    Instruction* code = chunk->Instructions;
+    for (int pc = 0; pc < count; pc++) {
+        if (removed[pc]) continue;
+        int target = jumpTarget(&code[pc], pc);
+        if (target >= 0 && target <= count) {
+            setJumpTarget(&code[pc], newIndex[pc], newIndex[target]);
+        }
+        code[newIndex[pc]] = code[pc];
+    }
+    chunk->Count = kept;
+
+    free(newIndex);
+    return 1;
+}
+
+// ============================================
+// DRIVER
+// ============================================
+
+static void optimizePrototype(BytecodeChunk* chunk) {
+    // Registers inner functions hold as upvalues; they are read behind our back
+    unsigned char captured[RK_CONSTANT];
+    memset(captured, 0, sizeof(captured));
+    for (int i = 0; i < chunk->ChildCount; i++) {
+        const BytecodeChunk* child = chunk->Children[i];
+        for (int j = 0; j < child->UpvalueCount; j++) {
+            int index = child->Upvalues[j].Index;
+            if (child->Upvalues[j].IsLocal && index >= 0 && index < RK_CONSTANT) captured[index] = 1;
+        }
+    }
+
+    for (int round = 0; round < MAX_ROUNDS && chunk->Count > 0; round++) {
+        unsigned char* removed = (unsigned char*)calloc(chunk->Count, 1);
+        int* jumpsTo = (int*)calloc(chunk->Count + 1, sizeof(int));
+        if (!removed || !jumpsTo) {
+            free(removed);
+            free(jumpsTo);
+            return;
+        }
+
+        threadJumps(chunk);
+        countJumpTargets(chunk, jumpsTo);
+
+        int changes = foldConditions(chunk, captured, jumpsTo, removed);
+        changes += markNoOps(chunk, removed);
+        int ok = markUnreachable(chunk, removed, &changes);
+
+        if (ok && changes > 0) ok = compact(chunk, removed);
+        free(removed);
+        free(jumpsTo);
+        if (!ok || changes == 0) return;
+    }
+}
+
+void PeepholeOptimize(BytecodeChunk* chunk) {
+    if (!chunk) return;
+    for (int i = 0; i < chunk->ChildCount; i++) {
+        PeepholeOptimize(chunk->Children[i]);
+    }
+    optimizePrototype(chunk);
+}
+
+// Opcode the pair (first, next) fuses into, or -1 when there is none
+static int fusedOpcode(OpCode first, OpCode next) {
+    switch (first) {
+        case OP_GETGLOBAL: return next == OP_CALL ? OP_GETGLOBAL_CALL : -1;
+        case OP_SELF: return next == OP_CALL ? OP_SELF_CALL : -1;
+        case OP_GETTABLE: return next == OP_GETTABLE ? OP_GETTABLE_GETTABLE : -1;
+        case OP_LOADK: return next == OP_SETTABLE ? OP_LOADK_SETTABLE : -1;
+        case OP_EQ: return next == OP_JMP ? OP_EQ_JMP : -1;
+        case OP_LT: return next == OP_JMP ? OP_LT_JMP : -1;
+        case OP_LE: return next == OP_JMP ? OP_LE_JMP : -1;
+        case OP_TEST: return next == OP_JMP ? OP_TEST_JMP : -1;
+        default: return -1;
+    }
+}
+
+void FuseSuperinstructions(BytecodeChunk* chunk) {
+    if (!chunk) return;
+    for (int i = 0; i < chunk->ChildCount; i++) {
+        FuseSuperinstructions(chunk->Children[i]);
+    }
+    
+    // Only the head changes: the next instruction keeps its opcode so jumps
+    // and skips landing on it still run it alone. It can't head a pair itself.
+    for (int pc = 0; pc + 1 < chunk->Count; pc++) {
+        int fused = fusedOpcode(chunk->Instructions[pc].Op, chunk->Instructions[pc + 1].Op);
+        if (fused < 0) continue;
+        chunk->Instructions[pc].Op = (OpCode)fused;
+        pc++;
+    }
+}
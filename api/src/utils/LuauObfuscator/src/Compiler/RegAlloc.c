@@ -0,0 +1,639 @@
+#include "../../include/RegAlloc.h"
+
+#define MAX_CELLS (1 << 22)     // Instructions x registers tracked per prototype; bigger ones keep their registers
+
+#define FIELD_NONE 0            // Inside a register window (CALL, FORLOOP, ...): stays where it is
+#define FIELD_A    1
+#define FIELD_B    2
+#define FIELD_C    3
+
+#define KIND_USE     1
+#define KIND_DEF     2          // Always overwritten
+#define KIND_CONDDEF 3          // Overwritten on some paths, so the old value may flow through
+
+typedef unsigned long long Bits;
+
+typedef struct {
+    int pc;
+    int reg;
+    unsigned char field;
+    unsigned char kind;
+} Operand;
+
+typedef struct {
+    Operand* items;
+    int count;
+    int capacity;
+    int failed;
+} OperandList;
+
+// Undirected graph over webs, stored as adjacency ranges (CSR)
+typedef struct {
+    int* from;
+    int* to;
+    int count;
+    int capacity;
+    int* start;                 // webCount + 1 offsets into adj
+    int* adj;
+} Graph;
+
+typedef struct {
+    BytecodeChunk* chunk;
+    int count;                  // Instructions
+    int regs;                   // Registers tracked (highest touched + 1)
+    int words;                  // Bits words per register set
+
+    OperandList ops;
+    int* opStart;               // Operands of pc are ops[opStart[pc] .. opStart[pc + 1])
+
+    Bits* use;
+    Bits* def;
+    Bits* liveIn;
+    Bits* liveOut;
+
+    int* webAt;                 // Web of the value of reg live into pc, or -1
+    int* opWeb;
+    int* webReg;
+    unsigned char* pinned;
+    int webCount;
+    int webCapacity;
+
+    Graph interference;
+    Graph moves;
+    unsigned char reserved[RK_CONSTANT];    // Captured registers: closures read them behind our back
+} Allocator;
+
+// ============================================
+// OPERANDS
+// ============================================
+
+static void addOperand(OperandList* list, int pc, int reg, int field, int kind) {
+    if (reg < 0 || reg >= RK_CONSTANT) {
+        list->failed = 1;
+        return;
+    }
+    if (list->count >= list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        Operand* items = (Operand*)realloc(list->items, sizeof(Operand) * capacity);
+        if (!items) {
+            list->failed = 1;
+            return;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    Operand* op = &list->items[list->count++];
+    op->pc = pc;
+    op->reg = reg;
+    op->field = (unsigned char)field;
+    op->kind = (unsigned char)kind;
+}
+
+static void addWindow(OperandList* list, int pc, int first, int last, int kind) {
+    for (int reg = first; reg <= last; reg++) {
+        addOperand(list, pc, reg, FIELD_NONE, kind);
+    }
+}
+
+static void addRK(OperandList* list, int pc, int operand, int field) {
+    if (operand < RK_CONSTANT) addOperand(list, pc, operand, field, KIND_USE);
+}
+
+// Registers ins reads and writes, reads first; 0 for ops the allocator doesn't model.
+// Counts of 0 (up to the frame's top) become windows from A to top.
+static int collectOperands(const BytecodeChunk* chunk, int pc, OperandList* list, int top) {
+    const Instruction* ins = &chunk->Instructions[pc];
+    int a = ins->A, b = ins->B, c = ins->C;
+
+    switch (ins->Op) {
+        case OP_MOVE:
+        case OP_UNM:
+        case OP_NOT:
+        case OP_LEN:
+            addOperand(list, pc, b, FIELD_B, KIND_USE);
+            addOperand(list, pc, a, FIELD_A, KIND_DEF);
+            break;
+        case OP_LOADK:
+        case OP_LOADBOOL:
+        case OP_GETUPVAL:
+        case OP_GETGLOBAL:
+        case OP_NEWTABLE:
+            addOperand(list, pc, a, FIELD_A, KIND_DEF);
+            break;
+        case OP_LOADNIL:
+            if (b == 0) addOperand(list, pc, a, FIELD_A, KIND_DEF);
+            else addWindow(list, pc, a, a + b, KIND_DEF);
+            break;
+        case OP_GETTABLE:
+            addOperand(list, pc, b, FIELD_B, KIND_USE);
+            addRK(list, pc, c, FIELD_C);
+            addOperand(list, pc, a, FIELD_A, KIND_DEF);
+            break;
+        case OP_SETGLOBAL:
+        case OP_SETUPVAL:
+        case OP_TEST:
+            addOperand(list, pc, a, FIELD_A, KIND_USE);
+            break;
+        case OP_SETTABLE:
+            addOperand(list, pc, a, FIELD_A, KIND_USE);
+            addRK(list, pc, b, FIELD_B);
+            addRK(list, pc, c, FIELD_C);
+            break;
+        case OP_SELF:
+            addOperand(list, pc, b, FIELD_B, KIND_USE);
+            addRK(list, pc, c, FIELD_C);
+            addWindow(list, pc, a, a + 1, KIND_DEF);
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_POW:
+        case OP_CONCAT:
+            addRK(list, pc, b, FIELD_B);
+            addRK(list, pc, c, FIELD_C);
+            addOperand(list, pc, a, FIELD_A, KIND_DEF);
+            break;
+        case OP_JMP:
+        case OP_CLOSE:          // Only touches captured registers, which never move
+            break;
+        case OP_EQ:
+        case OP_LT:
+        case OP_LE:
+            addRK(list, pc, b, FIELD_B);
+            addRK(list, pc, c, FIELD_C);
+            break;
+        case OP_TESTSET:
+            addOperand(list, pc, b, FIELD_B, KIND_USE);
+            addOperand(list, pc, a, FIELD_A, KIND_CONDDEF);
+            break;
+        case OP_CALL:
+            addWindow(list, pc, a, b == 0 ? top : a + b - 1, KIND_USE);
+            addWindow(list, pc, a, c == 0 ? top : a + c - 2, KIND_DEF);
+            break;
+        case OP_RETURN:
+            if (b == 2) addOperand(list, pc, a, FIELD_A, KIND_USE);
+            else addWindow(list, pc, a, b == 0 ? top : a + b - 2, KIND_USE);
+            break;
+        case OP_FORPREP:
+            addWindow(list, pc, a, a + 2, KIND_USE);
+            addWindow(list, pc, a, a, KIND_DEF);
+            addWindow(list, pc, a + 3, a + 3, KIND_DEF);
+            break;
+        case OP_FORLOOP:
+            addWindow(list, pc, a, a + 2, KIND_USE);
+            addWindow(list, pc, a, a, KIND_DEF);
+            addWindow(list, pc, a + 3, a + 3, KIND_CONDDEF);
+            break;
+        case OP_TFORLOOP:
+            addWindow(list, pc, a, a + 2, KIND_USE);
+            addWindow(list, pc, a + 2, a + 2, KIND_CONDDEF);
+            addWindow(list, pc, a + 3, a + 2 + c, KIND_DEF);
+            break;
+        case OP_SETLIST:
+            addWindow(list, pc, a, b == 0 ? top : a + b, KIND_USE);
+            break;
+        case OP_CLOSURE:
+            if (b < 0 || b >= chunk->ChildCount) return 0;
+            for (int i = 0; i < chunk->Children[b]->UpvalueCount; i++) {
+                const UpvalueDesc* up = &chunk->Children[b]->Upvalues[i];
+                if (up->IsLocal) addWindow(list, pc, up->Index, up->Index, KIND_USE);
+            }
+            addOperand(list, pc, a, FIELD_A, KIND_DEF);
+            break;
+        case OP_VARARG:
+            addWindow(list, pc, a, b == 0 ? top : a + b - 2, KIND_DEF);
+            break;
+        default:
+            return 0;           // TAILCALL reads the whole frame; fused ops come later
+    }
+    return !list->failed;
+}
+
+// Instructions control can reach from pc
+static int successors(const BytecodeChunk* chunk, int pc, int* out) {
+    const Instruction* ins = &chunk->Instructions[pc];
+    int n = 0;
+    switch (ins->Op) {
+        case OP_RETURN:
+            break;
+        case OP_JMP:
+        case OP_FORPREP:
+            out[n++] = pc + 1 + ins->B;
+            break;
+        case OP_FORLOOP:
+            out[n++] = pc + 1;
+            out[n++] = pc + 1 - ins->B;
+            break;
+        case OP_LOADBOOL:
+            out[n++] = ins->C ? pc + 2 : pc + 1;
+            break;
+        case OP_EQ:
+        case OP_LT:
+        case OP_LE:
+        case OP_TEST:
+        case OP_TESTSET:
+        case OP_TFORLOOP:
+            out[n++] = pc + 1;
+            out[n++] = pc + 2;
+            break;
+        default:
+            out[n++] = pc + 1;
+            break;
+    }
+
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (out[i] >= 0 && out[i] < chunk->Count) out[kept++] = out[i];
+    }
+    return kept;
+}
+
+static int* fieldOf(Instruction* ins, int field) {
+    switch (field) {
+        case FIELD_A: return &ins->A;
+        case FIELD_B: return &ins->B;
+        case FIELD_C: return &ins->C;
+        default: return NULL;
+    }
+}
+
+// ============================================
+// LIVENESS
+// ============================================
+
+static int hasBit(const Bits* set, int reg) {
+    return (int)((set[reg >> 6] >> (reg & 63)) & 1);
+}
+
+static void setBit(Bits* set, int reg) {
+    set[reg >> 6] |= (Bits)1 << (reg & 63);
+}
+
+static void computeLiveness(Allocator* al) {
+    int words = al->words;
+    for (int i = 0; i < al->ops.count; i++) {
+        const Operand* op = &al->ops.items[i];
+        // A conditional write keeps the old value alive through the instruction
+        if (op->kind == KIND_DEF) setBit(al->def + op->pc * words, op->reg);
+        else setBit(al->use + op->pc * words, op->reg);
+    }
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int pc = al->count - 1; pc >= 0; pc--) {
+            Bits* in = al->liveIn + pc * words;
+            Bits* out = al->liveOut + pc * words;
+            int succ[2];
+            int n = successors(al->chunk, pc, succ);
+            for (int w = 0; w < words; w++) {
+                Bits o = 0;
+                for (int i = 0; i < n; i++) o |= al->liveIn[succ[i] * words + w];
+                Bits x = al->use[pc * words + w] | (o & ~al->def[pc * words + w]);
+                if (x != in[w]) changed = 1;
+                in[w] = x;
+                out[w] = o;
+            }
+        }
+    }
+}
+
+// ============================================
+// WEBS
+// ============================================
+
+// Union-find nodes per register: pc is the value live into pc, count + pc
+// the value pc writes
+static int findRoot(int* parent, int node) {
+    while (parent[node] != node) {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+static void unite(int* parent, int x, int y) {
+    x = findRoot(parent, x);
+    y = findRoot(parent, y);
+    if (x != y) parent[x] = y;
+}
+
+static int webFor(Allocator* al, int* rootWeb, int* parent, int node, int reg) {
+    int root = findRoot(parent, node);
+    if (rootWeb[root] >= 0) return rootWeb[root];
+    if (al->webCount >= al->webCapacity) {
+        int capacity = al->webCapacity ? al->webCapacity * 2 : 64;
+        int* webReg = (int*)realloc(al->webReg, sizeof(int) * capacity);
+        if (!webReg) return -1;
+        al->webReg = webReg;
+        al->webCapacity = capacity;
+    }
+    al->webReg[al->webCount] = reg;
+    return rootWeb[root] = al->webCount++;
+}
+
+// Split every register into webs: definitions and the uses they reach.
+// Each web can then live in any register that is free over its range.
+static int buildWebs(Allocator* al) {
+    int count = al->count;
+    int* parent = (int*)malloc(sizeof(int) * 2 * count);
+    int* rootWeb = (int*)malloc(sizeof(int) * 2 * count);
+    if (!parent || !rootWeb) {
+        free(parent);
+        free(rootWeb);
+        return 0;
+    }
+
+    int ok = 1;
+    for (int reg = 0; reg < al->regs && ok; reg++) {
+        for (int i = 0; i < 2 * count; i++) {
+            parent[i] = i;
+            rootWeb[i] = -1;
+        }
+
+        for (int pc = 0; pc < count; pc++) {
+            int succ[2];
+            int n = successors(al->chunk, pc, succ);
+            int from = hasBit(al->def + pc * al->words, reg) ? count + pc : pc;
+            for (int i = 0; i < n; i++) {
+                if (hasBit(al->liveIn + succ[i] * al->words, reg)) unite(parent, from, succ[i]);
+            }
+        }
+        for (int i = 0; i < al->ops.count; i++) {
+            const Operand* op = &al->ops.items[i];
+            if (op->reg == reg && op->kind == KIND_CONDDEF) unite(parent, op->pc, count + op->pc);
+        }
+
+        for (int pc = 0; pc < count && ok; pc++) {
+            if (!hasBit(al->liveIn + pc * al->words, reg)) continue;
+            int web = webFor(al, rootWeb, parent, pc, reg);
+            al->webAt[pc * al->regs + reg] = web;
+            ok = web >= 0;
+        }
+        for (int i = 0; i < al->ops.count && ok; i++) {
+            const Operand* op = &al->ops.items[i];
+            if (op->reg != reg) continue;
+            int node = op->kind == KIND_USE ? op->pc : count + op->pc;
+            al->opWeb[i] = webFor(al, rootWeb, parent, node, reg);
+            ok = al->opWeb[i] >= 0;
+        }
+    }
+
+    free(parent);
+    free(rootWeb);
+    return ok;
+}
+
+// Webs that must keep their register: part of a window, live on entry
+// (parameters), or captured by a closure
+static int pinWebs(Allocator* al) {
+    al->pinned = (unsigned char*)calloc(al->webCount ? al->webCount : 1, 1);
+    if (!al->pinned) return 0;
+
+    for (int i = 0; i < al->ops.count; i++) {
+        const Operand* op = &al->ops.items[i];
+        if (op->field == FIELD_NONE || al->reserved[op->reg]) al->pinned[al->opWeb[i]] = 1;
+    }
+    for (int reg = 0; reg < al->regs; reg++) {
+        int web = al->webAt[reg];
+        if (web >= 0) al->pinned[web] = 1;
+    }
+    return 1;
+}
+
+// ============================================
+// GRAPHS
+// ============================================
+
+static int addEdge(Graph* graph, int x, int y) {
+    if (graph->count >= graph->capacity) {
+        int capacity = graph->capacity ? graph->capacity * 2 : 256;
+        int* from = (int*)realloc(graph->from, sizeof(int) * capacity);
+        if (from) graph->from = from;
+        int* to = (int*)realloc(graph->to, sizeof(int) * capacity);
+        if (to) graph->to = to;
+        if (!from || !to) return 0;
+        graph->capacity = capacity;
+    }
+    graph->from[graph->count] = x;
+    graph->to[graph->count] = y;
+    graph->count++;
+    return 1;
+}
+
+static int finishGraph(Graph* graph, int nodes) {
+    graph->start = (int*)calloc(nodes + 1, sizeof(int));
+    graph->adj = (int*)malloc(sizeof(int) * (2 * graph->count + 1));
+    if (!graph->start || !graph->adj) return 0;
+
+    for (int i = 0; i < graph->count; i++) {
+        graph->start[graph->from[i] + 1]++;
+        graph->start[graph->to[i] + 1]++;
+    }
+    for (int i = 0; i < nodes; i++) graph->start[i + 1] += graph->start[i];
+
+    int* fill = (int*)malloc(sizeof(int) * (nodes + 1));
+    if (!fill) return 0;
+    memcpy(fill, graph->start, sizeof(int) * (nodes + 1));
+    for (int i = 0; i < graph->count; i++) {
+        graph->adj[fill[graph->from[i]]++] = graph->to[i];
+        graph->adj[fill[graph->to[i]]++] = graph->from[i];
+    }
+    free(fill);
+    return 1;
+}
+
+static void freeGraph(Graph* graph) {
+    free(graph->from);
+    free(graph->to);
+    free(graph->start);
+    free(graph->adj);
+}
+
+// Web holding reg right after pc runs
+static int webAfter(const Allocator* al, int pc, int reg) {
+    for (int i = al->opStart[pc]; i < al->opStart[pc + 1]; i++) {
+        const Operand* op = &al->ops.items[i];
+        if (op->reg == reg && op->kind != KIND_USE) return al->opWeb[i];
+    }
+    return al->webAt[pc * al->regs + reg];
+}
+
+// A value interferes with everything live past the point it is written.
+// MOVE does not make its source and destination interfere, so they can
+// share a register and the MOVE disappears.
+static int buildGraphs(Allocator* al) {
+    for (int i = 0; i < al->ops.count; i++) {
+        const Operand* op = &al->ops.items[i];
+        const Instruction* ins = &al->chunk->Instructions[op->pc];
+        int web = al->opWeb[i];
+
+        if (ins->Op == OP_MOVE && op->field == FIELD_B) {
+            if (!addEdge(&al->moves, web, al->opWeb[i + 1])) return 0;
+        }
+        if (op->kind == KIND_USE) continue;
+
+        const Bits* out = al->liveOut + op->pc * al->words;
+        for (int reg = 0; reg < al->regs; reg++) {
+            if (reg == op->reg || !hasBit(out, reg)) continue;
+            if (ins->Op == OP_MOVE && reg == ins->B) continue;
+            int other = webAfter(al, op->pc, reg);
+            if (other < 0 || other == web) continue;
+            if (al->pinned[web] && al->pinned[other]) continue;
+            if (!addEdge(&al->interference, web, other)) return 0;
+        }
+    }
+    return finishGraph(&al->interference, al->webCount) && finishGraph(&al->moves, al->webCount);
+}
+
+// ============================================
+// COLORING
+// ============================================
+
+// Registers are handed out in program order, lowest free first, preferring
+// one a MOVE partner already sits in. 0 if some web finds no register.
+static int colorWebs(const Allocator* al, int* color) {
+    int mark[RK_CONSTANT];
+    for (int c = 0; c < RK_CONSTANT; c++) mark[c] = -1;
+
+    for (int w = 0; w < al->webCount; w++) {
+        color[w] = al->pinned[w] ? al->webReg[w] : -1;
+    }
+
+    for (int i = 0; i < al->ops.count; i++) {
+        int web = al->opWeb[i];
+        if (color[web] >= 0) continue;
+
+        for (int c = 0; c < RK_CONSTANT; c++) {
+            if (al->reserved[c]) mark[c] = web;
+        }
+        for (int e = al->interference.start[web]; e < al->interference.start[web + 1]; e++) {
+            int other = color[al->interference.adj[e]];
+            if (other >= 0) mark[other] = web;
+        }
+
+        int chosen = -1;
+        for (int e = al->moves.start[web]; e < al->moves.start[web + 1] && chosen < 0; e++) {
+            int partner = color[al->moves.adj[e]];
+            if (partner >= 0 && mark[partner] != web) chosen = partner;
+        }
+        for (int c = 0; c < RK_CONSTANT && chosen < 0; c++) {
+            if (mark[c] != web) chosen = c;
+        }
+        if (chosen < 0) return 0;
+        color[web] = chosen;
+    }
+    return 1;
+}
+
+// Registers the frame needs, with webs moved to color (NULL: where they are now)
+static int frameSize(const Allocator* al, const int* color) {
+    int size = al->chunk->ParamCount;
+    for (int i = 0; i < al->ops.count; i++) {
+        int reg = color ? color[al->opWeb[i]] : al->ops.items[i].reg;
+        if (al->ops.items[i].field == FIELD_NONE) reg = al->ops.items[i].reg;
+        if (reg + 1 > size) size = reg + 1;
+    }
+    return size;
+}
+
+// ============================================
+// DRIVER
+// ============================================
+
+static void freeAllocator(Allocator* al) {
+    free(al->ops.items);
+    free(al->opStart);
+    free(al->use);
+    free(al->def);
+    free(al->liveIn);
+    free(al->liveOut);
+    free(al->webAt);
+    free(al->opWeb);
+    free(al->webReg);
+    free(al->pinned);
+    freeGraph(&al->interference);
+    freeGraph(&al->moves);
+}
+
+static int collectFrame(Allocator* al, int top) {
+    al->ops.count = 0;
+    for (int pc = 0; pc < al->count; pc++) {
+        al->opStart[pc] = al->ops.count;
+        if (!collectOperands(al->chunk, pc, &al->ops, top)) return 0;
+    }
+    al->opStart[al->count] = al->ops.count;
+    return 1;
+}
+
+// Renumbers chunk's registers when that shrinks or keeps its frame; sets MaxStack either way
+static void allocateFrame(Allocator* al) {
+    BytecodeChunk* chunk = al->chunk;
+    al->opStart = (int*)malloc(sizeof(int) * (al->count + 1));
+    if (!al->opStart) return;
+
+    // Open windows cover every register the fixed operands size the frame to,
+    // so nothing live is renamed into the range a C = 0 call may write
+    if (!collectFrame(al, -1)) return;
+    al->regs = frameSize(al, NULL);
+    if (!collectFrame(al, al->regs - 1)) return;
+    chunk->MaxStack = al->regs;
+    if (al->count == 0 || al->regs == 0 || (long long)al->count * al->regs > MAX_CELLS) return;
+
+    al->words = (al->regs + 63) / 64;
+    size_t sets = (size_t)al->count * al->words;
+    al->use = (Bits*)calloc(sets, sizeof(Bits));
+    al->def = (Bits*)calloc(sets, sizeof(Bits));
+    al->liveIn = (Bits*)calloc(sets, sizeof(Bits));
+    al->liveOut = (Bits*)calloc(sets, sizeof(Bits));
+    al->webAt = (int*)malloc(sizeof(int) * (size_t)al->count * al->regs);
+    al->opWeb = (int*)malloc(sizeof(int) * (al->ops.count + 1));
+    if (!al->use || !al->def || !al->liveIn || !al->liveOut || !al->webAt || !al->opWeb) return;
+    for (int i = 0; i < al->count * al->regs; i++) al->webAt[i] = -1;
+
+    computeLiveness(al);
+    if (!buildWebs(al) || !pinWebs(al) || !buildGraphs(al)) return;
+
+    int* color = (int*)malloc(sizeof(int) * (al->webCount + 1));
+    if (!color) return;
+    if (colorWebs(al, color)) {
+        int size = frameSize(al, color);
+        if (size <= al->regs) {
+            for (int i = 0; i < al->ops.count; i++) {
+                const Operand* op = &al->ops.items[i];
+                int* field = fieldOf(&chunk->Instructions[op->pc], op->field);
+                if (field) *field = color[al->opWeb[i]];
+            }
+            chunk->MaxStack = size;
+        }
+    }
+    free(color);
+}
+
+static void allocatePrototype(BytecodeChunk* chunk) {
+    Allocator al;
+    memset(&al, 0, sizeof(al));
+    al.chunk = chunk;
+    al.count = chunk->Count;
+
+    for (int i = 0; i < chunk->ChildCount; i++) {
+        const BytecodeChunk* child = chunk->Children[i];
+        for (int j = 0; j < child->UpvalueCount; j++) {
+            int index = child->Upvalues[j].Index;
+            if (child->Upvalues[j].IsLocal && index >= 0 && index < RK_CONSTANT) al.reserved[index] = 1;
+        }
+    }
+
+    allocateFrame(&al);
+    freeAllocator(&al);
+}
+
+void AllocateRegisters(BytecodeChunk* chunk) {
+    if (!chunk) return;
+    for (int i = 0; i < chunk->ChildCount; i++) {
+        AllocateRegisters(chunk->Children[i]);
+    }
+    allocatePrototype(chunk);
+}
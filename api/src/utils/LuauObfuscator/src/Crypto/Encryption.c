@@ -1,11 +1,12 @@
 #include "../../include/Encryption.h"
 #include "../../include/Utils.h"
 
-EncryptionContext* CreateEncryptionContext() {
+EncryptionContext* CreateEncryptionContext(ObfContext* obf) {
     EncryptionContext* ctx = (EncryptionContext*)malloc(sizeof(EncryptionContext));
-    ctx->masterKey = RandomInt(0x10000, 0xFFFFFF);
-    ctx->keyRotation = RandomInt(3, 11);
-    ctx->rounds = RandomInt(2, 5);
+    ctx->obf = obf;
+    ctx->masterKey = RandomInt(obf, 0x10000, 0xFFFFFF);
+    ctx->keyRotation = RandomInt(obf, 3, 11);
+    ctx->rounds = RandomInt(obf, 2, 5);
     GenerateKeys(ctx);
     return ctx;
 }
@@ -33,7 +34,7 @@ void GenerateKeys(EncryptionContext* ctx) {
 
 char* EncryptConstant(EncryptionContext* ctx, const char* input, int* keyIndex) {
     int len = strlen(input);
-    *keyIndex = RandomInt(0, 255);
+    *keyIndex = RandomInt(ctx->obf, 0, 255);
     unsigned int key = ctx->constKeys[*keyIndex];
     
     // Allocate output (escaped format)
@@ -1,15 +1,16 @@
 #include "../../include/ControlFlow.h"
 #include "../../include/Utils.h"
 
-ControlFlowContext* CreateControlFlowContext() {
+ControlFlowContext* CreateControlFlowContext(ObfContext* obf) {
     ControlFlowContext* ctx = (ControlFlowContext*)malloc(sizeof(ControlFlowContext));
+    ctx->obf = obf;
     ctx->stateCount = 0;
     ctx->entryState = 0;
     ctx->exitState = -1;
-    ctx->dispatcherVariant = RandomInt(0, 4);
-    ctx->stateXorKey = RandomInt(0x1000, 0xFFFF);
-    ctx->redundantJumps = RandomInt(5, 15);
-    ctx->fakeLoops = RandomInt(2, 6);
+    ctx->dispatcherVariant = RandomInt(obf, 0, 4);
+    ctx->stateXorKey = RandomInt(obf, 0x1000, 0xFFFF);
+    ctx->redundantJumps = RandomInt(obf, 5, 15);
+    ctx->fakeLoops = RandomInt(obf, 2, 6);
     return ctx;
 }
 
@@ -20,8 +21,8 @@ void AddState(ControlFlowContext* ctx, StateType type, int nextReal) {
     node->id = ctx->stateCount;
     node->type = type;
     node->nextReal = nextReal;
-    node->nextFake = RandomInt(0, ctx->stateCount);
-    node->condition = RandomInt(0, 5);
+    node->nextFake = RandomInt(ctx->obf, 0, ctx->stateCount);
+    node->condition = RandomInt(ctx->obf, 0, 5);
     node->stateKey = (ctx->stateCount * 7919 + ctx->stateXorKey) ^ ctx->stateXorKey;
     
     ctx->stateCount++;
@@ -32,10 +33,10 @@ void InsertFakeStates(ControlFlowContext* ctx, int count) {
         StateNode* node = &ctx->states[ctx->stateCount];
         node->id = ctx->stateCount;
         node->type = STATE_FAKE;
-        node->nextReal = RandomInt(0, ctx->stateCount);
-        node->nextFake = RandomInt(0, ctx->stateCount);
-        node->condition = RandomInt(0, 10);
-        node->stateKey = RandomInt(0x1000, 0xFFFF);
+        node->nextReal = RandomInt(ctx->obf, 0, ctx->stateCount);
+        node->nextFake = RandomInt(ctx->obf, 0, ctx->stateCount);
+        node->condition = RandomInt(ctx->obf, 0, 10);
+        node->stateKey = RandomInt(ctx->obf, 0x1000, 0xFFFF);
         ctx->stateCount++;
     }
 }
@@ -115,7 +116,7 @@ char* GenerateCFDispatcher(ControlFlowContext* ctx, int variant) {
             // Fake state - does nothing useful
             snprintf(buf, 512,
                 "if cs==%d then local _t=%d;_t=_t+1;st=%d;",
-                i, RandomInt(1, 100), node->nextReal);
+                i, RandomInt(ctx->obf, 1, 100), node->nextReal);
         } else {
             // Real state
             snprintf(buf, 512,
@@ -125,8 +126,8 @@ char* GenerateCFDispatcher(ControlFlowContext* ctx, int variant) {
         strcat(code, buf);
         
         // Add redundant condition
-        if (RandomInt(0, 2) == 0) {
-            snprintf(buf, 512, "if %d>%d then end;", RandomInt(50, 100), RandomInt(1, 49));
+        if (RandomInt(ctx->obf, 0, 2) == 0) {
+            snprintf(buf, 512, "if %d>%d then end;", RandomInt(ctx->obf, 50, 100), RandomInt(ctx->obf, 1, 49));
             strcat(code, buf);
         }
         
@@ -1,8 +1,9 @@
 #include "../../include/Fragmenter.h"
 #include "../../include/Utils.h"
 
-FragmentContext* CreateFragmentContext() {
+FragmentContext* CreateFragmentContext(ObfContext* obf) {
     FragmentContext* ctx = (FragmentContext*)malloc(sizeof(FragmentContext));
+    ctx->obf = obf;
     ctx->fragmentCount = 0;
     ctx->fakeCount = 0;
     ctx->orderTable = NULL;
@@ -14,11 +15,7 @@ void FragmentBytecode(FragmentContext* ctx, BytecodeChunk* chunk, int blockSize)
     if (blockSize < 4) blockSize = 4;
     
     // Calculate total bytecode size
-    int totalSize = 1 + 1; // version + const count
-    for (int i = 0; i < chunk->ConstantCount; i++) {
-        totalSize += 1 + strlen(chunk->Constants[i]);
-    }
-    totalSize += chunk->Count * 4; // instructions
+    int totalSize = 1 + PrototypeSize(chunk); // version + prototype tree
     
     // Create fragments
     int offset = 0;
@@ -28,15 +25,15 @@ void FragmentBytecode(FragmentContext* ctx, BytecodeChunk* chunk, int blockSize)
         frag->type = FRAG_REAL;
         frag->realOrder = ctx->fragmentCount;
         
-        int fragSize = blockSize + RandomInt(-2, 2);
+        int fragSize = blockSize + RandomInt(ctx->obf, -2, 2);
         if (fragSize < 2) fragSize = 2;
         if (offset + fragSize > totalSize) fragSize = totalSize - offset;
         
         frag->dataLen = fragSize;
         frag->data = (unsigned char*)malloc(fragSize);
         frag->nextFragment = ctx->fragmentCount + 1;
-        frag->checksum = RandomInt(0x1000, 0xFFFFFF);
-        frag->decryptKey = RandomInt(1, 255);
+        frag->checksum = RandomInt(ctx->obf, 0x1000, 0xFFFFFF);
+        frag->decryptKey = RandomInt(ctx->obf, 1, 255);
         
         offset += fragSize;
         ctx->fragmentCount++;
@@ -56,16 +53,16 @@ void InsertFakeBlocks(FragmentContext* ctx, int count) {
         frag->realOrder = -1;
         
         // Generate fake data
-        int fakeSize = RandomInt(8, 32);
+        int fakeSize = RandomInt(ctx->obf, 8, 32);
         frag->dataLen = fakeSize;
         frag->data = (unsigned char*)malloc(fakeSize);
         for (int j = 0; j < fakeSize; j++) {
-            frag->data[j] = (unsigned char)RandomInt(0, 255);
+            frag->data[j] = (unsigned char)RandomInt(ctx->obf, 0, 255);
         }
         
-        frag->nextFragment = RandomInt(0, ctx->fragmentCount);
-        frag->checksum = RandomInt(0x1000, 0xFFFFFF);
-        frag->decryptKey = RandomInt(1, 255);
+        frag->nextFragment = RandomInt(ctx->obf, 0, ctx->fragmentCount);
+        frag->checksum = RandomInt(ctx->obf, 0x1000, 0xFFFFFF);
+        frag->decryptKey = RandomInt(ctx->obf, 1, 255);
         
         ctx->fakeBlocks[ctx->fakeCount++] = ctx->fragmentCount;
         ctx->fragmentCount++;
@@ -75,7 +72,7 @@ void InsertFakeBlocks(FragmentContext* ctx, int count) {
 void ShuffleFragments(FragmentContext* ctx) {
     // Fisher-Yates shuffle
     for (int i = ctx->fragmentCount - 1; i > 0; i--) {
-        int j = RandomInt(0, i);
+        int j = RandomInt(ctx->obf, 0, i);
         
         // Swap fragments
         Fragment temp = ctx->fragments[i];
@@ -0,0 +1,85 @@
+#include <pthread.h>
+
+#include "../../include/Common.h"
+#include "../../include/Context.h"
+#include "../../include/VmGenerator.h"
+
+// ============================================
+// BATCH VARIANTS (one chunk, K independent builds)
+// ============================================
+//
+// Every variant gets its own ObfContext, hence its own opcodeMap,
+// dispatcher/decoder variants, keys and noise. The chunk is only read, so
+// the builds run on one thread per core pulling indices off a counter.
+
+#define MAX_VARIANT_THREADS 64
+
+typedef struct {
+    const BytecodeChunk* chunk;
+    const unsigned long long* seeds;
+    const char* watermark;
+    size_t watermarkLength;
+    const ObfContext* job;      // Deadline and cancel flag shared by every build
+    char** outputs;
+    unsigned long long* usedSeeds;
+    int count;
+    int next;                   // Next variant index to build (atomic)
+} VariantBatch;
+
+static void* variantWorker(void* arg) {
+    VariantBatch* batch = (VariantBatch*)arg;
+
+    for (;;) {
+        int i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+        if (i >= batch->count) break;
+
+        ObfContext* obf = CreateObfContext(batch->seeds ? batch->seeds[i] : 0);
+        if (!obf) continue;
+        if (batch->job) {
+            obf->deadline = batch->job->deadline;
+            obf->cancel = batch->job->cancel;
+        }
+        if (batch->usedSeeds) batch->usedSeeds[i] = obf->seed;
+        batch->outputs[i] = GenerateObfuscatedScript(batch->chunk, batch->watermark,
+                                                     batch->watermarkLength, obf);
+        FreeObfContext(obf);
+    }
+    return NULL;
+}
+
+char** GenerateVariants(const BytecodeChunk* chunk, int k, const unsigned long long* seeds,
+                        const char* watermark, size_t watermarkLength,
+                        const ObfContext* job, unsigned long long* usedSeeds) {
+    if (!chunk || k <= 0) return NULL;
+
+    char** outputs = (char**)calloc(k, sizeof(char*));
+    if (!outputs) return NULL;
+
+    VariantBatch batch;
+    batch.chunk = chunk;
+    batch.seeds = seeds;
+    batch.watermark = watermark;
+    batch.watermarkLength = watermarkLength;
+    batch.job = job;
+    batch.outputs = outputs;
+    batch.usedSeeds = usedSeeds;
+    batch.count = k;
+    batch.next = 0;
+
+    int threads = OnlineCores();
+    if (threads > k) threads = k;
+    if (threads > MAX_VARIANT_THREADS) threads = MAX_VARIANT_THREADS;
+
+    // The calling thread builds too, so one core needs no extra thread
+    pthread_t workers[MAX_VARIANT_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, variantWorker, &batch) == 0) started++;
+    }
+    variantWorker(&batch);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    return outputs;
+}
@@ -21,6 +21,8 @@ typedef struct {
     int dispatcherVariant;
     int decoderVariant;
     int checksumSeed;
+    unsigned char usedOps[OP_COUNT];    // Opcodes that appear anywhere in the chunk
+    ObfContext* obf;
 } BuildContext;
 
 // Helper to append text
@@ -40,14 +42,15 @@ void Append(char** buffer, int* size, int* capacity, const char* str) {
 }
 
 // Create unique build context
-BuildContext* CreateBuildContext() {
+BuildContext* CreateBuildContext(ObfContext* obf) {
     BuildContext* ctx = (BuildContext*)malloc(sizeof(BuildContext));
-    ctx->buildId = RandomInt(10000, 99999);
-    ctx->xorKey = RandomInt(1, 254);
-    ctx->encKey = RandomInt(0x1000, 0xFFFFFF);
-    ctx->dispatcherVariant = RandomInt(0, 4);
-    ctx->decoderVariant = RandomInt(0, 4);
-    ctx->checksumSeed = RandomInt(0x100, 0xFFFF);
+    ctx->obf = obf;
+    ctx->buildId = RandomInt(obf, 10000, 99999);
+    ctx->xorKey = RandomInt(obf, 1, 254);
+    ctx->encKey = RandomInt(obf, 0x1000, 0xFFFFFF);
+    ctx->dispatcherVariant = RandomInt(obf, 0, 4);
+    ctx->decoderVariant = RandomInt(obf, 0, 4);
+    ctx->checksumSeed = RandomInt(obf, 0x100, 0xFFFF);
     
     // Generate shuffled opcode mapping - randomize real opcodes to different values
     // Create array of available values and shuffle
@@ -55,22 +58,34 @@ BuildContext* CreateBuildContext() {
     for (int i = 0; i < 256; i++) {
         available[i] = i;
     }
-    // Fisher-Yates shuffle
-    for (int i = 255; i > 0; i--) {
-        int j = RandomInt(0, i);
+    // Fisher-Yates shuffle of 1..255 - value 0 stays last so no real opcode
+    // decodes from the zero padding at the end of the Base85 payload
+    for (int i = 255; i > 1; i--) {
+        int j = RandomInt(obf, 1, i);
         int temp = available[i];
         available[i] = available[j];
         available[j] = temp;
     }
     // Assign shuffled values to opcodes
-    for (int i = 0; i < 256; i++) {
-        ctx->opcodeMap[i] = available[i];
+    for (int i = 0; i < 255; i++) {
+        ctx->opcodeMap[i] = available[i + 1];
     }
+    ctx->opcodeMap[255] = 0;
+    memset(ctx->usedOps, 0, sizeof(ctx->usedOps));
     return ctx;
 }
 
+static void markUsedOpcodes(const BytecodeChunk* chunk, unsigned char* used) {
+    for (int i = 0; i < chunk->Count; i++) {
+        used[chunk->Instructions[i].Op] = 1;
+    }
+    for (int i = 0; i < chunk->ChildCount; i++) {
+        markUsedOpcodes(chunk->Children[i], used);
+    }
+}
+
 // Generate smart noise functions that look important
-void GenerateSmartNoise(char** script, int* size, int* capacity, const char* name, int variant) {
+void GenerateSmartNoise(char** script, int* size, int* capacity, const char* name, int variant, ObfContext* obf) {
     char buf[1024];
     
     switch (variant % MAX_DUMMY_PATTERNS) {
@@ -81,7 +96,7 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "for i=1,#u do h=bit32.bxor(h*%d,string.byte(u,i)or 0);end;"
                 "return h==%u and E or x;"
                 "end,",
-                name, RandomInt(0x1000,0xFFFF), RandomInt(31,127), RandomInt(0x10000,0xFFFFFF));
+                name, RandomInt(obf, 0x1000,0xFFFF), RandomInt(obf, 31,127), RandomInt(obf, 0x10000,0xFFFFFF));
             break;
         case 1: // Fake decryptor
             snprintf(buf, 1024,
@@ -90,7 +105,7 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "for i=1,#d do o[i]=string.char(bit32.bxor(string.byte(d,i),m%%256));m=m+%d;end;"
                 "return table.concat(o);"
                 "end,",
-                name, RandomInt(0x100,0xFFFF), RandomInt(3,17));
+                name, RandomInt(obf, 0x100,0xFFFF), RandomInt(obf, 3,17));
             break;
         case 2: // Fake state machine
             snprintf(buf, 1024,
@@ -102,8 +117,8 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "else st=-1;end;end;"
                 "return st==-%d;"
                 "end,",
-                name, RandomInt(1,10), RandomInt(1,5), RandomInt(6,10), 
-                RandomInt(1,5), RandomInt(1,3));
+                name, RandomInt(obf, 1,10), RandomInt(obf, 1,5), RandomInt(obf, 6,10), 
+                RandomInt(obf, 1,5), RandomInt(obf, 1,3));
             break;
         case 3: // Fake checksum
             snprintf(buf, 1024,
@@ -115,7 +130,7 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "end;"
                 "return c;"
                 "end,",
-                name, RandomInt(0x1000,0xFFFFFF), RandomInt(0x10000,0xFFFFFF));
+                name, RandomInt(obf, 0x1000,0xFFFFFF), RandomInt(obf, 0x10000,0xFFFFFF));
             break;
         case 4: // Fake loader with closure
             snprintf(buf, 1024,
@@ -125,7 +140,7 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "for i=0,%d do _t[i]=bit32.bxor(i,_k)end;"
                 "return function(x)return _t[x%%%d]or 0;end;"
                 "end)(),",
-                name, RandomInt(0x100,0xFFF), RandomInt(64,128), RandomInt(64,128));
+                name, RandomInt(obf, 0x100,0xFFF), RandomInt(obf, 64,128), RandomInt(obf, 64,128));
             break;
         case 5: // Fake cross-validator
             snprintf(buf, 1024,
@@ -134,8 +149,8 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "if c then v=bit32.band(v,c);end;"
                 "return v>%d and v<%d;"
                 "end,",
-                name, RandomInt(100,500), RandomInt(100,500), 
-                RandomInt(10,100), RandomInt(500,1000));
+                name, RandomInt(obf, 100,500), RandomInt(obf, 100,500), 
+                RandomInt(obf, 10,100), RandomInt(obf, 500,1000));
             break;
         case 6: // Fake table manipulator
             snprintf(buf, 1024,
@@ -146,7 +161,7 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "t[k]=bit32.bxor(v or 0,h);"
                 "return t;"
                 "end,",
-                name, RandomInt(0x1000,0xFFFF));
+                name, RandomInt(obf, 0x1000,0xFFFF));
             break;
         case 7: // Fake iterator
             snprintf(buf, 1024,
@@ -159,7 +174,7 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "return i,m%%%d;"
                 "end;"
                 "end,",
-                name, RandomInt(100,999), RandomInt(3,17), RandomInt(100,1000));
+                name, RandomInt(obf, 100,999), RandomInt(obf, 3,17), RandomInt(obf, 100,1000));
             break;
         case 8: // Fake environment checker
             snprintf(buf, 1024,
@@ -171,7 +186,7 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "end;"
                 "return c>%d;"
                 "end,",
-                name, RandomInt(0,50), RandomInt(10,30));
+                name, RandomInt(obf, 0,50), RandomInt(obf, 10,30));
             break;
         case 9: // Fake bit manipulator
             snprintf(buf, 1024,
@@ -180,8 +195,8 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "r=bit32.bor(r,bit32.lshift(z or 0,%d));"
                 "return bit32.bxor(r,%u);"
                 "end,",
-                name, RandomInt(0xFF,0xFFFF), RandomInt(0xFF,0xFFFF),
-                RandomInt(1,8), RandomInt(0x100,0xFFF));
+                name, RandomInt(obf, 0xFF,0xFFFF), RandomInt(obf, 0xFF,0xFFFF),
+                RandomInt(obf, 1,8), RandomInt(obf, 0x100,0xFFF));
             break;
         case 10: // Fake string builder
             snprintf(buf, 1024,
@@ -194,7 +209,7 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "end;end;"
                 "return table.concat(o);"
                 "end,",
-                name, RandomInt(1,50));
+                name, RandomInt(obf, 1,50));
             break;
         default: // Fake math operation
             snprintf(buf, 1024,
@@ -202,144 +217,89 @@ void GenerateSmartNoise(char** script, int* size, int* capacity, const char* nam
                 "local r=((a or %d)*(b or %d)+%d)%%%d;"
                 "return r>%d and r or r+%d;"
                 "end,",
-                name, RandomInt(1,100), RandomInt(1,100), 
-                RandomInt(100,1000), RandomInt(1000,10000),
-                RandomInt(100,500), RandomInt(10,50));
+                name, RandomInt(obf, 1,100), RandomInt(obf, 1,100), 
+                RandomInt(obf, 100,1000), RandomInt(obf, 1000,10000),
+                RandomInt(obf, 100,500), RandomInt(obf, 10,50));
             break;
     }
     
     Append(script, size, capacity, buf);
 }
 
+// Handlers are rebuilt on every dispatch, so only opcodes the chunk uses get one
+static void emitHandler(char** script, int* size, int* capacity, BuildContext* ctx,
+                        OpCode op, const char* body) {
+    if (!ctx->usedOps[op]) return;
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "H[%d]=function()%s end;", ctx->opcodeMap[op], body);
+    Append(script, size, capacity, buf);
+}
+
 // Generate polymorphic opcode handlers using dispatch table - opcodes completely hidden
 void GenerateOpcodeHandlers(char** script, int* size, int* capacity, BuildContext* ctx) {
     char buf[2048];
     
     // Create dispatch table - opcodes are hidden as table indices
     // The table is built with scrambled indices so no pattern is visible
-    Append(script, size, capacity, "local U={};local H={};");
+    Append(script, size, capacity, "local H={};");
     
     // Build handler table with shuffled indices - no visible opcode numbers!
     // Each handler is assigned to H[shuffledOp]
     
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[B] end;", ctx->opcodeMap[0]); // MOVE
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=K[B] end;", ctx->opcodeMap[1]); // LOADK
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=(B==1);if C==1 then pos=pos+4 end end;", ctx->opcodeMap[2]); // LOADBOOL
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()for i=A,A+B do S[i]=nil end end;", ctx->opcodeMap[3]); // LOADNIL
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=U[B] end;", ctx->opcodeMap[4]); // GETUPVAL
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=G[K[B]] end;", ctx->opcodeMap[5]); // GETGLOBAL
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()local k=C>=256 and K[C-256] or S[C];S[A]=S[B][k] end;", ctx->opcodeMap[6]); // GETTABLE
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()G[K[B]]=S[A] end;", ctx->opcodeMap[7]); // SETGLOBAL
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()U[B]=S[A] end;", ctx->opcodeMap[8]); // SETUPVAL
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()local k=B>=256 and K[B-256] or S[B];local v=C>=256 and K[C-256] or S[C];S[A][k]=v end;", ctx->opcodeMap[9]); // SETTABLE
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]={} end;", ctx->opcodeMap[10]); // NEWTABLE
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()local k=C>=256 and K[C-256] or S[C];S[A+1]=S[B];S[A]=S[B][k] end;", ctx->opcodeMap[11]); // SELF
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[B]+S[C] end;", ctx->opcodeMap[12]); // ADD
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[B]-S[C] end;", ctx->opcodeMap[13]); // SUB
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[B]*S[C] end;", ctx->opcodeMap[14]); // MUL
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[B]/S[C] end;", ctx->opcodeMap[15]); // DIV
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[B]%%S[C] end;", ctx->opcodeMap[16]); // MOD
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[B]^S[C] end;", ctx->opcodeMap[17]); // POW
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=-S[B] end;", ctx->opcodeMap[18]); // UNM
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=not S[B] end;", ctx->opcodeMap[19]); // NOT
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=#S[B] end;", ctx->opcodeMap[20]); // LEN
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[B]..S[C] end;", ctx->opcodeMap[21]); // CONCAT
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()pos=pos+B*6 end;", ctx->opcodeMap[22]); // JMP
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()if (S[B]==S[C])~=(A==1) then pos=pos+6 end end;", ctx->opcodeMap[23]); // EQ
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()if (S[B]<S[C])~=(A==1) then pos=pos+6 end end;", ctx->opcodeMap[24]); // LT
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()if (S[B]<=S[C])~=(A==1) then pos=pos+6 end end;", ctx->opcodeMap[25]); // LE
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()if (not S[A])~=(C==1) then pos=pos+6 end end;", ctx->opcodeMap[26]); // TEST
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()if (not S[B])~=(C==1) then pos=pos+6 else S[A]=S[B] end end;", ctx->opcodeMap[27]); // TESTSET
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()local f=S[A];local args={};for i=1,B-1 do args[i]=S[A+i] end;local rets={f(unpack(args))};if C>1 then for i=1,C-1 do S[A+i-1]=rets[i] end else S[A]=rets[1] end end;", ctx->opcodeMap[28]); // CALL
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()local f=S[A];local args={};for i=1,B-1 do args[i]=S[A+i] end;return f(unpack(args)) end;", ctx->opcodeMap[29]); // TAILCALL
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()local rets={};for i=0,B-2 do rets[i+1]=S[A+i] end;return unpack(rets) end;", ctx->opcodeMap[30]); // RETURN
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[A]+S[A+2];if S[A+2]>0 then if S[A]<=S[A+1] then S[A+3]=S[A];pos=pos-B*6 end else if S[A]>=S[A+1] then S[A+3]=S[A];pos=pos-B*6 end end end;", ctx->opcodeMap[31]); // FORLOOP
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()S[A]=S[A]-S[A+2];S[A+3]=S[A];pos=pos+B*6 end;", ctx->opcodeMap[32]); // FORPREP
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()local f,s,v=S[A],S[A+1],S[A+2];local r={f(s,v)};for i=1,C do S[A+2+i]=r[i] end;if r[1]~=nil then S[A+2]=r[1] else pos=pos+6 end end;", ctx->opcodeMap[33]); // TFORLOOP
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()local t=S[A];local off=(C-1)*50;for i=1,B do t[off+i]=S[A+i] end end;", ctx->opcodeMap[34]); // SETLIST
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()end;", ctx->opcodeMap[35]); // CLOSE
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()local fi=K[B];if type(fi)=='number' and _F[fi+1] then S[A]=_F[fi+1] else S[A]=function()end end end;", ctx->opcodeMap[36]); // CLOSURE
-    Append(script, size, capacity, buf);
-    
-    snprintf(buf, 2048, "H[%d]=function()end;", ctx->opcodeMap[37]); // VARARG
-    Append(script, size, capacity, buf);
+    emitHandler(script, size, capacity, ctx, OP_MOVE, "S[A]=S[B]");
+    emitHandler(script, size, capacity, ctx, OP_LOADK, "S[A]=K[B]");
+    emitHandler(script, size, capacity, ctx, OP_LOADBOOL, "S[A]=(B==1);if C==1 then pc=pc+1 end");
+    emitHandler(script, size, capacity, ctx, OP_LOADNIL, "for i=A,A+B do S[i]=nil end");
+    emitHandler(script, size, capacity, ctx, OP_GETUPVAL, "local u=U[B];S[A]=u[1][u[2]]");
+    emitHandler(script, size, capacity, ctx, OP_GETGLOBAL, "S[A]=G[K[B]]");
+    emitHandler(script, size, capacity, ctx, OP_GETTABLE, "local k=C>=256 and K[C-256] or S[C];S[A]=S[B][k]");
+    emitHandler(script, size, capacity, ctx, OP_SETGLOBAL, "G[K[B]]=S[A]");
+    emitHandler(script, size, capacity, ctx, OP_SETUPVAL, "local u=U[B];u[1][u[2]]=S[A]");
+    emitHandler(script, size, capacity, ctx, OP_SETTABLE, "local k=B>=256 and K[B-256] or S[B];local v=C>=256 and K[C-256] or S[C];S[A][k]=v");
+    emitHandler(script, size, capacity, ctx, OP_NEWTABLE, "S[A]={}");
+    emitHandler(script, size, capacity, ctx, OP_SELF, "local k=C>=256 and K[C-256] or S[C];S[A+1]=S[B];S[A]=S[B][k]");
+    emitHandler(script, size, capacity, ctx, OP_ADD, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];S[A]=b+c");
+    emitHandler(script, size, capacity, ctx, OP_SUB, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];S[A]=b-c");
+    emitHandler(script, size, capacity, ctx, OP_MUL, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];S[A]=b*c");
+    emitHandler(script, size, capacity, ctx, OP_DIV, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];S[A]=b/c");
+    emitHandler(script, size, capacity, ctx, OP_MOD, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];S[A]=b%c");
+    emitHandler(script, size, capacity, ctx, OP_POW, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];S[A]=b^c");
+    emitHandler(script, size, capacity, ctx, OP_UNM, "S[A]=-S[B]");
+    emitHandler(script, size, capacity, ctx, OP_NOT, "S[A]=not S[B]");
+    emitHandler(script, size, capacity, ctx, OP_LEN, "S[A]=#S[B]");
+    emitHandler(script, size, capacity, ctx, OP_CONCAT, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];S[A]=b..c");
+    emitHandler(script, size, capacity, ctx, OP_JMP, "pc=pc+B");
+    emitHandler(script, size, capacity, ctx, OP_EQ, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];if (b==c)~=(A==1) then pc=pc+1 end");
+    emitHandler(script, size, capacity, ctx, OP_LT, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];if (b<c)~=(A==1) then pc=pc+1 end");
+    emitHandler(script, size, capacity, ctx, OP_LE, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];if (b<=c)~=(A==1) then pc=pc+1 end");
+    emitHandler(script, size, capacity, ctx, OP_TEST, "if (not S[A])==(C==1) then pc=pc+1 end");
+    emitHandler(script, size, capacity, ctx, OP_TESTSET, "if (not S[B])==(C==1) then pc=pc+1 else S[A]=S[B] end");
+    emitHandler(script, size, capacity, ctx, OP_CALL, "local n=B-1;if B==0 then n=TP-A-1 end;local r=PK(S[A](unpack(S,A+1,A+n)));local m=C-1;if C==0 then m=r.n;TP=A+m end;for i=1,m do S[A+i-1]=r[i] end");
+    emitHandler(script, size, capacity, ctx, OP_TAILCALL, "local n=B-1;if B==0 then n=TP-A-1 end;RV=PK(S[A](unpack(S,A+1,A+n)));RN=RV.n;pc=IN+1");
+    emitHandler(script, size, capacity, ctx, OP_RETURN, "RN=B-1;if B==0 then RN=TP-A end;for i=1,RN do RV[i]=S[A+i-1] end;pc=IN+1");
+    emitHandler(script, size, capacity, ctx, OP_FORLOOP, "S[A]=S[A]+S[A+2];if S[A+2]>0 then if S[A]<=S[A+1] then S[A+3]=S[A];pc=pc-B end else if S[A]>=S[A+1] then S[A+3]=S[A];pc=pc-B end end");
+    emitHandler(script, size, capacity, ctx, OP_FORPREP, "S[A]=S[A]-S[A+2];S[A+3]=S[A];pc=pc+B");
+    emitHandler(script, size, capacity, ctx, OP_TFORLOOP, "local r={S[A](S[A+1],S[A+2])};for i=1,C do S[A+2+i]=r[i] end;if r[1]~=nil then S[A+2]=r[1];pc=pc+1 end");
+    emitHandler(script, size, capacity, ctx, OP_SETLIST, "local n=B;if B==0 then n=TP-A-1 end;local t,o=S[A],(C-1)*50;for i=1,n do t[o+i]=S[A+i] end");
+    emitHandler(script, size, capacity, ctx, OP_CLOSE, "for i,u in pairs(O) do if i>=A then u[1]={u[1][u[2]]};u[2]=1;O[i]=nil end end");
+    emitHandler(script, size, capacity, ctx, OP_CLOSURE, "local p=PP[B];local u={};for i,d in pairs(p[8]) do if d[1]==1 then local o=O[d[2]];if not o then o={S,d[2]};O[d[2]]=o end;u[i]=o else u[i]=U[d[2]] end end;S[A]=function(...)return X(p,u,...)end");
+    emitHandler(script, size, capacity, ctx, OP_VARARG, "local n=B-1;if B==0 then n=VN-P[7];if n<0 then n=0 end;TP=A+n end;for i=1,n do S[A+i-1]=V[P[7]+i] end");
+    
+    // Superinstructions: the second half of the pair is read from the next slot,
+    // which stays a plain instruction for jumps that land on it
+    emitHandler(script, size, capacity, ctx, OP_GETGLOBAL_CALL, "S[A]=G[K[B]];local a,b,c=IA[pc],IB[pc],IC[pc];pc=pc+1;local n=b-1;if b==0 then n=TP-a-1 end;local r=PK(S[a](unpack(S,a+1,a+n)));local m=c-1;if c==0 then m=r.n;TP=a+m end;for i=1,m do S[a+i-1]=r[i] end");
+    emitHandler(script, size, capacity, ctx, OP_SELF_CALL, "local k=C>=256 and K[C-256] or S[C];S[A+1]=S[B];S[A]=S[B][k];local a,b,c=IA[pc],IB[pc],IC[pc];pc=pc+1;local n=b-1;if b==0 then n=TP-a-1 end;local r=PK(S[a](unpack(S,a+1,a+n)));local m=c-1;if c==0 then m=r.n;TP=a+m end;for i=1,m do S[a+i-1]=r[i] end");
+    emitHandler(script, size, capacity, ctx, OP_GETTABLE_GETTABLE, "local k=C>=256 and K[C-256] or S[C];S[A]=S[B][k];local a,b,c=IA[pc],IB[pc],IC[pc];pc=pc+1;k=c>=256 and K[c-256] or S[c];S[a]=S[b][k]");
+    emitHandler(script, size, capacity, ctx, OP_LOADK_SETTABLE, "S[A]=K[B];local a,b,c=IA[pc],IB[pc],IC[pc];pc=pc+1;local k=b>=256 and K[b-256] or S[b];local v=c>=256 and K[c-256] or S[c];S[a][k]=v");
+    emitHandler(script, size, capacity, ctx, OP_EQ_JMP, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];if (b==c)~=(A==1) then pc=pc+1 else pc=pc+1+IB[pc] end");
+    emitHandler(script, size, capacity, ctx, OP_LT_JMP, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];if (b<c)~=(A==1) then pc=pc+1 else pc=pc+1+IB[pc] end");
+    emitHandler(script, size, capacity, ctx, OP_LE_JMP, "local b=B>=256 and K[B-256] or S[B];local c=C>=256 and K[C-256] or S[C];if (b<=c)~=(A==1) then pc=pc+1 else pc=pc+1+IB[pc] end");
+    emitHandler(script, size, capacity, ctx, OP_TEST_JMP, "if (not S[A])==(C==1) then pc=pc+1 else pc=pc+1+IB[pc] end");
     
     // Add fake handlers for noise
     for (int i = 0; i < 8; i++) {
-        int fakeOp = ctx->opcodeMap[RandomInt(50, 200)];
-        snprintf(buf, 512, "H[%d]=function()local _=%d end;", fakeOp, RandomInt(1,1000));
+        int fakeOp = ctx->opcodeMap[RandomInt(ctx->obf, 50, 200)];
+        snprintf(buf, 512, "H[%d]=function()local _=%d end;", fakeOp, RandomInt(ctx->obf, 1,1000));
         Append(script, size, capacity, buf);
     }
     
@@ -352,24 +312,24 @@ void GenerateDispatcher(char** script, int* size, int* capacity, BuildContext* c
     char buf[512];
     
     // Read B and C as 2 bytes each (little endian), with B as signed for jumps
-    const char* readBC = "local op=rb();local A=rb();local B=rb()+rb()*256;if B>=32768 then B=B-65536 end;local C=rb()+rb()*256;";
+    // Fetch from the decoded instruction arrays; jumps move pc by instructions
+    const char* readBC = "local op,A,B,C=IO[pc],IA[pc],IB[pc],IC[pc];pc=pc+1;";
     
     switch (ctx->dispatcherVariant % 3) {
         case 0: // Standard while - most reliable
-            snprintf(buf, 512, "while pos<=#D do %s", readBC);
+            snprintf(buf, 512, "while pc<=IN do %s", readBC);
             break;
-        case 1: // For with break
+        case 1: // Unbounded for with break (an iteration cap would cut long scripts short)
             snprintf(buf, 512,
-                "for _i=1,%d do "
-                "if pos>#D then break;end;%s",
-                RandomInt(50000,100000), readBC);
+                "for _i=%d,math.huge do "
+                "if pc>IN then break;end;%s",
+                RandomInt(ctx->obf, 1, 1000), readBC);
             break;
-        default: // Counter-based
+        default: // Endless while with an exit test
             snprintf(buf, 512,
-                "local _c=0;"
-                "while pos<=#D do "
-                "_c=_c+1;if _c>%d then break;end;%s",
-                RandomInt(10000,50000), readBC);
+                "while true do "
+                "if pc>IN then break;end;%s",
+                readBC);
             break;
     }
     
@@ -470,7 +430,7 @@ void GenerateAntiTamper(char** script, int* size, int* capacity, BuildContext* c
         "for i=1,math.min(#s,%d)do h=bit32.bxor(h*%d,string.byte(s,i));end;"
         "return h;"
         "end;",
-        ctx->checksumSeed, RandomInt(50,200), RandomInt(17,37));
+        ctx->checksumSeed, RandomInt(ctx->obf, 50,200), RandomInt(ctx->obf, 17,37));
     
     Append(script, size, capacity, buf);
 }
@@ -494,12 +454,12 @@ void GenerateAntiDump(char** script, int* size, int* capacity, BuildContext* ctx
     char buf[8192];
     
     // Create hidden variables for everything
-    char* b32 = GenerateRandomString(2);  // bit32 alias
-    char* sc = GenerateRandomString(2);   // string.char alias
-    char* df = GenerateRandomString(2);   // decode function
-    char* rg = GenerateRandomString(2);   // rawget alias
-    char* tp = GenerateRandomString(2);   // type alias  
-    int xorKey = RandomInt(50, 200);
+    char* b32 = GenerateRandomString(ctx->obf, 2);  // bit32 alias
+    char* sc = GenerateRandomString(ctx->obf, 2);   // string.char alias
+    char* df = GenerateRandomString(ctx->obf, 2);   // decode function
+    char* rg = GenerateRandomString(ctx->obf, 2);   // rawget alias
+    char* tp = GenerateRandomString(ctx->obf, 2);   // type alias  
+    int xorKey = RandomInt(ctx->obf, 50, 200);
     
     // Use standard libs, rawget/type directly (detection strings are hidden)
     snprintf(buf, 8192,
@@ -522,9 +482,9 @@ void GenerateAntiDump(char** script, int* size, int* capacity, BuildContext* ctx
     GenerateXorObfuscatedString(s3, 256, "saveinstance", xorKey, df);
     GenerateXorObfuscatedString(fnStr, 256, "function", xorKey, df);
     
-    char* v1 = GenerateRandomString(2);
-    char* v2 = GenerateRandomString(2);
-    char* fn = GenerateRandomString(2);
+    char* v1 = GenerateRandomString(ctx->obf, 2);
+    char* v2 = GenerateRandomString(ctx->obf, 2);
+    char* fn = GenerateRandomString(ctx->obf, 2);
     
     snprintf(buf, 8192,
         "local %s=%s;"
@@ -555,12 +515,12 @@ void GenerateAntiDebug(char** script, int* size, int* capacity, BuildContext* ct
     char buf[8192];
     
     // Create hidden variables for everything - different names than anti-dump
-    char* b32 = GenerateRandomString(2);  // bit32 alias
-    char* sc = GenerateRandomString(2);   // string.char alias
-    char* df = GenerateRandomString(2);   // decode function
-    char* rg = GenerateRandomString(2);   // rawget alias
-    char* tp = GenerateRandomString(2);   // type alias
-    int xorKey = RandomInt(80, 180);
+    char* b32 = GenerateRandomString(ctx->obf, 2);  // bit32 alias
+    char* sc = GenerateRandomString(ctx->obf, 2);   // string.char alias
+    char* df = GenerateRandomString(ctx->obf, 2);   // decode function
+    char* rg = GenerateRandomString(ctx->obf, 2);   // rawget alias
+    char* tp = GenerateRandomString(ctx->obf, 2);   // type alias
+    int xorKey = RandomInt(ctx->obf, 80, 180);
     
     // Use standard libs, rawget/type directly (detection strings are hidden)
     snprintf(buf, 8192,
@@ -588,9 +548,9 @@ void GenerateAntiDebug(char** script, int* size, int* capacity, BuildContext* ct
     GenerateXorObfuscatedString(gi, 256, "getinfo", xorKey, df);
     GenerateXorObfuscatedString(fnStr, 256, "function", xorKey, df);
     
-    char* d1 = GenerateRandomString(2);
-    char* d2 = GenerateRandomString(2);
-    char* giv = GenerateRandomString(2);
+    char* d1 = GenerateRandomString(ctx->obf, 2);
+    char* d2 = GenerateRandomString(ctx->obf, 2);
+    char* giv = GenerateRandomString(ctx->obf, 2);
     
     snprintf(buf, 8192,
         "local %s=%s;"
@@ -608,8 +568,8 @@ void GenerateAntiDebug(char** script, int* size, int* capacity, BuildContext* ct
     Append(script, size, capacity, buf);
     
     // Second check
-    char* d3 = GenerateRandomString(2);
-    char* fn = GenerateRandomString(2);
+    char* d3 = GenerateRandomString(ctx->obf, 2);
+    char* fn = GenerateRandomString(ctx->obf, 2);
     
     snprintf(buf, 8192,
         "local %s=%s;"
@@ -636,58 +596,193 @@ void GenerateAntiDebug(char** script, int* size, int* capacity, BuildContext* ct
     free(fn);
 }
 
-// Serialize bytecode with shuffled opcodes
-char* SerializeBytecodeWithMapping(BytecodeChunk* chunk, BuildContext* ctx) {
-    // Calculate size needed
-    int dataSize = 1; // version byte
-    dataSize += 1; // constant count
-    for (int i = 0; i < chunk->ConstantCount; i++) {
-        dataSize += 2; // string length (2 bytes)
-        dataSize += strlen(chunk->Constants[i]); // string data
+// Keystream for the watermark constant, keyed by the build id the script
+// prints as _B so ExtractWatermark can undo it from the output alone
+static void cryptWatermark(unsigned char* data, size_t length, int buildId) {
+    unsigned long long state = 0x574D4B31ULL ^ ((unsigned long long)buildId << 32);
+    unsigned long long word = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (i % 8 == 0) {
+            word = (state += 0x9E3779B97F4A7C15ULL);
+            word = (word ^ (word >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            word = (word ^ (word >> 27)) * 0x94D049BB133111EBULL;
+            word ^= word >> 31;
+        }
+        data[i] ^= (unsigned char)(word >> (8 * (i % 8)));
     }
-    dataSize += chunk->Count * 6; // instructions (6 bytes each: op, A, B(2), C(2))
-    
-    unsigned char* buffer = (unsigned char*)malloc(dataSize);
+}
+
+// Serialize bytecode with shuffled opcodes (no watermark; see encodePayload).
+// *constantsEnd receives the offset just past the main prototype's constants.
+static unsigned char* serializeBytecode(const BytecodeChunk* chunk, BuildContext* ctx,
+                                        int* length, int* constantsEnd) {
+    unsigned char* buffer = (unsigned char*)malloc(1 + PrototypeSize(chunk));
     int pos = 0;
     
     // Version
-    buffer[pos++] = 0x01;
-    
-    // Constants - use 2 bytes for length
-    buffer[pos++] = (unsigned char)chunk->ConstantCount;
-    for (int i = 0; i < chunk->ConstantCount; i++) {
-        int len = strlen(chunk->Constants[i]);
-        buffer[pos++] = (unsigned char)(len & 0xFF);
-        buffer[pos++] = (unsigned char)((len >> 8) & 0xFF);
-        memcpy(buffer + pos, chunk->Constants[i], len);
-        pos += len;
-    }
+    buffer[pos++] = BYTECODE_VERSION;
     
-    // Instructions with SHUFFLED opcodes
-    for (int i = 0; i < chunk->Count; i++) {
-        // Apply opcode mapping - transform real opcode to shuffled value
-        int realOp = chunk->Instructions[i].Op;
-        int shuffledOp = ctx->opcodeMap[realOp];
-        
-        buffer[pos++] = (unsigned char)shuffledOp;  // Use shuffled opcode!
-        buffer[pos++] = (unsigned char)chunk->Instructions[i].A;
-        // B as 2 bytes (little endian)
-        buffer[pos++] = (unsigned char)(chunk->Instructions[i].B & 0xFF);
-        buffer[pos++] = (unsigned char)((chunk->Instructions[i].B >> 8) & 0xFF);
-        // C as 2 bytes (little endian)
-        buffer[pos++] = (unsigned char)(chunk->Instructions[i].C & 0xFF);
-        buffer[pos++] = (unsigned char)((chunk->Instructions[i].C >> 8) & 0xFF);
-    }
+    // Prototype tree with SHUFFLED opcodes
+    pos += WritePrototype(buffer + pos, chunk, ctx->opcodeMap, constantsEnd);
+    *constantsEnd += 1;
     
-    // Encode to Base85
+    *length = pos;
+    return buffer;
+}
+
+// Base85 payload for a build. A watermark rides along as one extra,
+// encrypted string constant after the real ones (BYTECODE_VERSION_WATERMARK);
+// the VM loads it into K like any other constant and never references it.
+static char* encodePayload(const ScriptParts* parts, const char* watermark, size_t watermarkLength) {
+    if (!watermark || watermarkLength == 0) {
+        return EncodeBase85Custom(parts->payload, parts->payloadLength);
+    }
+
+    // The count grows by one, which may lengthen its varint
+    unsigned int count = 0;
+    int countEnd = 1;
+    if (!ReadVarint(parts->payload, parts->constantsEnd, &countEnd, &count)) return NULL;
+
+    int length = parts->payloadLength + 1 + 1 + VarintSize((unsigned int)watermarkLength) +
+                 (int)watermarkLength;
+    unsigned char* buffer = (unsigned char*)malloc(length);
+    if (!buffer) return NULL;
+
+    int pos = 0;
+    buffer[pos++] = BYTECODE_VERSION_WATERMARK;
+    pos += WriteVarint(buffer + pos, count + 1);
+    memcpy(buffer + pos, parts->payload + countEnd, parts->constantsEnd - countEnd);
+    pos += parts->constantsEnd - countEnd;
+
+    buffer[pos++] = KTAG_STRING;
+    pos += WriteVarint(buffer + pos, (unsigned int)watermarkLength);
+    memcpy(buffer + pos, watermark, watermarkLength);
+    cryptWatermark(buffer + pos, watermarkLength, parts->buildId);
+    pos += (int)watermarkLength;
+
+    memcpy(buffer + pos, parts->payload + parts->constantsEnd,
+           parts->payloadLength - parts->constantsEnd);
+    pos += parts->payloadLength - parts->constantsEnd;
+
     char* encoded = EncodeBase85Custom(buffer, pos);
     free(buffer);
-    
     return encoded;
 }
 
-char* GenerateObfuscatedScript(BytecodeChunk* chunk) {
-    BuildContext* ctx = CreateBuildContext();
+char* AssembleScript(const ScriptParts* parts, const char* watermark, size_t watermarkLength) {
+    char* encoded = encodePayload(parts, watermark, watermarkLength);
+    if (!encoded) return NULL;
+
+    size_t textLength = strlen(parts->text);
+    size_t encodedLength = strlen(encoded);
+    char* script = (char*)malloc(textLength + encodedLength + 1);
+    if (script) {
+        memcpy(script, parts->text, parts->splitAt);
+        memcpy(script + parts->splitAt, encoded, encodedLength);
+        memcpy(script + parts->splitAt + encodedLength, parts->text + parts->splitAt,
+               textLength - parts->splitAt + 1);
+    }
+    free(encoded);
+    return script;
+}
+
+void FreeScriptParts(ScriptParts* parts) {
+    if (!parts) return;
+    free(parts->text);
+    free(parts->payload);
+    free(parts);
+}
+
+// Find the payload and build id in a generated script and decrypt its watermark
+int ExtractWatermark(const char* script, size_t length, char* out, size_t outSize) {
+    const char* open = "local enc=([=[";
+    const char* start = NULL;
+    for (size_t i = 0; i + 14 <= length; i++) {
+        if (memcmp(script + i, open, 14) == 0) {
+            start = script + i + 14;
+            break;
+        }
+    }
+    if (!start) return -1;
+
+    const char* end = start;
+    while (end + 3 <= script + length && memcmp(end, "]=]", 3) != 0) end++;
+    if (end + 3 > script + length) return -1;
+
+    // _B=<id>, is emitted after the VM function, so take the last one
+    // (script need not be NUL-terminated, so stay within length)
+    const char* limit = script + length;
+    const char* tag = NULL;
+    for (const char* p = limit - 4; p > end; p--) {
+        if (memcmp(p, "_B=", 3) == 0 && isdigit((unsigned char)p[3])) {
+            tag = p + 3;
+            break;
+        }
+    }
+    if (!tag) return -1;
+    int buildId = 0;
+    while (tag < limit && isdigit((unsigned char)*tag)) buildId = buildId * 10 + (*tag++ - '0');
+
+    int dataLen = 0;
+    unsigned char* data = DecodeBase85Custom(start, (int)(end - start), &dataLen);
+    if (!data) return -1;
+
+    int result = -1;
+    int pos = 1;
+    unsigned int count = 0;
+    if (dataLen >= 2 && data[0] == BYTECODE_VERSION_WATERMARK &&
+        ReadVarint(data, dataLen, &pos, &count)) {
+        for (unsigned int i = 0; i < count && pos < dataLen; i++) {
+            int tag = data[pos++];
+            unsigned int len;
+            if (tag == KTAG_STRING) {
+                if (!ReadVarint(data, dataLen, &pos, &len)) break;
+            } else {
+                len = tag == KTAG_INT ? 4 : tag == KTAG_DOUBLE ? 8 : 0;
+            }
+            if (len > (unsigned int)(dataLen - pos)) break;
+            if (i == count - 1 && tag == KTAG_STRING) {
+                cryptWatermark(data + pos, len, buildId);
+                size_t copy = (size_t)len < outSize ? (size_t)len : outSize - 1;
+                if (outSize > 0) {
+                    memcpy(out, data + pos, copy);
+                    out[copy] = '\0';
+                }
+                result = (int)len;
+            }
+            pos += len;
+        }
+    }
+
+    free(data);
+    return result;
+}
+
+char* GenerateObfuscatedScript(const BytecodeChunk* chunk, const char* watermark,
+                                size_t watermarkLength, ObfContext* obf) {
+    ScriptParts* parts = GenerateScriptParts(chunk, obf);
+    if (!parts) return NULL;
+
+    char* script = AssembleScript(parts, watermark, watermarkLength);
+    FreeScriptParts(parts);
+    return script;
+}
+
+// Drops a half-built script once its job is cancelled or out of time
+static int stopBuild(ObfContext* obf, ScriptParts* parts, char* script, BuildContext* ctx) {
+    if (ContextState(obf) == CONTEXT_RUNNING) return 0;
+    free(script);
+    free(ctx);
+    FreeScriptParts(parts);
+    return 1;
+}
+
+ScriptParts* GenerateScriptParts(const BytecodeChunk* chunk, ObfContext* obf) {
+    ScriptParts* parts = (ScriptParts*)calloc(1, sizeof(ScriptParts));
+    if (!parts) return NULL;
+
+    BuildContext* ctx = CreateBuildContext(obf);
+    markUsedOpcodes(chunk, ctx->usedOps);
     int capacity = 65536;
     int size = 0;
     char* script = (char*)malloc(capacity);
@@ -698,44 +793,22 @@ char* GenerateObfuscatedScript(BytecodeChunk* chunk) {
     // (Temporarily disabled for stability - enable one by one)
     
     // 1. Insert junk code into bytecode
-    // InsertJunkCode(chunk);
+    // InsertJunkCode(chunk, obf);
     
     // 2. Apply control flow flattening
     // ApplyControlFlowFlattening(chunk);
     
     // 3. Apply code virtualization (add virtual opcodes)
-    // ApplyCodeVirtualization(chunk);
+    // ApplyCodeVirtualization(chunk, obf);
     
     // 4. Insert anti-decompiler traps
-    // InsertAntiDecompilerTraps(chunk);
-    
-    // Extract functions from constants (those with __lua__ prefix)
-    int funcCount = 0;
-    char* funcCodes[256];
-    char* originalConstants[256]; // Store original pointers
-    for (int i = 0; i < chunk->ConstantCount; i++) {
-        originalConstants[i] = chunk->Constants[i];
-        if (chunk->Constants[i] && strlen(chunk->Constants[i]) > 7 && 
-            strncmp(chunk->Constants[i], "__lua__", 7) == 0) {
-            funcCodes[funcCount] = chunk->Constants[i] + 7; // Skip __lua__ prefix
-            // Replace constant with function index (as string number)
-            char indexStr[16];
-            snprintf(indexStr, sizeof(indexStr), "%d", funcCount);
-            chunk->Constants[i] = strdup(indexStr);
-            funcCount++;
-        }
-    }
-
-    // Serialize bytecode to Base85 with SHUFFLED opcodes
-    char* encodedData = SerializeBytecodeWithMapping(chunk, ctx);
+    // InsertAntiDecompilerTraps(chunk, obf);
     
-    // Restore original constants (for cleanup)
-    for (int i = 0; i < chunk->ConstantCount; i++) {
-        if (chunk->Constants[i] != originalConstants[i]) {
-            free(chunk->Constants[i]); // Free the strdup'd index string
-        }
-        chunk->Constants[i] = originalConstants[i];
-    }
+    // Serialize bytecode to Base85 with SHUFFLED opcodes
+    parts->payload = serializeBytecode(chunk, ctx, &parts->payloadLength, &parts->constantsEnd);
+    parts->buildId = ctx->buildId;
+    parts->seed = obf->seed;
+    if (stopBuild(obf, parts, script, ctx)) return NULL;
     
     // Add watermark
     Append(&script, &size, &capacity, "-- This file was protected using Luraph Obfuscator v14.4.2 [https://lura.ph/]\n");
@@ -747,7 +820,7 @@ char* GenerateObfuscatedScript(BytecodeChunk* chunk) {
     const char* libs[] = {"C=table.move,", "U=bit32,", "V=coroutine,", "G=tostring,", "z=getfenv,", "M=math,", "S=string,"};
     int libOrder[] = {0, 1, 2, 3, 4, 5, 6};
     for (int i = 6; i > 0; i--) {
-        int j = RandomInt(0, i);
+        int j = RandomInt(obf, 0, i);
         int t = libOrder[i]; libOrder[i] = libOrder[j]; libOrder[j] = t;
     }
     
@@ -757,10 +830,10 @@ char* GenerateObfuscatedScript(BytecodeChunk* chunk) {
     }
     
     // Generate smart noise functions (first batch)
-    int numNoise1 = RandomInt(8, 15);
+    int numNoise1 = RandomInt(obf, 8, 15);
     for (int i = 0; i < numNoise1; i++) {
-        char* name = GenerateRandomString(RandomInt(1, 2));
-        GenerateSmartNoise(&script, &size, &capacity, name, RandomInt(0, MAX_DUMMY_PATTERNS));
+        char* name = GenerateRandomString(obf, RandomInt(obf, 1, 2));
+        GenerateSmartNoise(&script, &size, &capacity, name, RandomInt(obf, 0, MAX_DUMMY_PATTERNS), obf);
         free(name);
     }
     
@@ -770,10 +843,10 @@ char* GenerateObfuscatedScript(BytecodeChunk* chunk) {
     }
     
     // Generate smart noise functions (second batch)
-    int numNoise2 = RandomInt(5, 10);
+    int numNoise2 = RandomInt(obf, 5, 10);
     for (int i = 0; i < numNoise2; i++) {
-        char* name = GenerateRandomString(RandomInt(1, 2));
-        GenerateSmartNoise(&script, &size, &capacity, name, RandomInt(0, MAX_DUMMY_PATTERNS));
+        char* name = GenerateRandomString(obf, RandomInt(obf, 1, 2));
+        GenerateSmartNoise(&script, &size, &capacity, name, RandomInt(obf, 0, MAX_DUMMY_PATTERNS), obf);
         free(name);
     }
     
@@ -790,55 +863,58 @@ char* GenerateObfuscatedScript(BytecodeChunk* chunk) {
     GenerateAntiDebug(&script, &size, &capacity, ctx);
     
     // Add opaque predicates (confuse static analysis)
-    InsertOpaquePredicates(&script, &size, &capacity);
+    InsertOpaquePredicates(&script, &size, &capacity, obf);
     
     // Add anti-decompiler patterns
-    GenerateAntiDecompilerPatterns(&script, &size, &capacity);
+    GenerateAntiDecompilerPatterns(&script, &size, &capacity, obf);
     
     // Add junk code patterns
-    GenerateJunkPatterns(&script, &size, &capacity, RandomInt(3, 6));
+    GenerateJunkPatterns(&script, &size, &capacity, RandomInt(obf, 3, 6), obf);
     
     // === NEW ADVANCED FEATURES ===
     
     // Multi-layer VM wrapper
-    GenerateMultiLayerVM(&script, &size, &capacity);
+    GenerateMultiLayerVM(&script, &size, &capacity, obf);
     
     // Constant encryption
-    GenerateConstantEncryption(&script, &size, &capacity);
+    GenerateConstantEncryption(&script, &size, &capacity, obf);
     
     // === ULTRA ADVANCED FEATURES (Roblox-safe) ===
     
     // Nested VM wrapper (sandboxed environment)
-    GenerateNestedVMWrapper(&script, &size, &capacity);
+    GenerateNestedVMWrapper(&script, &size, &capacity, obf);
     
     // Inner VM dispatchers (state machines)
-    GenerateInnerVMDispatcher(&script, &size, &capacity, 1);
-    GenerateInnerVMDispatcher(&script, &size, &capacity, 2);
+    GenerateInnerVMDispatcher(&script, &size, &capacity, 1, obf);
+    GenerateInnerVMDispatcher(&script, &size, &capacity, 2, obf);
     
     // Metamorphic code (self-changing patterns)
-    GenerateMetamorphicCode(&script, &size, &capacity);
+    GenerateMetamorphicCode(&script, &size, &capacity, obf);
     
     // Self-modifying patterns
-    GenerateSelfModifyingPatterns(&script, &size, &capacity);
+    GenerateSelfModifyingPatterns(&script, &size, &capacity, obf);
     
     // Bytecode encryption layer
-    GenerateBytecodeEncryption(&script, &size, &capacity, ctx->encKey);
+    GenerateBytecodeEncryption(&script, &size, &capacity, ctx->encKey, obf);
     
     // Native-like optimized patterns
-    GenerateNativePatterns(&script, &size, &capacity);
+    GenerateNativePatterns(&script, &size, &capacity, obf);
     
     // Robust anti-tamper with integrity checks
-    char* robustTamper = GenerateRobustAntiTamper(ctx->buildId);
+    char* robustTamper = GenerateRobustAntiTamper(ctx->buildId, obf);
     Append(&script, &size, &capacity, robustTamper);
     free(robustTamper);
     
     // Timing-based anti-debug
-    char* timingCheck = GenerateTimingCheck();
+    char* timingCheck = GenerateTimingCheck(obf);
     Append(&script, &size, &capacity, timingCheck);
     free(timingCheck);
     
+    if (stopBuild(obf, parts, script, ctx)) return NULL;
+    
+    // The encoded payload is spliced in here by AssembleScript
     Append(&script, &size, &capacity, "local enc=([=[");
-    Append(&script, &size, &capacity, encodedData);
+    parts->splitAt = size;
     Append(&script, &size, &capacity, "]=]);");
     
     // Generate Base85 decoder
@@ -855,29 +931,54 @@ char* GenerateObfuscatedScript(BytecodeChunk* chunk) {
     Append(&script, &size, &capacity, 
         "local function rb()local b=string.byte(D,pos);pos=pos+1;return b or 0;end;");
     
-    // Read string function - 2 bytes for length
+    // LEB128 varint (counts, lengths, operands)
     Append(&script, &size, &capacity,
-        "local function rs()local n=rb()+rb()*256;local s=string.sub(D,pos,pos+n-1);pos=pos+n;return s;end;");
+        "local function rv()local v,m=0,1;repeat local b=rb();v=v+(b%128)*m;m=m*128 until b<128;return v;end;");
     
-    // Load constants - convert numeric strings to numbers
+    // Read string function - varint length
     Append(&script, &size, &capacity,
-        "local _=rb();local K={};local cc=rb();for i=1,cc do local s=rs();local n=tonumber(s);if n then K[i-1]=n else K[i-1]=s end;end;");
-    
-    // Stack and environment
-    Append(&script, &size, &capacity, "local S={};local G=getfenv();");
-    
-    // Generate pre-defined functions table (zero loadstring approach)
-    if (funcCount > 0) {
-        Append(&script, &size, &capacity, "local _F={");
-        for (int i = 0; i < funcCount; i++) {
-            if (i > 0) Append(&script, &size, &capacity, ",");
-            // Output the function code directly
-            Append(&script, &size, &capacity, funcCodes[i]);
-        }
-        Append(&script, &size, &capacity, "};");
-    } else {
-        Append(&script, &size, &capacity, "local _F={};");
-    }
+        "local function rs()local n=rv();local s=string.sub(D,pos,pos+n-1);pos=pos+n;return s;end;");
+    
+    // int32 and IEEE binary64 constants, little endian
+    Append(&script, &size, &capacity,
+        "local function ri()local v=rb()+rb()*256+rb()*65536+rb()*16777216;if v>=2147483648 then v=v-4294967296 end;return v;end;"
+        "local function rd()local lo=rb()+rb()*256+rb()*65536+rb()*16777216;local hi=rb()+rb()*256+rb()*65536+rb()*16777216;"
+        "local sg=1;if hi>=2147483648 then sg=-1;hi=hi-2147483648 end;"
+        "local e=math.floor(hi/1048576);local m=(hi%1048576)*4294967296+lo;"
+        "if e==2047 then if m==0 then return sg/0 end;return 0/0 end;"
+        "if e==0 then return sg*math.ldexp(m,-1074) end;"
+        "return sg*math.ldexp(m+4503599627370496,e-1075);end;");
+    
+    // Read a prototype: constants by tag (nil leaves the slot empty), parameter
+    // count, frame size, upvalue sources, instructions decoded once, then its children
+    snprintf(buf, sizeof(buf),
+        "local function rp()local K,IO,IA,IB,IC,UV,PP={},{},{},{},{},{},{};"
+        "for i=1,rv() do local t=rb();"
+        "if t==%d then K[i-1]=rs() elseif t==%d then K[i-1]=ri() elseif t==%d then K[i-1]=rd() "
+        "elseif t==%d then K[i-1]=true elseif t==%d then K[i-1]=false end;end;"
+        "local np=rv();local ms=rv();for i=1,rv() do UV[i-1]={rb(),rv()} end;"
+        "local n=rv();for i=1,n do IO[i]=rb();IA[i]=rv();"
+        "local b=rv();if b%%2==1 then b=-(b+1)/2 else b=b/2 end;IB[i]=b;IC[i]=rv();end;"
+        "for i=1,rv() do PP[i-1]=rp() end;"
+        "return {K,IO,IA,IB,IC,n,np,UV,PP,ms};end;",
+        KTAG_STRING, KTAG_INT, KTAG_DOUBLE, KTAG_TRUE, KTAG_FALSE);
+    Append(&script, &size, &capacity, buf);
+    
+    // Environment and the main prototype
+    Append(&script, &size, &capacity, "local _=rb();local MP=rp();local G=getfenv();"
+        "local TC=table.create or function()return {} end;"
+        "local function PK(...)return {n=select('#',...),...} end;");
+    
+    // One frame per call: registers S (presized to the frame), open upvalues O,
+    // varargs V (VN of them, nils included), and TP, one past the last value a
+    // C = 0 call or B = 0 vararg left. Upvalues are {table, key} cells shared
+    // with the frame that made them.
+    Append(&script, &size, &capacity,
+        "local function X(P,U,...)local K,IO,IA,IB,IC,IN,PP=P[1],P[2],P[3],P[4],P[5],P[6],P[9];"
+        "local S,O,V,VN=TC(P[10]),{},{...},select('#',...);for i=1,P[7] do S[i-1]=V[i] end;"
+        "local RV,RN,TP={},0,0;local pc=1;");
+    
+    if (stopBuild(obf, parts, script, ctx)) return NULL;
     
     // Generate dispatcher
     GenerateDispatcher(&script, &size, &capacity, ctx);
@@ -888,14 +989,18 @@ char* GenerateObfuscatedScript(BytecodeChunk* chunk) {
     // Close dispatcher
     GenerateDispatcherClose(&script, &size, &capacity, ctx);
     
+    // Close the frame function and run the main prototype
+    Append(&script, &size, &capacity, "return unpack(RV,1,RN);end;X(MP,{});");
+    
     // Close BW function
     Append(&script, &size, &capacity, "end,");
+    if (stopBuild(obf, parts, script, ctx)) return NULL;
     
     // Final batch of noise functions
-    int numNoise3 = RandomInt(3, 7);
+    int numNoise3 = RandomInt(obf, 3, 7);
     for (int i = 0; i < numNoise3; i++) {
-        char* name = GenerateRandomString(RandomInt(1, 2));
-        GenerateSmartNoise(&script, &size, &capacity, name, RandomInt(0, MAX_DUMMY_PATTERNS));
+        char* name = GenerateRandomString(obf, RandomInt(obf, 1, 2));
+        GenerateSmartNoise(&script, &size, &capacity, name, RandomInt(obf, 0, MAX_DUMMY_PATTERNS), obf);
         free(name);
     }
     
@@ -906,7 +1011,7 @@ char* GenerateObfuscatedScript(BytecodeChunk* chunk) {
     // Close and call
     Append(&script, &size, &capacity, "}):BW()");
     
-    free(encodedData);
     free(ctx);
-    return script;
+    parts->text = script;
+    return parts;
 }
@@ -1,105 +1,316 @@
 #include "../include/Common.h"
 #include "../include/Utils.h"
-#include "../include/BytecodeBuilder.h"
-#include "../include/VmGenerator.h"
-#include "../include/Compiler.h"
+#include "../include/Obfuscator.h"
+#include "../include/Server.h"
 
-// Full Lua parser using new compiler
-BytecodeChunk* ParseLuaFile(const char* filename) {
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Map a whole file read-only (size receives the byte count; release with
+// unmapFile). The contents are not NUL-terminated: everything downstream
+// takes a length, and the lexer reads them in place.
+static const char* mapFile(const char* filename, size_t* size) {
+#ifdef _WIN32
     FILE* f = fopen(filename, "rb");
     if (!f) {
         LogError("Cannot open file: %s", filename);
         return NULL;
     }
     
-    // Read file content
     fseek(f, 0, SEEK_END);
-    long size = ftell(f);
+    long length = ftell(f);
     fseek(f, 0, SEEK_SET);
     
-    char* content = (char*)malloc(size + 1);
-    fread(content, 1, size, f);
-    content[size] = '\0';
+    char* content = (char*)malloc(length + 1);
+    *size = fread(content, 1, length, f);
     fclose(f);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        LogError("Cannot open file: %s", filename);
+        return NULL;
+    }
     
-    // Normalize CRLF to LF
-    char* src = content;
-    char* dst = content;
-    while (*src) {
-        if (*src == '\r' && *(src + 1) == '\n') {
-            src++; // Skip \r, keep \n
-        } else {
-            *dst++ = *src++;
+    struct stat st;
+    const char* content = "";
+    *size = 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            LogError("Cannot map file: %s", filename);
+            return NULL;
         }
+        content = (const char*)map;
+        *size = (size_t)st.st_size;
     }
-    *dst = '\0';
-    size = dst - content;
-    
-    LogInfo("File size: %ld bytes", size);
+    close(fd);
+#endif
     
-    // Use the new full compiler
-    CompilerState* state = CreateCompilerState(content);
-    BytecodeChunk* chunk = Compile(state);
+    LogInfo("File size: %ld bytes", (long)*size);
+    return content;
+}
+
+static void unmapFile(const char* content, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    free((char*)content);
+#else
+    if (size > 0) munmap((void*)content, size);
+#endif
+}
+
+// Parse "--serve [--workers N] [--queue-depth N] [--cache N] [--pool N] [--pool-scripts N]"
+static int serve(int argc, char** argv) {
+    ServerConfig config;
+    memset(&config, 0, sizeof(config));
     
-    if (state->hadError || !chunk) {
-        LogError("Compilation failed: %s", state->errorMsg);
-        FreeCompilerState(state);
-        free(content);
-        return NULL;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--workers") == 0) {
+            config.workers = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--queue-depth") == 0) {
+            config.queueDepth = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            SetCompileCacheLimit(atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--pool") == 0) {
+            config.poolSize = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--pool-scripts") == 0) {
+            config.poolScripts = atoi(argv[i + 1]);
+        } else {
+            LogError("Unknown serve option: %s", argv[i]);
+            return 1;
+        }
     }
     
-    LogInfo("Compiled successfully: %d constants, %d instructions", 
-        chunk->ConstantCount, chunk->Count);
-    
-    FreeCompilerState(state);
-    free(content);
-    
-    return chunk;
+    return RunServer(&config);
+}
+
+// Print the watermark carried by an obfuscated script
+static int extractWatermark(const char* filename) {
+    size_t length = 0;
+    const char* script = mapFile(filename, &length);
+    if (!script) return 1;
+
+    char tag[1024];
+    int found = ExtractWatermark(script, length, tag, sizeof(tag));
+    unmapFile(script, length);
+
+    if (found < 0) {
+        LogError("No watermark found in %s", filename);
+        return 1;
+    }
+    printf("%s\n", tag);
+    return 0;
+}
+
+// Parse a --seed value (decimal, 0x hex or 0 octal). 0 is rejected because
+// every entry point reads a zero seed as "pick a random one"; 0 on failure.
+static unsigned long long parseSeed(const char* text) {
+    char* end = NULL;
+    errno = 0;
+    unsigned long long seed = strtoull(text, &end, 0);
+    if (end == text || *end != '\0' || errno == ERANGE || strchr(text, '-')) return 0;
+    return seed;
+}
+
+static int makeDir(const char* path) {
+#ifdef _WIN32
+    return _mkdir(path);
+#else
+    return mkdir(path, 0755);
+#endif
+}
+
+// Create dir and any missing parents; 0 once it exists and is writable
+static int ensureDir(const char* dir) {
+    char path[1024];
+    size_t len = strlen(dir);
+    if (len == 0 || len >= sizeof(path)) return -1;
+    memcpy(path, dir, len + 1);
+
+    for (size_t i = 1; i <= len; i++) {
+        if (path[i] != '/' && path[i] != '\\' && path[i] != '\0') continue;
+        char saved = path[i];
+        path[i] = '\0';
+        if (makeDir(path) != 0 && errno != EEXIST) return -1;
+        path[i] = saved;
+    }
+
+    struct stat st;
+    if (stat(dir, &st) != 0 || !(st.st_mode & S_IFDIR)) return -1;
+#ifdef _WIN32
+    return _access(dir, 2);
+#else
+    return access(dir, W_OK);
+#endif
+}
+
+// Build count variants of one input and save them as <outDir>/<name>.<i>.lua.
+// With a seed, variant i is built from seed + i.
+static int writeVariants(const char* inputFile, const char* source, size_t length, int count,
+                         const char* outDir, const ObfOptions* options) {
+    if (ensureDir(outDir) != 0) {
+        LogError("Cannot write to output directory: %s", outDir);
+        return 1;
+    }
+
+    ObfResult* results = (ObfResult*)calloc(count, sizeof(ObfResult));
+    unsigned long long* seeds = (unsigned long long*)calloc(count, sizeof(unsigned long long));
+    if (!results || !seeds) {
+        free(results);
+        free(seeds);
+        LogError("Out of memory");
+        return 1;
+    }
+    for (int i = 0; options->seed && i < count; i++) {
+        seeds[i] = options->seed + i;
+    }
+
+    // Output names reuse the input's file name without directory or extension
+    const char* name = inputFile;
+    for (const char* p = inputFile; *p; p++) {
+        if (*p == '/' || *p == '\\') name = p + 1;
+    }
+    int nameLen = (int)strlen(name);
+    if (nameLen > 4 && strcmp(name + nameLen - 4, ".lua") == 0) nameLen -= 4;
+
+    long long start = MonotonicMs();
+    ObfuscateVariants(source, length, count, seeds, options, results);
+    int built = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i].status == OBF_OK) built++;
+    }
+    LogInfo("Built %d of %d variants in %lld ms", built, count, MonotonicMs() - start);
+
+    int failed = 0;
+    char path[1024];
+    for (int i = 0; i < count; i++) {
+        if (results[i].status != OBF_OK) {
+            LogError("Variant %d: %s", i, results[i].errorMsg);
+            failed = 1;
+        } else {
+            snprintf(path, sizeof(path), "%s/%.*s.%d.lua", outDir, nameLen, name, i);
+            FILE* f = fopen(path, "w");
+            if (f) {
+                fwrite(results[i].output, 1, results[i].outputLength, f);
+                fclose(f);
+                LogInfo("%s (seed %llu)", path, results[i].seed);
+            } else {
+                LogError("Failed to save %s", path);
+                failed = 1;
+            }
+        }
+        FreeObfResult(&results[i]);
+    }
+
+    if (!failed) LogInfo("Saved %d variants to '%s'", count, outDir);
+    free(results);
+    free(seeds);
+    return failed;
 }
 
 int main(int argc, char** argv) {
-    SeedRandom();
+    if (argc >= 2 && strcmp(argv[1], "--serve") == 0) {
+        return serve(argc, argv);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--extract-watermark") == 0) {
+        SetLogStream(stderr);
+        return extractWatermark(argv[2]);
+    }
+    
     LogInfo("Starting Luau Obfuscator v2.0 (Advanced)...");
     LogInfo("Build features: Opcode Shuffling, Polymorphic VM, Smart Noise, Anti-Tamper");
 
-    BytecodeChunk* chunk = NULL;
+    const char* demoSource = "print(\"Hello World from Luau Obfuscator!\")";
+    const char* inputFile = NULL;
     char* outputFile = "Obfuscated.lua";
+    const char* outDir = ".";
+    int variants = 0;
+    ObfOptions options;
+    memset(&options, 0, sizeof(options));
+
+    // <input.lua> [output.lua] with options anywhere after the input
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--watermark") == 0 && i + 1 < argc) {
+            options.watermark = argv[++i];
+            options.watermarkLength = strlen(options.watermark);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = parseSeed(argv[++i]);
+            if (!options.seed) {
+                LogError("Invalid seed: %s (expected a nonzero integer)", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--variants") == 0 && i + 1 < argc) {
+            variants = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out-dir") == 0 && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            LogError("Unknown option: %s", argv[i]);
+            return 1;
+        } else if (!inputFile) {
+            inputFile = argv[i];
+        } else {
+            outputFile = argv[i];
+        }
+    }
 
-    if (argc < 2) {
-        LogInfo("Usage: Obfuscator.exe <input.lua> [output.lua]");
+    const char* content = NULL;
+    size_t contentLen = 0;
+
+    if (!inputFile) {
+        LogInfo("Usage: Obfuscator.exe <input.lua> [output.lua] [--seed N] [--watermark TEXT]");
+        LogInfo("       Obfuscator.exe <input.lua> --variants K [--out-dir DIR] [--seed N] [--watermark TEXT]");
+        LogInfo("       Obfuscator.exe --extract-watermark <obfuscated.lua>");
+        LogInfo("       Obfuscator.exe --serve [--workers N] [--queue-depth N] [--cache N]");
+        LogInfo("                              [--pool N] [--pool-scripts N]");
         LogInfo("Running Demo Mode: Obfuscating 'print(\"Hello World\")'");
-        
-        // Demo mode
-        chunk = CreateChunk();
-        AddConstant(chunk, "print");
-        AddConstant(chunk, "Hello World from Luau Obfuscator!");
-        AddInstruction(chunk, OP_GETGLOBAL, 0, 0, 0);
-        AddInstruction(chunk, OP_LOADK, 1, 1, 0);
-        AddInstruction(chunk, OP_CALL, 0, 1, 1);
     } else {
-        LogInfo("Input file: %s", argv[1]);
-        chunk = ParseLuaFile(argv[1]);
+        LogInfo("Input file: %s", inputFile);
+        content = mapFile(inputFile, &contentLen);
         
-        if (!chunk) {
-            LogError("Failed to parse input file");
+        if (!content) {
+            LogError("Failed to read input file");
             return 1;
         }
-        
-        if (argc >= 3) {
-            outputFile = argv[2];
-        }
+    }
+
+    if (variants > 0 && content) {
+        int rc = writeVariants(inputFile, content, contentLen, variants, outDir, &options);
+        unmapFile(content, contentLen);
+        return rc;
     }
 
     // Generate the obfuscated script
-    char* result = GenerateObfuscatedScript(chunk);
+    ObfResult result;
+    if (content) {
+        ObfuscateBuffer(content, contentLen, &options, &result);
+        unmapFile(content, contentLen);
+    } else {
+        ObfuscateBuffer(demoSource, strlen(demoSource), &options, &result);
+    }
+    
+    if (result.status != OBF_OK) {
+        LogError("%s", result.errorMsg);
+        return 1;
+    }
     
     LogInfo("Obfuscation Complete!");
-    LogInfo("Constants: %d, Instructions: %d", chunk->ConstantCount, chunk->Count);
+    LogInfo("Constants: %d, Instructions: %d", result.constantCount, result.instructionCount);
+    LogInfo("Seed: %llu (pass --seed %llu to rebuild this output)", result.seed, result.seed);
 
     // Save to file
     FILE* f = fopen(outputFile, "w");
     if (f) {
-        fprintf(f, "%s", result);
+        fwrite(result.output, 1, result.outputLength, f);
         fclose(f);
         LogInfo("Saved to '%s'", outputFile);
     } else {
@@ -107,8 +318,7 @@ int main(int argc, char** argv) {
     }
 
     // Cleanup
-    free(result);
-    FreeChunk(chunk);
+    FreeObfResult(&result);
 
     return 0;
 }
@@ -0,0 +1,225 @@
+#define NAPI_VERSION 6
+#include <node_api.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/Obfuscator.h"
+
+// ============================================
+// NODE ADDON (luauobf.node)
+// ============================================
+//
+// obfuscate(source: string, options?: { seed?: bigint | number, watermark?: string,
+//                                       timeoutMs?: number, cancelFlag?: Int32Array })
+//   -> Promise<{ code: string, constants: number, instructions: number, seed: bigint }>
+//
+// Passing the returned seed back rebuilds the same output.
+// Storing a non-zero value in cancelFlag[0] abandons the job at its next stage.
+// Rejections carry err.code: OBFUSCATION_FAILED, OBFUSCATION_TIMEOUT or OBFUSCATION_CANCELLED.
+//
+// The job runs on the libuv threadpool; the event loop only copies strings.
+
+typedef struct {
+    napi_async_work work;
+    napi_deferred deferred;
+    napi_ref cancelRef;         // Keeps cancelFlag's buffer alive while the job runs
+    char* source;
+    size_t sourceLength;
+    char* watermark;
+    size_t watermarkLength;
+    ObfOptions options;
+    ObfResult result;
+} ObfuscateJob;
+
+static void freeJob(napi_env env, ObfuscateJob* job) {
+    if (job->cancelRef) napi_delete_reference(env, job->cancelRef);
+    FreeObfResult(&job->result);
+    free(job->source);
+    free(job->watermark);
+    free(job);
+}
+
+// Copy a JS string argument into a malloc'd UTF-8 buffer
+static char* copyString(napi_env env, napi_value value, size_t* length) {
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, value, NULL, 0, &len) != napi_ok) return NULL;
+
+    char* buf = (char*)malloc(len + 1);
+    if (!buf) return NULL;
+    napi_get_value_string_utf8(env, value, buf, len + 1, &len);
+    *length = len;
+    return buf;
+}
+
+static int readOptions(napi_env env, napi_value object, ObfuscateJob* job) {
+    napi_valuetype type;
+    napi_typeof(env, object, &type);
+    if (type == napi_undefined || type == napi_null) return 1;
+    if (type != napi_object) return 0;
+
+    bool has = false;
+    napi_value value;
+
+    napi_has_named_property(env, object, "seed", &has);
+    if (has) {
+        napi_get_named_property(env, object, "seed", &value);
+        napi_typeof(env, value, &type);
+        if (type == napi_bigint) {
+            bool lossless;
+            uint64_t seed;
+            napi_get_value_bigint_uint64(env, value, &seed, &lossless);
+            job->options.seed = seed;
+        } else if (type == napi_number) {
+            int64_t seed;
+            napi_get_value_int64(env, value, &seed);
+            job->options.seed = (unsigned long long)seed;
+        } else if (type != napi_undefined) {
+            return 0;
+        }
+    }
+
+    napi_has_named_property(env, object, "timeoutMs", &has);
+    if (has) {
+        napi_get_named_property(env, object, "timeoutMs", &value);
+        napi_typeof(env, value, &type);
+        if (type == napi_number) {
+            uint32_t timeoutMs;
+            napi_get_value_uint32(env, value, &timeoutMs);
+            job->options.timeoutMs = timeoutMs;
+        } else if (type != napi_undefined) {
+            return 0;
+        }
+    }
+
+    napi_has_named_property(env, object, "cancelFlag", &has);
+    if (has) {
+        napi_get_named_property(env, object, "cancelFlag", &value);
+        bool isTyped = false;
+        napi_is_typedarray(env, value, &isTyped);
+        if (isTyped) {
+            napi_typedarray_type arrayType;
+            size_t length;
+            void* data;
+            napi_get_typedarray_info(env, value, &arrayType, &length, &data, NULL, NULL);
+            if (arrayType != napi_int32_array || length < 1) return 0;
+            napi_create_reference(env, value, 1, &job->cancelRef);
+            job->options.cancel = (volatile int*)data;
+        } else {
+            napi_typeof(env, value, &type);
+            if (type != napi_undefined) return 0;
+        }
+    }
+
+    napi_has_named_property(env, object, "watermark", &has);
+    if (has) {
+        napi_get_named_property(env, object, "watermark", &value);
+        napi_typeof(env, value, &type);
+        if (type == napi_string) {
+            job->watermark = copyString(env, value, &job->watermarkLength);
+            if (!job->watermark) return 0;
+            job->options.watermark = job->watermark;
+            job->options.watermarkLength = job->watermarkLength;
+        } else if (type != napi_undefined) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void executeJob(napi_env env, void* data) {
+    ObfuscateJob* job = (ObfuscateJob*)data;
+    (void)env;
+    ObfuscateBuffer(job->source, job->sourceLength, &job->options, &job->result);
+}
+
+static void rejectJob(napi_env env, ObfuscateJob* job, const char* code, const char* msg) {
+    napi_value codeValue, message, error;
+    napi_create_string_utf8(env, code, NAPI_AUTO_LENGTH, &codeValue);
+    napi_create_string_utf8(env, msg, NAPI_AUTO_LENGTH, &message);
+    napi_create_error(env, codeValue, message, &error);
+    napi_reject_deferred(env, job->deferred, error);
+}
+
+static void completeJob(napi_env env, napi_status status, void* data) {
+    ObfuscateJob* job = (ObfuscateJob*)data;
+
+    if (status != napi_ok) {
+        rejectJob(env, job, "OBFUSCATION_CANCELLED", "Obfuscation job was cancelled");
+    } else if (job->result.status == OBF_TIMEOUT) {
+        rejectJob(env, job, "OBFUSCATION_TIMEOUT", job->result.errorMsg);
+    } else if (job->result.status == OBF_CANCELLED) {
+        rejectJob(env, job, "OBFUSCATION_CANCELLED", job->result.errorMsg);
+    } else if (job->result.status != OBF_OK) {
+        rejectJob(env, job, "OBFUSCATION_FAILED", job->result.errorMsg);
+    } else {
+        napi_value value, code, constants, instructions, seed;
+        napi_create_object(env, &value);
+        napi_create_string_utf8(env, job->result.output, job->result.outputLength, &code);
+        napi_create_int32(env, job->result.constantCount, &constants);
+        napi_create_int32(env, job->result.instructionCount, &instructions);
+        napi_create_bigint_uint64(env, job->result.seed, &seed);
+        napi_set_named_property(env, value, "code", code);
+        napi_set_named_property(env, value, "constants", constants);
+        napi_set_named_property(env, value, "instructions", instructions);
+        napi_set_named_property(env, value, "seed", seed);
+        napi_resolve_deferred(env, job->deferred, value);
+    }
+
+    napi_delete_async_work(env, job->work);
+    freeJob(env, job);
+}
+
+static napi_value Obfuscate(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+
+    napi_valuetype type = napi_undefined;
+    if (argc >= 1) napi_typeof(env, argv[0], &type);
+    if (type != napi_string) {
+        napi_throw_type_error(env, NULL, "obfuscate: source must be a string");
+        return NULL;
+    }
+
+    ObfuscateJob* job = (ObfuscateJob*)calloc(1, sizeof(ObfuscateJob));
+    if (!job) {
+        napi_throw_error(env, NULL, "obfuscate: out of memory");
+        return NULL;
+    }
+
+    job->source = copyString(env, argv[0], &job->sourceLength);
+    if (!job->source) {
+        freeJob(env, job);
+        napi_throw_error(env, NULL, "obfuscate: out of memory");
+        return NULL;
+    }
+
+    if (argc >= 2 && !readOptions(env, argv[1], job)) {
+        freeJob(env, job);
+        napi_throw_type_error(env, NULL, "obfuscate: invalid options");
+        return NULL;
+    }
+
+    napi_value promise, name;
+    napi_create_promise(env, &job->deferred, &promise);
+    napi_create_string_utf8(env, "luauobf:obfuscate", NAPI_AUTO_LENGTH, &name);
+    napi_create_async_work(env, NULL, name, executeJob, completeJob, job, &job->work);
+    napi_queue_async_work(env, job->work);
+
+    return promise;
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+    napi_value fn;
+    napi_create_function(env, "obfuscate", NAPI_AUTO_LENGTH, Obfuscate, NULL, &fn);
+    napi_set_named_property(env, exports, "obfuscate", fn);
+    return exports;
+}
+
+#ifndef NODE_GYP_MODULE_NAME
+#define NODE_GYP_MODULE_NAME luauobf
+#endif
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -5,20 +5,20 @@
 #include "../../include/Utils.h"
 
 // Insert anti-decompiler traps into bytecode
-void InsertAntiDecompilerTraps(BytecodeChunk* chunk) {
+void InsertAntiDecompilerTraps(BytecodeChunk* chunk, ObfContext* obf) {
     if (!chunk || chunk->Count < 5) return;
     
     // Add confusing instruction sequences that break decompiler patterns
     int originalCount = chunk->Count;
-    int trapCount = RandomInt(2, 5);
+    int trapCount = RandomInt(obf, 2, 5);
     int newCapacity = originalCount + trapCount * 4;
     Instruction* newInstructions = (Instruction*)malloc(newCapacity * sizeof(Instruction));
     int newCount = 0;
     
     for (int i = 0; i < originalCount; i++) {
         // Insert trap before certain instructions
-        if (i > 0 && RandomInt(0, 10) == 0) {
-            int trapReg = RandomInt(245, 250);
+        if (i > 0 && RandomInt(obf, 0, 10) == 0) {
+            int trapReg = RandomInt(obf, 245, 250);
             // Create confusing sequence: LOADK -> TEST -> JMP(0) -> instruction
             // This creates a pattern that confuses decompilers
             newInstructions[newCount++] = (Instruction){OP_LOADBOOL, trapReg, 1, 0};
@@ -36,13 +36,13 @@ void InsertAntiDecompilerTraps(BytecodeChunk* chunk) {
 }
 
 // Generate anti-decompiler code patterns
-void GenerateAntiDecompilerPatterns(char** script, int* size, int* capacity) {
+void GenerateAntiDecompilerPatterns(char** script, int* size, int* capacity, ObfContext* obf) {
     char buf[2048];
     
     // Patterns that confuse Lua decompilers
-    char* v1 = GenerateRandomString(2);
-    char* v2 = GenerateRandomString(2);
-    char* v3 = GenerateRandomString(2);
+    char* v1 = GenerateRandomString(obf, 2);
+    char* v2 = GenerateRandomString(obf, 2);
+    char* v3 = GenerateRandomString(obf, 2);
     
     // Pattern 1: Recursive self-reference that confuses static analysis
     snprintf(buf, 2048,
@@ -59,11 +59,11 @@ void GenerateAntiDecompilerPatterns(char** script, int* size, int* capacity) {
     Append(script, size, capacity, buf);
     
     // Pattern 4: Metamethod confusion (rawget hidden via _G)
-    char* mt = GenerateRandomString(2);
+    char* mt = GenerateRandomString(obf, 2);
     snprintf(buf, 2048,
         "local %s=setmetatable({},{__index=function(t,k)return _G[string.char(114,97,119,103,101,116)](t,k)end});"
         "%s[1]=%d;",
-        mt, mt, RandomInt(1, 9999)
+        mt, mt, RandomInt(obf, 1, 9999)
     );
     
     Append(script, size, capacity, buf);
@@ -5,19 +5,19 @@
 #include "../../include/Utils.h"
 
 // Apply deeper virtualization layer
-void ApplyCodeVirtualization(BytecodeChunk* chunk) {
+void ApplyCodeVirtualization(BytecodeChunk* chunk, ObfContext* obf) {
     if (!chunk || chunk->Count < 5) return;
     
     // Add virtual opcodes between real opcodes for confusion
     int originalCount = chunk->Count;
-    int virtualCount = RandomInt(3, 8);
+    int virtualCount = RandomInt(obf, 3, 8);
     int newCapacity = originalCount + virtualCount;
     Instruction* newInstructions = (Instruction*)malloc(newCapacity * sizeof(Instruction));
     int newCount = 0;
     
     for (int i = 0; i < originalCount; i++) {
         // Randomly insert virtual NOPs
-        if (RandomInt(0, 4) == 0 && newCount < newCapacity - 1) {
+        if (RandomInt(obf, 0, 4) == 0 && newCount < newCapacity - 1) {
             newInstructions[newCount++] = (Instruction){OP_VIRTUAL_NOP, 0, 0, 0};
         }
         
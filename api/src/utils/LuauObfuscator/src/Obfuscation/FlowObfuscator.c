@@ -40,17 +40,17 @@ void ApplyControlFlowFlattening(BytecodeChunk* chunk) {
 }
 
 // Generate control flow flattening dispatcher in script (safe version)
-void GenerateControlFlowDispatcher(char** script, int* size, int* capacity) {
+void GenerateControlFlowDispatcher(char** script, int* size, int* capacity, ObfContext* obf) {
     char buf[4096];
     
     // Create state machine that wraps the VM execution
-    char* state = GenerateRandomString(2);
-    char* dispatch = GenerateRandomString(3);
+    char* state = GenerateRandomString(obf, 2);
+    char* dispatch = GenerateRandomString(obf, 3);
     
     // Generate randomized state values
-    int s1 = RandomInt(100, 999);
-    int s2 = RandomInt(100, 999);
-    int s3 = RandomInt(100, 999);
+    int s1 = RandomInt(obf, 100, 999);
+    int s2 = RandomInt(obf, 100, 999);
+    int s3 = RandomInt(obf, 100, 999);
     
     snprintf(buf, 4096,
         // State machine dispatcher
@@ -69,18 +69,17 @@ void GenerateControlFlowDispatcher(char** script, int* size, int* capacity) {
 }
 
 // Insert opaque predicates - always true/false conditions that confuse analysis
-void InsertOpaquePredicates(char** script, int* size, int* capacity) {
+void InsertOpaquePredicates(char** script, int* size, int* capacity, ObfContext* obf) {
     char buf[2048];
     
     // Generate random variable names
-    char* v1 = GenerateRandomString(2);
-    char* v2 = GenerateRandomString(2);
-    char* v3 = GenerateRandomString(2);
+    char* v1 = GenerateRandomString(obf, 2);
+    char* v2 = GenerateRandomString(obf, 2);
+    char* v3 = GenerateRandomString(obf, 2);
     
     // Opaque predicates - mathematical expressions that are always true or always false
     // but difficult for static analysis to determine
-    int a = RandomInt(100, 999);
-    int b = RandomInt(100, 999);
+    int a = RandomInt(obf, 100, 999);
     
     snprintf(buf, 2048,
         // Opaque predicate 1: (x*x >= 0) is always true
@@ -5,11 +5,11 @@
 #include "../../include/Utils.h"
 
 // Insert junk/dead code into bytecode
-void InsertJunkCode(BytecodeChunk* chunk) {
+void InsertJunkCode(BytecodeChunk* chunk, ObfContext* obf) {
     if (!chunk || chunk->Count < 3) return;
     
     int originalCount = chunk->Count;
-    int junkCount = RandomInt(5, 15);
+    int junkCount = RandomInt(obf, 5, 15);
     int newCapacity = originalCount + junkCount * 3;
     Instruction* newInstructions = (Instruction*)malloc(newCapacity * sizeof(Instruction));
     int newCount = 0;
@@ -17,17 +17,16 @@ void InsertJunkCode(BytecodeChunk* chunk) {
     // Insert junk at random positions
     int insertPositions[20];
     for (int i = 0; i < junkCount; i++) {
-        insertPositions[i] = RandomInt(0, originalCount - 1);
+        insertPositions[i] = RandomInt(obf, 0, originalCount - 1);
     }
     
-    int junkIdx = 0;
     for (int i = 0; i < originalCount; i++) {
         // Check if we should insert junk before this instruction
         for (int j = 0; j < junkCount; j++) {
             if (insertPositions[j] == i) {
                 // Insert junk instruction (NOP-like operations)
-                int junkType = RandomInt(0, 3);
-                int junkReg = RandomInt(240, 250);
+                int junkType = RandomInt(obf, 0, 3);
+                int junkReg = RandomInt(obf, 240, 250);
                 switch (junkType) {
                     case 0: // Load nil
                         newInstructions[newCount++] = (Instruction){OP_LOADNIL, junkReg, 0, 0};
@@ -36,7 +35,7 @@ void InsertJunkCode(BytecodeChunk* chunk) {
                         newInstructions[newCount++] = (Instruction){OP_MOVE, junkReg, junkReg, 0};
                         break;
                     case 2: // Load bool
-                        newInstructions[newCount++] = (Instruction){OP_LOADBOOL, junkReg, RandomInt(0,1), 0};
+                        newInstructions[newCount++] = (Instruction){OP_LOADBOOL, junkReg, RandomInt(obf, 0,1), 0};
                         break;
                     case 3: // Load constant (if available)
                         if (chunk->ConstantCount > 0) {
@@ -58,31 +57,34 @@ void InsertJunkCode(BytecodeChunk* chunk) {
 }
 
 // Generate realistic junk code patterns in script
-void GenerateJunkPatterns(char** script, int* size, int* capacity, int count) {
+void GenerateJunkPatterns(char** script, int* size, int* capacity, int count, ObfContext* obf) {
     char buf[1024];
     
     for (int i = 0; i < count; i++) {
-        char* v = GenerateRandomString(2);
-        int pattern = RandomInt(0, 5);
+        char* v = GenerateRandomString(obf, 2);
+        int pattern = RandomInt(obf, 0, 5);
         
         switch (pattern) {
             case 0: // Dead variable assignment
-                snprintf(buf, 1024, "local %s=%d;", v, RandomInt(1, 9999));
+                snprintf(buf, 1024, "local %s=%d;", v, RandomInt(obf, 1, 9999));
                 break;
             case 1: // Unused function call result
-                snprintf(buf, 1024, "local %s=tostring(%d);", v, RandomInt(1, 9999));
+                snprintf(buf, 1024, "local %s=tostring(%d);", v, RandomInt(obf, 1, 9999));
                 break;
             case 2: // Math operation
-                snprintf(buf, 1024, "local %s=math.floor(%d/%d);", v, RandomInt(100,999), RandomInt(1,10));
+                snprintf(buf, 1024, "local %s=math.floor(%d/%d);", v, RandomInt(obf, 100,999), RandomInt(obf, 1,10));
                 break;
-            case 3: // String operation
-                snprintf(buf, 1024, "local %s=string.len('%s');", v, GenerateRandomString(5));
+            case 3: { // String operation
+                char* text = GenerateRandomString(obf, 5);
+                snprintf(buf, 1024, "local %s=string.len('%s');", v, text);
+                free(text);
                 break;
+            }
             case 4: // Table creation
-                snprintf(buf, 1024, "local %s={%d,%d,%d};", v, RandomInt(1,99), RandomInt(1,99), RandomInt(1,99));
+                snprintf(buf, 1024, "local %s={%d,%d,%d};", v, RandomInt(obf, 1,99), RandomInt(obf, 1,99), RandomInt(obf, 1,99));
                 break;
             case 5: // Bit operation
-                snprintf(buf, 1024, "local %s=bit32.band(%d,%d);", v, RandomInt(100,999), RandomInt(100,999));
+                snprintf(buf, 1024, "local %s=bit32.band(%d,%d);", v, RandomInt(obf, 100,999), RandomInt(obf, 100,999));
                 break;
         }
         
@@ -4,10 +4,10 @@
 #include "../../include/NestedVM.h"
 #include "../../include/Utils.h"
 
-void GenerateNestedVMWrapper(char** script, int* size, int* capacity) {
+void GenerateNestedVMWrapper(char** script, int* size, int* capacity, ObfContext* obf) {
     char buf[4096];
-    char* outerVM = GenerateRandomString(3);
-    char* env = GenerateRandomString(2);
+    char* outerVM = GenerateRandomString(obf, 3);
+    char* env = GenerateRandomString(obf, 2);
     
     // Roblox-safe version - just create sandboxed environment wrapper
     snprintf(buf, 4096,
@@ -23,11 +23,11 @@ void GenerateNestedVMWrapper(char** script, int* size, int* capacity) {
     free(env);
 }
 
-void GenerateInnerVMDispatcher(char** script, int* size, int* capacity, int layer) {
+void GenerateInnerVMDispatcher(char** script, int* size, int* capacity, int layer, ObfContext* obf) {
     char buf[2048];
-    char* disp = GenerateRandomString(3);
-    char* state = GenerateRandomString(2);
-    int baseState = RandomInt(100, 999) + (layer * 1000);
+    char* disp = GenerateRandomString(obf, 3);
+    char* state = GenerateRandomString(obf, 2);
+    int baseState = RandomInt(obf, 100, 999) + (layer * 1000);
     
     snprintf(buf, 2048,
         "local %s=%d;local %s={[%d]=function()%s=%d end,[%d]=function()%s=%d end,[%d]=function()%s=nil end};"
@@ -44,11 +44,11 @@ void GenerateInnerVMDispatcher(char** script, int* size, int* capacity, int laye
     free(state);
 }
 
-void GenerateMetamorphicCode(char** script, int* size, int* capacity) {
+void GenerateMetamorphicCode(char** script, int* size, int* capacity, ObfContext* obf) {
     char buf[4096];
-    char* morph = GenerateRandomString(3);
-    char* variant = GenerateRandomString(2);
-    char* transform = GenerateRandomString(3);
+    char* morph = GenerateRandomString(obf, 3);
+    char* variant = GenerateRandomString(obf, 2);
+    char* transform = GenerateRandomString(obf, 3);
     
     // Use tick() for Roblox, table.unpack instead of unpack
     snprintf(buf, 4096,
@@ -71,10 +71,10 @@ void GenerateMetamorphicCode(char** script, int* size, int* capacity) {
     free(transform);
 }
 
-void GenerateSelfModifyingPatterns(char** script, int* size, int* capacity) {
+void GenerateSelfModifyingPatterns(char** script, int* size, int* capacity, ObfContext* obf) {
     char buf[2048];
-    char* reg = GenerateRandomString(3);
-    char* mod = GenerateRandomString(3);
+    char* reg = GenerateRandomString(obf, 3);
+    char* mod = GenerateRandomString(obf, 3);
     
     snprintf(buf, 2048,
         "local %s={};"
@@ -88,11 +88,10 @@ void GenerateSelfModifyingPatterns(char** script, int* size, int* capacity) {
     free(mod);
 }
 
-void GenerateBytecodeEncryption(char** script, int* size, int* capacity, int key) {
+void GenerateBytecodeEncryption(char** script, int* size, int* capacity, int key, ObfContext* obf) {
     char buf[4096];
-    char* dec = GenerateRandomString(3);
-    char* enc = GenerateRandomString(3);
-    int key2 = RandomInt(50, 200);
+    char* dec = GenerateRandomString(obf, 3);
+    char* enc = GenerateRandomString(obf, 3);
     
     snprintf(buf, 4096,
         "local %s=function(data,k)"
@@ -113,11 +112,11 @@ void GenerateBytecodeEncryption(char** script, int* size, int* capacity, int key
     free(enc);
 }
 
-void GenerateNativePatterns(char** script, int* size, int* capacity) {
+void GenerateNativePatterns(char** script, int* size, int* capacity, ObfContext* obf) {
     char buf[4096];
-    char* fast = GenerateRandomString(3);
-    char* cache = GenerateRandomString(3);
-    char* opt = GenerateRandomString(3);
+    char* fast = GenerateRandomString(obf, 3);
+    char* cache = GenerateRandomString(obf, 3);
+    char* opt = GenerateRandomString(obf, 3);
     
     snprintf(buf, 4096,
         "local %s={};"
@@ -9,18 +9,11 @@ void EncryptStringConstants(BytecodeChunk* chunk, int encryptionKey) {
     if (!chunk) return;
     
     for (int i = 0; i < chunk->ConstantCount; i++) {
-        if (chunk->Constants[i] == NULL) continue;
-        
-        // Skip function constants (start with __lua__)
-        if (strncmp(chunk->Constants[i], "__lua__", 7) == 0) continue;
-        
-        // Skip numeric strings
-        char* endptr;
-        strtod(chunk->Constants[i], &endptr);
-        if (*endptr == '\0') continue;
+        Constant* k = &chunk->Constants[i];
+        if (k->Type != CONST_STRING) continue;
         
         // Encrypt the string with rolling XOR
-        int len = strlen(chunk->Constants[i]);
+        int len = k->Length;
         char* encrypted = (char*)malloc(len + 5);  // Add prefix for encrypted marker
         encrypted[0] = '_';
         encrypted[1] = 'E';
@@ -28,22 +21,23 @@ void EncryptStringConstants(BytecodeChunk* chunk, int encryptionKey) {
         
         int key = encryptionKey;
         for (int j = 0; j < len; j++) {
-            encrypted[j + 3] = chunk->Constants[i][j] ^ (key & 0xFF);
+            encrypted[j + 3] = k->String[j] ^ (key & 0xFF);
             key = (key * 31 + 17) & 0xFFFF;
         }
         encrypted[len + 3] = '\0';
         
-        free(chunk->Constants[i]);
-        chunk->Constants[i] = encrypted;
+        free(k->String);
+        k->String = encrypted;
+        k->Length = len + 3;
     }
 }
 
 // Generate string decryption runtime code
-void GenerateStringDecryptor(char** script, int* size, int* capacity, int encryptionKey) {
+void GenerateStringDecryptor(char** script, int* size, int* capacity, int encryptionKey, ObfContext* obf) {
     char buf[2048];
     
-    char* fn = GenerateRandomString(3);
-    char* k = GenerateRandomString(2);
+    char* fn = GenerateRandomString(obf, 3);
+    char* k = GenerateRandomString(obf, 2);
     
     // Generate decryption function
     snprintf(buf, 2048,
@@ -68,13 +62,13 @@ void GenerateStringDecryptor(char** script, int* size, int* capacity, int encryp
 }
 
 // Generate constant number encryption/decryption
-void GenerateConstantEncryption(char** script, int* size, int* capacity) {
+void GenerateConstantEncryption(char** script, int* size, int* capacity, ObfContext* obf) {
     char buf[2048];
     
-    char* dec = GenerateRandomString(3);  // decrypt function
-    char* enc = GenerateRandomString(3);  // encrypt function
-    int key1 = RandomInt(1000, 9999);
-    int key2 = RandomInt(100, 999);
+    char* dec = GenerateRandomString(obf, 3);  // decrypt function
+    char* enc = GenerateRandomString(obf, 3);  // encrypt function
+    int key1 = RandomInt(obf, 1000, 9999);
+    int key2 = RandomInt(obf, 100, 999);
     
     // Number obfuscation: encrypt(n) = (n * key2) + key1
     // decrypt(n) = (n - key1) / key2
@@ -92,12 +86,12 @@ void GenerateConstantEncryption(char** script, int* size, int* capacity) {
 }
 
 // Generate multi-layer VM wrapper
-void GenerateMultiLayerVM(char** script, int* size, int* capacity) {
+void GenerateMultiLayerVM(char** script, int* size, int* capacity, ObfContext* obf) {
     char buf[4096];
     
-    char* layer1 = GenerateRandomString(3);
-    char* layer2 = GenerateRandomString(3);
-    char* wrapper = GenerateRandomString(3);
+    char* layer1 = GenerateRandomString(obf, 3);
+    char* layer2 = GenerateRandomString(obf, 3);
+    char* wrapper = GenerateRandomString(obf, 3);
     
     // Create nested function wrappers that add execution layers
     snprintf(buf, 4096,
@@ -1,36 +1,117 @@
 #include "../../include/Lexer.h"
-#include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
 
-static const char* keywords[] = {
-    "and", "break", "do", "else", "elseif", "end", "false", "for",
-    "function", "if", "in", "local", "nil", "not", "or", "repeat",
-    "return", "then", "true", "until", "while", NULL
-};
+// Bulk scanning width; without SSE2 the scanner is byte-at-a-time
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_WIDTH 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SCAN_WIDTH 16
+#endif
+
+// Character classes, indexed by byte; bytes >= 0x80 belong to none
+#define CHAR_ALPHA 0x1  // Letters and '_'
+#define CHAR_DIGIT 0x2
+#define CHAR_HEX   0x4
+#define CHAR_SPACE 0x8
 
-static TokenType keywordTypes[] = {
-    TOK_AND, TOK_BREAK, TOK_DO, TOK_ELSE, TOK_ELSEIF, TOK_END, TOK_FALSE, TOK_FOR,
-    TOK_FUNCTION, TOK_IF, TOK_IN, TOK_LOCAL, TOK_NIL, TOK_NOT, TOK_OR, TOK_REPEAT,
-    TOK_RETURN, TOK_THEN, TOK_TRUE, TOK_UNTIL, TOK_WHILE
+#define A CHAR_ALPHA
+#define D CHAR_DIGIT
+#define X CHAR_HEX
+#define S CHAR_SPACE
+static const unsigned char charClass[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, S, S, S, S, S, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    S, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    D|X, D|X, D|X, D|X, D|X, D|X, D|X, D|X, D|X, D|X, 0, 0, 0, 0, 0, 0,
+    0, A|X, A|X, A|X, A|X, A|X, A|X, A, A, A, A, A, A, A, A, A,
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, A,
+    0, A|X, A|X, A|X, A|X, A|X, A|X, A, A, A, A, A, A, A, A, A,
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0,
 };
+#undef A
+#undef D
+#undef X
+#undef S
+
+#define IS(c, cls) (charClass[(unsigned char)(c)] & (cls))
+
+// Keyword for the name, or TOK_NAME; dispatches on length and first character
+static TokenType keywordType(const char* s, int len) {
+    switch (len) {
+        case 2:
+            switch (s[0]) {
+                case 'd': if (s[1] == 'o') return TOK_DO; break;
+                case 'i':
+                    if (s[1] == 'f') return TOK_IF;
+                    if (s[1] == 'n') return TOK_IN;
+                    break;
+                case 'o': if (s[1] == 'r') return TOK_OR; break;
+            }
+            break;
+        case 3:
+            switch (s[0]) {
+                case 'a': if (memcmp(s, "and", 3) == 0) return TOK_AND; break;
+                case 'e': if (memcmp(s, "end", 3) == 0) return TOK_END; break;
+                case 'f': if (memcmp(s, "for", 3) == 0) return TOK_FOR; break;
+                case 'n':
+                    if (memcmp(s, "nil", 3) == 0) return TOK_NIL;
+                    if (memcmp(s, "not", 3) == 0) return TOK_NOT;
+                    break;
+            }
+            break;
+        case 4:
+            switch (s[0]) {
+                case 'e': if (memcmp(s, "else", 4) == 0) return TOK_ELSE; break;
+                case 't':
+                    if (memcmp(s, "then", 4) == 0) return TOK_THEN;
+                    if (memcmp(s, "true", 4) == 0) return TOK_TRUE;
+                    break;
+            }
+            break;
+        case 5:
+            switch (s[0]) {
+                case 'b': if (memcmp(s, "break", 5) == 0) return TOK_BREAK; break;
+                case 'f': if (memcmp(s, "false", 5) == 0) return TOK_FALSE; break;
+                case 'l': if (memcmp(s, "local", 5) == 0) return TOK_LOCAL; break;
+                case 'u': if (memcmp(s, "until", 5) == 0) return TOK_UNTIL; break;
+                case 'w': if (memcmp(s, "while", 5) == 0) return TOK_WHILE; break;
+            }
+            break;
+        case 6:
+            switch (s[0]) {
+                case 'e': if (memcmp(s, "elseif", 6) == 0) return TOK_ELSEIF; break;
+                case 'r':
+                    if (memcmp(s, "repeat", 6) == 0) return TOK_REPEAT;
+                    if (memcmp(s, "return", 6) == 0) return TOK_RETURN;
+                    break;
+            }
+            break;
+        case 8:
+            if (memcmp(s, "function", 8) == 0) return TOK_FUNCTION;
+            break;
+    }
+    return TOK_NAME;
+}
 
-Lexer* CreateLexer(const char* source) {
+Lexer* CreateLexer(const char* source, int length) {
     Lexer* lexer = (Lexer*)malloc(sizeof(Lexer));
-    lexer->source = strdup(source);
+    lexer->source = source;
     lexer->pos = 0;
     lexer->line = 1;
-    lexer->column = 1;
-    lexer->length = strlen(source);
-    lexer->current.type = TOK_EOF;
-    lexer->current.value = NULL;
+    lexer->length = length;
+    memset(&lexer->tokens, 0, sizeof(TokenStream));
     return lexer;
 }
 
 void FreeLexer(Lexer* lexer) {
     if (lexer) {
-        free(lexer->source);
-        if (lexer->current.value) free(lexer->current.value);
+        free(lexer->tokens.types);
+        free(lexer->tokens.offsets);
+        free(lexer->tokens.lengths);
+        free(lexer->tokens.lines);
         free(lexer);
     }
 }
@@ -47,26 +128,94 @@ static char peekNext(Lexer* lexer) {
 
 static char advance(Lexer* lexer) {
     char c = lexer->source[lexer->pos++];
-    if (c == '\n') {
-        lexer->line++;
-        lexer->column = 1;
-    } else {
-        lexer->column++;
-    }
+    if (c == '\n') lexer->line++;
     return c;
 }
 
+#ifdef SCAN_WIDTH
+static int popCount(unsigned int bits) {
+#if defined(__GNUC__)
+    return __builtin_popcount(bits);
+#else
+    int n = 0;
+    for (; bits; bits &= bits - 1) n++;
+    return n;
+#endif
+}
+
+static int lowestBit(unsigned int bits) {
+#if defined(__GNUC__)
+    return __builtin_ctz(bits);
+#else
+    int n = 0;
+    while (!(bits & 1)) { bits >>= 1; n++; }
+    return n;
+#endif
+}
+
+// Bit i set where p[i] is one of a, b, c; newlines get the '\n' bits
+static unsigned int matchBlock(const char* p, char a, char b, char c, unsigned int* newlines) {
+#if SCAN_WIDTH == 32
+    __m256i block = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hits = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(a)),
+                        _mm256_cmpeq_epi8(block, _mm256_set1_epi8(b))),
+        _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c)));
+    *newlines = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+    return (unsigned int)_mm256_movemask_epi8(hits);
+#else
+    __m128i block = _mm_loadu_si128((const __m128i*)p);
+    __m128i hits = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(a)),
+                     _mm_cmpeq_epi8(block, _mm_set1_epi8(b))),
+        _mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+    *newlines = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+    return (unsigned int)_mm_movemask_epi8(hits);
+#endif
+}
+#endif
+
+// Advance to the next a, b or c (or the end of the source), counting the
+// newlines passed over. Repeat a stop character when fewer are needed.
+static void scanTo(Lexer* lexer, char a, char b, char c) {
+    const char* src = lexer->source;
+    int pos = lexer->pos;
+    int line = lexer->line;
+    
+#ifdef SCAN_WIDTH
+    while (pos + SCAN_WIDTH <= lexer->length) {
+        unsigned int newlines;
+        unsigned int hits = matchBlock(src + pos, a, b, c, &newlines);
+        if (hits) {
+            int at = lowestBit(hits);
+            lexer->pos = pos + at;
+            lexer->line = line + popCount(newlines & ((hits & (0u - hits)) - 1));
+            return;
+        }
+        line += popCount(newlines);
+        pos += SCAN_WIDTH;
+    }
+#endif
+    
+    while (pos < lexer->length && src[pos] != a && src[pos] != b && src[pos] != c) {
+        if (src[pos] == '\n') line++;
+        pos++;
+    }
+    lexer->pos = pos;
+    lexer->line = line;
+}
+
 static void skipWhitespace(Lexer* lexer) {
     // Skip UTF-8 BOM at start of file
     if (lexer->pos == 0 && lexer->length >= 3) {
-        unsigned char* src = (unsigned char*)lexer->source;
+        const unsigned char* src = (const unsigned char*)lexer->source;
         if (src[0] == 0xEF && src[1] == 0xBB && src[2] == 0xBF) {
             lexer->pos = 3;
         }
     }
     while (1) {
         char c = peek(lexer);
-        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v') {
+        if (IS(c, CHAR_SPACE)) {
             advance(lexer);
         } else if (c == '-' && peekNext(lexer) == '-') {
             // Comment
@@ -74,15 +223,15 @@ static void skipWhitespace(Lexer* lexer) {
             if (peek(lexer) == '[' && peekNext(lexer) == '[') {
                 // Long comment
                 advance(lexer); advance(lexer);
-                while (!(peek(lexer) == ']' && peekNext(lexer) == ']') && peek(lexer) != '\0') {
+                while (1) {
+                    scanTo(lexer, ']', ']', ']');
+                    if (peek(lexer) == '\0' || peekNext(lexer) == ']') break;
                     advance(lexer);
                 }
                 if (peek(lexer) != '\0') { advance(lexer); advance(lexer); }
             } else {
                 // Line comment
-                while (peek(lexer) != '\n' && peek(lexer) != '\0') {
-                    advance(lexer);
-                }
+                scanTo(lexer, '\n', '\n', '\n');
             }
         } else {
             break;
@@ -90,29 +239,55 @@ static void skipWhitespace(Lexer* lexer) {
     }
 }
 
-static Token makeToken(Lexer* lexer, TokenType type, const char* value) {
+// Token covering source[start, start + length)
+static Token makeToken(Lexer* lexer, TokenType type, int start, int length) {
     Token token;
     token.type = type;
-    token.value = value ? strdup(value) : NULL;
+    token.start = lexer->source + start;
+    token.length = length;
     token.line = lexer->line;
-    token.column = lexer->column;
     return token;
 }
 
+// Token ending at the current position, begun `length` characters back
+static Token symbolToken(Lexer* lexer, TokenType type, int length) {
+    return makeToken(lexer, type, lexer->pos - length, length);
+}
+
 static Token errorToken(Lexer* lexer, const char* msg) {
     Token token;
     token.type = TOK_ERROR;
-    token.value = strdup(msg);
+    token.start = msg;
+    token.length = (int)strlen(msg);
     token.line = lexer->line;
-    token.column = lexer->column;
     return token;
 }
 
+const char* InternToken(const Token* token, StringTable* strings) {
+    // Sources keep their CRLF line ends; the text is taken with them as LF
+    if (!memchr(token->start, '\r', token->length)) {
+        return InternString(strings, token->start, token->length);
+    }
+    
+    char* value = (char*)malloc(token->length);
+    if (!value) return NULL;
+    int len = 0;
+    for (int i = 0; i < token->length; i++) {
+        if (token->start[i] == '\r' && i + 1 < token->length && token->start[i + 1] == '\n') continue;
+        value[len++] = token->start[i];
+    }
+    const char* interned = InternString(strings, value, len);
+    free(value);
+    return interned;
+}
+
 static Token readString(Lexer* lexer, char quote) {
     int start = lexer->pos;
-    while (peek(lexer) != quote && peek(lexer) != '\0') {
-        if (peek(lexer) == '\\') advance(lexer); // Skip escape
-        advance(lexer);
+    while (1) {
+        scanTo(lexer, quote, '\\', quote);
+        if (peek(lexer) != '\\') break;
+        advance(lexer); // Skip escape
+        if (peek(lexer) != '\0') advance(lexer);
     }
     
     if (peek(lexer) == '\0') {
@@ -120,15 +295,9 @@ static Token readString(Lexer* lexer, char quote) {
     }
     
     int len = lexer->pos - start;
-    char* value = (char*)malloc(len + 1);
-    strncpy(value, lexer->source + start, len);
-    value[len] = '\0';
-    
     advance(lexer); // Closing quote
     
-    Token token = makeToken(lexer, TOK_STRING, value);
-    free(value);
-    return token;
+    return makeToken(lexer, TOK_STRING, start, len);
 }
 
 static Token readLongString(Lexer* lexer) {
@@ -139,6 +308,7 @@ static Token readLongString(Lexer* lexer) {
     advance(lexer);
     
     // Skip initial newline
+    if (peek(lexer) == '\r' && peekNext(lexer) == '\n') advance(lexer);
     if (peek(lexer) == '\n') advance(lexer);
     
     int start = lexer->pos;
@@ -152,16 +322,10 @@ static Token readLongString(Lexer* lexer) {
             while (peek(lexer) == '=' && eq < eqCount) { advance(lexer); eq++; }
             if (eq == eqCount && peek(lexer) == ']') {
                 advance(lexer);
-                int len = endPos - start;
-                char* value = (char*)malloc(len + 1);
-                strncpy(value, lexer->source + start, len);
-                value[len] = '\0';
-                Token token = makeToken(lexer, TOK_STRING, value);
-                free(value);
-                return token;
+                return makeToken(lexer, TOK_STRING, start, endPos - start);
             }
         } else {
-            advance(lexer);
+            scanTo(lexer, ']', ']', ']');
         }
     }
     
@@ -174,67 +338,45 @@ static Token readNumber(Lexer* lexer) {
     // Hex number
     if (lexer->source[start] == '0' && (peek(lexer) == 'x' || peek(lexer) == 'X')) {
         advance(lexer);
-        while (isxdigit(peek(lexer))) advance(lexer);
+        while (IS(peek(lexer), CHAR_HEX)) advance(lexer);
     } else {
-        while (isdigit(peek(lexer))) advance(lexer);
-        if (peek(lexer) == '.' && isdigit(peekNext(lexer))) {
+        while (IS(peek(lexer), CHAR_DIGIT)) advance(lexer);
+        if (peek(lexer) == '.' && IS(peekNext(lexer), CHAR_DIGIT)) {
             advance(lexer);
-            while (isdigit(peek(lexer))) advance(lexer);
+            while (IS(peek(lexer), CHAR_DIGIT)) advance(lexer);
         }
         if (peek(lexer) == 'e' || peek(lexer) == 'E') {
             advance(lexer);
             if (peek(lexer) == '+' || peek(lexer) == '-') advance(lexer);
-            while (isdigit(peek(lexer))) advance(lexer);
+            while (IS(peek(lexer), CHAR_DIGIT)) advance(lexer);
         }
     }
     
-    int len = lexer->pos - start;
-    char* value = (char*)malloc(len + 1);
-    strncpy(value, lexer->source + start, len);
-    value[len] = '\0';
-    
-    Token token = makeToken(lexer, TOK_NUMBER, value);
-    free(value);
-    return token;
+    return makeToken(lexer, TOK_NUMBER, start, lexer->pos - start);
 }
 
 static Token readName(Lexer* lexer) {
     int start = lexer->pos - 1;
-    while (isalnum(peek(lexer)) || peek(lexer) == '_') advance(lexer);
+    while (IS(peek(lexer), CHAR_ALPHA | CHAR_DIGIT)) advance(lexer);
     
     int len = lexer->pos - start;
-    char* value = (char*)malloc(len + 1);
-    strncpy(value, lexer->source + start, len);
-    value[len] = '\0';
-    
-    // Check for keyword
-    TokenType type = TOK_NAME;
-    for (int i = 0; keywords[i] != NULL; i++) {
-        if (strcmp(value, keywords[i]) == 0) {
-            type = keywordTypes[i];
-            break;
-        }
-    }
-    
-    Token token = makeToken(lexer, type, value);
-    free(value);
-    return token;
+    return makeToken(lexer, keywordType(lexer->source + start, len), start, len);
 }
 
-Token NextToken(Lexer* lexer) {
+static Token nextToken(Lexer* lexer) {
     skipWhitespace(lexer);
     
     if (lexer->pos >= lexer->length) {
-        return makeToken(lexer, TOK_EOF, NULL);
+        return makeToken(lexer, TOK_EOF, lexer->length, 0);
     }
     
     char c = advance(lexer);
     
     // Names and keywords
-    if (isalpha(c) || c == '_') return readName(lexer);
+    if (IS(c, CHAR_ALPHA)) return readName(lexer);
     
     // Numbers
-    if (isdigit(c)) return readNumber(lexer);
+    if (IS(c, CHAR_DIGIT)) return readNumber(lexer);
     
     // Strings
     if (c == '"' || c == '\'') return readString(lexer, c);
@@ -246,60 +388,121 @@ Token NextToken(Lexer* lexer) {
     
     // Operators and punctuation
     switch (c) {
-        case '+': return makeToken(lexer, TOK_PLUS, "+");
-        case '-': return makeToken(lexer, TOK_MINUS, "-");
-        case '*': return makeToken(lexer, TOK_STAR, "*");
-        case '/': return makeToken(lexer, TOK_SLASH, "/");
-        case '%': return makeToken(lexer, TOK_PERCENT, "%");
-        case '^': return makeToken(lexer, TOK_CARET, "^");
-        case '#': return makeToken(lexer, TOK_HASH, "#");
-        case '(': return makeToken(lexer, TOK_LPAREN, "(");
-        case ')': return makeToken(lexer, TOK_RPAREN, ")");
-        case '{': return makeToken(lexer, TOK_LBRACE, "{");
-        case '}': return makeToken(lexer, TOK_RBRACE, "}");
-        case '[': return makeToken(lexer, TOK_LBRACKET, "[");
-        case ']': return makeToken(lexer, TOK_RBRACKET, "]");
-        case ';': return makeToken(lexer, TOK_SEMICOLON, ";");
-        case ':': return makeToken(lexer, TOK_COLON, ":");
-        case ',': return makeToken(lexer, TOK_COMMA, ",");
+        case '+': return symbolToken(lexer, TOK_PLUS, 1);
+        case '-': return symbolToken(lexer, TOK_MINUS, 1);
+        case '*': return symbolToken(lexer, TOK_STAR, 1);
+        case '/': return symbolToken(lexer, TOK_SLASH, 1);
+        case '%': return symbolToken(lexer, TOK_PERCENT, 1);
+        case '^': return symbolToken(lexer, TOK_CARET, 1);
+        case '#': return symbolToken(lexer, TOK_HASH, 1);
+        case '(': return symbolToken(lexer, TOK_LPAREN, 1);
+        case ')': return symbolToken(lexer, TOK_RPAREN, 1);
+        case '{': return symbolToken(lexer, TOK_LBRACE, 1);
+        case '}': return symbolToken(lexer, TOK_RBRACE, 1);
+        case '[': return symbolToken(lexer, TOK_LBRACKET, 1);
+        case ']': return symbolToken(lexer, TOK_RBRACKET, 1);
+        case ';': return symbolToken(lexer, TOK_SEMICOLON, 1);
+        case ':': return symbolToken(lexer, TOK_COLON, 1);
+        case ',': return symbolToken(lexer, TOK_COMMA, 1);
         case '.':
             if (peek(lexer) == '.') {
                 advance(lexer);
                 if (peek(lexer) == '.') {
                     advance(lexer);
-                    return makeToken(lexer, TOK_DOTDOTDOT, "...");
+                    return symbolToken(lexer, TOK_DOTDOTDOT, 3);
                 }
-                return makeToken(lexer, TOK_DOTDOT, "..");
+                return symbolToken(lexer, TOK_DOTDOT, 2);
             }
-            return makeToken(lexer, TOK_DOT, ".");
+            return symbolToken(lexer, TOK_DOT, 1);
         case '=':
-            if (peek(lexer) == '=') { advance(lexer); return makeToken(lexer, TOK_EQ, "=="); }
-            return makeToken(lexer, TOK_ASSIGN, "=");
+            if (peek(lexer) == '=') { advance(lexer); return symbolToken(lexer, TOK_EQ, 2); }
+            return symbolToken(lexer, TOK_ASSIGN, 1);
         case '<':
-            if (peek(lexer) == '=') { advance(lexer); return makeToken(lexer, TOK_LE, "<="); }
-            return makeToken(lexer, TOK_LT, "<");
+            if (peek(lexer) == '=') { advance(lexer); return symbolToken(lexer, TOK_LE, 2); }
+            return symbolToken(lexer, TOK_LT, 1);
         case '>':
-            if (peek(lexer) == '=') { advance(lexer); return makeToken(lexer, TOK_GE, ">="); }
-            return makeToken(lexer, TOK_GT, ">");
+            if (peek(lexer) == '=') { advance(lexer); return symbolToken(lexer, TOK_GE, 2); }
+            return symbolToken(lexer, TOK_GT, 1);
         case '~':
-            if (peek(lexer) == '=') { advance(lexer); return makeToken(lexer, TOK_NE, "~="); }
+            if (peek(lexer) == '=') { advance(lexer); return symbolToken(lexer, TOK_NE, 2); }
             return errorToken(lexer, "Unexpected character '~'");
     }
     
     return errorToken(lexer, "Unexpected character");
 }
 
-Token PeekToken(Lexer* lexer) {
-    int savedPos = lexer->pos;
-    int savedLine = lexer->line;
-    int savedCol = lexer->column;
-    
-    Token token = NextToken(lexer);
+static int growTokens(TokenStream* tokens) {
+    int capacity = tokens->capacity == 0 ? 256 : tokens->capacity * 2;
+    unsigned char* types = (unsigned char*)realloc(tokens->types, capacity);
+    if (types) tokens->types = types;
+    int* offsets = (int*)realloc(tokens->offsets, sizeof(int) * capacity);
+    if (offsets) tokens->offsets = offsets;
+    int* lengths = (int*)realloc(tokens->lengths, sizeof(int) * capacity);
+    if (lengths) tokens->lengths = lengths;
+    int* lines = (int*)realloc(tokens->lines, sizeof(int) * capacity);
+    if (lines) tokens->lines = lines;
+    if (!types || !offsets || !lengths || !lines) return 0;
+    tokens->capacity = capacity;
+    return 1;
+}
+
+int Tokenize(Lexer* lexer) {
+    TokenStream* tokens = &lexer->tokens;
+    tokens->count = 0;
+    tokens->error = NULL;
     
-    lexer->pos = savedPos;
-    lexer->line = savedLine;
-    lexer->column = savedCol;
+    while (1) {
+        // One slot spare so an error can always be followed by EOF
+        if (tokens->count + 2 > tokens->capacity && !growTokens(tokens)) {
+            tokens->count = 0;
+            return 0;
+        }
+        
+        Token token = nextToken(lexer);
+        int i = tokens->count++;
+        tokens->types[i] = (unsigned char)token.type;
+        tokens->lines[i] = token.line;
+        
+        if (token.type == TOK_ERROR) {
+            tokens->error = token.start;
+            tokens->offsets[i] = lexer->pos;
+            tokens->lengths[i] = 0;
+            
+            i = tokens->count++;
+            tokens->types[i] = TOK_EOF;
+            tokens->offsets[i] = lexer->length;
+            tokens->lengths[i] = 0;
+            tokens->lines[i] = token.line;
+            return 1;
+        }
+        
+        tokens->offsets[i] = (int)(token.start - lexer->source);
+        tokens->lengths[i] = token.length;
+        if (token.type == TOK_EOF) return 1;
+    }
+}
+
+Token TokenAt(const Lexer* lexer, int index) {
+    const TokenStream* tokens = &lexer->tokens;
+    Token token;
+    if (tokens->count == 0) {
+        token.type = TOK_EOF;
+        token.start = lexer->source + lexer->length;
+        token.length = 0;
+        token.line = lexer->line;
+        return token;
+    }
+    if (index >= tokens->count) index = tokens->count - 1;
     
+    token.type = (TokenType)tokens->types[index];
+    token.line = tokens->lines[index];
+    if (token.type == TOK_ERROR) {
+        token.start = tokens->error;
+        token.length = (int)strlen(tokens->error);
+    } else {
+        token.start = lexer->source + tokens->offsets[index];
+        token.length = tokens->lengths[index];
+    }
     return token;
 }
 
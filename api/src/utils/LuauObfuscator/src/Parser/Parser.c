@@ -18,36 +18,41 @@ NodeList CreateNodeList() {
     return list;
 }
 
-void AddNode(NodeList* list, ASTNode* node) {
+void AddNode(NodeList* list, ASTNode* node, Arena* arena) {
     if (list->count >= list->capacity) {
-        list->capacity = list->capacity == 0 ? 4 : list->capacity * 2;
-        list->items = (ASTNode**)realloc(list->items, sizeof(ASTNode*) * list->capacity);
+        int capacity = list->capacity == 0 ? 4 : list->capacity * 2;
+        list->items = (ASTNode**)ArenaGrow(arena, list->items,
+            sizeof(ASTNode*) * list->capacity, sizeof(ASTNode*) * capacity);
+        list->capacity = capacity;
     }
     list->items[list->count++] = node;
 }
 
-void FreeNodeList(NodeList* list) {
-    for (int i = 0; i < list->count; i++) {
-        FreeAST(list->items[i]);
-    }
-    free(list->items);
-    list->items = NULL;
-    list->count = 0;
-    list->capacity = 0;
-}
-
-static ASTNode* createNode(NodeType type, int line) {
-    ASTNode* node = (ASTNode*)calloc(1, sizeof(ASTNode));
+static ASTNode* createNode(Parser* parser, NodeType type, int line) {
+    ASTNode* node = (ASTNode*)ArenaAlloc(parser->arena, sizeof(ASTNode));
     node->type = type;
     node->line = line;
+    node->parenthesized = 0;
     return node;
 }
 
-Parser* CreateParser(const char* source) {
+static void addNode(Parser* parser, NodeList* list, ASTNode* node) {
+    AddNode(list, node, parser->arena);
+}
+
+Parser* CreateParser(const char* source, int length) {
     Parser* parser = (Parser*)malloc(sizeof(Parser));
-    parser->lexer = CreateLexer(source);
+    parser->lexer = CreateLexer(source, length);
+    parser->arena = CreateArena(0);
+    parser->strings = CreateStringTable(parser->arena);
     parser->hadError = 0;
     parser->errorMsg[0] = '\0';
+    parser->job = NULL;
+    if (!Tokenize(parser->lexer)) {
+        parser->hadError = 1;
+        snprintf(parser->errorMsg, 256, "Out of memory");
+    }
+    parser->pos = -1;
     advance(parser);
     return parser;
 }
@@ -55,25 +60,45 @@ Parser* CreateParser(const char* source) {
 void FreeParser(Parser* parser) {
     if (parser) {
         FreeLexer(parser->lexer);
+        FreeStringTable(parser->strings);
+        FreeArena(parser->arena);
         free(parser);
     }
 }
 
 static void advance(Parser* parser) {
     parser->previous = parser->current;
-    parser->current = NextToken(parser->lexer);
+    parser->current = TokenAt(parser->lexer, ++parser->pos);
     
     if (parser->current.type == TOK_ERROR) {
         parser->hadError = 1;
-        snprintf(parser->errorMsg, 256, "Line %d: %s", 
-            parser->current.line, parser->current.value);
+        snprintf(parser->errorMsg, 256, "Line %d: %.*s", 
+            parser->current.line, parser->current.length, parser->current.start);
     }
 }
 
+// 1 once the job is stopped; jumps to EOF so every open construct unwinds
+static int stopped(Parser* parser) {
+    if (!parser->job || ContextState(parser->job) == CONTEXT_RUNNING) return 0;
+    parser->hadError = 1;
+    snprintf(parser->errorMsg, 256, "Parsing stopped");
+    parser->pos = parser->lexer->tokens.count - 2;
+    advance(parser);
+    return 1;
+}
+
 static int check(Parser* parser, TokenType type) {
     return parser->current.type == type;
 }
 
+// Type of the token `ahead` places past current
+static TokenType peekType(Parser* parser, int ahead) {
+    const TokenStream* tokens = &parser->lexer->tokens;
+    int index = parser->pos + ahead;
+    if (index >= tokens->count) return TOK_EOF;
+    return (TokenType)tokens->types[index];
+}
+
 static int match(Parser* parser, TokenType type) {
     if (check(parser, type)) {
         advance(parser);
@@ -90,120 +115,42 @@ static void expect(Parser* parser, TokenType type, const char* msg) {
     }
 }
 
-void FreeAST(ASTNode* node) {
-    if (!node) return;
-    
-    switch (node->type) {
-        case NODE_STRING:
-        case NODE_NAME:
-            free(node->data.string);
-            break;
-        case NODE_BINOP:
-            FreeAST(node->data.binop.left);
-            FreeAST(node->data.binop.right);
-            break;
-        case NODE_UNOP:
-            FreeAST(node->data.unop.operand);
-            break;
-        case NODE_LOCAL:
-            FreeNodeList(&node->data.local.names);
-            FreeNodeList(&node->data.local.values);
-            break;
-        case NODE_ASSIGN:
-            FreeNodeList(&node->data.assign.targets);
-            FreeNodeList(&node->data.assign.values);
-            break;
-        case NODE_CALL:
-            FreeAST(node->data.call.func);
-            FreeNodeList(&node->data.call.args);
-            break;
-        case NODE_METHOD_CALL:
-            FreeAST(node->data.methodcall.object);
-            free(node->data.methodcall.method);
-            FreeNodeList(&node->data.methodcall.args);
-            break;
-        case NODE_INDEX:
-            FreeAST(node->data.index.object);
-            FreeAST(node->data.index.key);
-            break;
-        case NODE_DOT_INDEX:
-            FreeAST(node->data.dotindex.object);
-            free(node->data.dotindex.field);
-            break;
-        case NODE_IF:
-            FreeAST(node->data.ifstmt.condition);
-            FreeAST(node->data.ifstmt.thenBlock);
-            FreeNodeList(&node->data.ifstmt.elseifs);
-            FreeAST(node->data.ifstmt.elseBlock);
-            break;
-        case NODE_WHILE:
-            FreeAST(node->data.whilestmt.condition);
-            FreeAST(node->data.whilestmt.body);
-            break;
-        case NODE_FOR_NUM:
-            free(node->data.fornum.var);
-            FreeAST(node->data.fornum.start);
-            FreeAST(node->data.fornum.limit);
-            FreeAST(node->data.fornum.step);
-            FreeAST(node->data.fornum.body);
-            break;
-        case NODE_FOR_IN:
-            FreeNodeList(&node->data.forin.names);
-            FreeNodeList(&node->data.forin.iterators);
-            FreeAST(node->data.forin.body);
-            break;
-        case NODE_FUNCTION:
-        case NODE_LOCAL_FUNCTION:
-            free(node->data.func.name);
-            FreeNodeList(&node->data.func.params);
-            FreeAST(node->data.func.body);
-            break;
-        case NODE_RETURN:
-            FreeNodeList(&node->data.ret.values);
-            break;
-        case NODE_TABLE:
-            FreeNodeList(&node->data.table.fields);
-            break;
-        case NODE_TABLE_FIELD:
-            FreeAST(node->data.field.key);
-            FreeAST(node->data.field.value);
-            break;
-        case NODE_BLOCK:
-        case NODE_CHUNK:
-            FreeNodeList(&node->data.block.statements);
-            break;
-        default:
-            break;
-    }
-    free(node);
-}
-
 static ASTNode* parseNumber(Parser* parser) {
-    ASTNode* node = createNode(NODE_NUMBER, parser->previous.line);
-    node->data.number = atof(parser->previous.value);
+    ASTNode* node = createNode(parser, NODE_NUMBER, parser->previous.line);
+    // The token is not NUL-terminated; convert from a bounded copy
+    char text[64];
+    int len = parser->previous.length < 63 ? parser->previous.length : 63;
+    memcpy(text, parser->previous.start, len);
+    text[len] = '\0';
+    node->data.number = atof(text);
     return node;
 }
 
+// Copy an operator token (at most 3 characters) into a node's op field
+static void copyOperator(char op[4], const Token* token) {
+    int len = token->length < 3 ? token->length : 3;
+    memcpy(op, token->start, len);
+    op[len] = '\0';
+}
+
 static ASTNode* parseString(Parser* parser) {
-    ASTNode* node = createNode(NODE_STRING, parser->previous.line);
-    node->data.string = strdup(parser->previous.value);
+    ASTNode* node = createNode(parser, NODE_STRING, parser->previous.line);
+    node->data.string = InternToken(&parser->previous, parser->strings);
     return node;
 }
 
 static ASTNode* parseName(Parser* parser) {
-    ASTNode* node = createNode(NODE_NAME, parser->previous.line);
-    node->data.string = strdup(parser->previous.value);
+    ASTNode* node = createNode(parser, NODE_NAME, parser->previous.line);
+    node->data.string = InternToken(&parser->previous, parser->strings);
     return node;
 }
 
 static ASTNode* parseTableConstructor(Parser* parser) {
-    ASTNode* node = createNode(NODE_TABLE, parser->previous.line);
+    ASTNode* node = createNode(parser, NODE_TABLE, parser->previous.line);
     node->data.table.fields = CreateNodeList();
     
-    int arrayIndex = 1;
-    
     while (!check(parser, TOK_RBRACE) && !check(parser, TOK_EOF)) {
-        ASTNode* field = createNode(NODE_TABLE_FIELD, parser->current.line);
+        ASTNode* field = createNode(parser, NODE_TABLE_FIELD, parser->current.line);
         
         if (check(parser, TOK_LBRACKET)) {
             // [expr] = expr
@@ -212,23 +159,21 @@ static ASTNode* parseTableConstructor(Parser* parser) {
             expect(parser, TOK_RBRACKET, "]");
             expect(parser, TOK_ASSIGN, "=");
             field->data.field.value = parseExpression(parser);
-        } else if (check(parser, TOK_NAME) && PeekToken(parser->lexer).type == TOK_ASSIGN) {
+        } else if (check(parser, TOK_NAME) && peekType(parser, 1) == TOK_ASSIGN) {
             // name = expr
             advance(parser);
-            ASTNode* key = createNode(NODE_STRING, parser->previous.line);
-            key->data.string = strdup(parser->previous.value);
+            ASTNode* key = createNode(parser, NODE_STRING, parser->previous.line);
+            key->data.string = InternToken(&parser->previous, parser->strings);
             field->data.field.key = key;
             expect(parser, TOK_ASSIGN, "=");
             field->data.field.value = parseExpression(parser);
         } else {
-            // Array element
-            ASTNode* key = createNode(NODE_NUMBER, parser->current.line);
-            key->data.number = arrayIndex++;
-            field->data.field.key = key;
+            // Array element: no key, so it takes the next list index
+            field->data.field.key = NULL;
             field->data.field.value = parseExpression(parser);
         }
         
-        AddNode(&node->data.table.fields, field);
+        addNode(parser, &node->data.table.fields, field);
         
         if (!match(parser, TOK_COMMA) && !match(parser, TOK_SEMICOLON)) {
             break;
@@ -242,7 +187,7 @@ static ASTNode* parseTableConstructor(Parser* parser) {
 static ASTNode* parseFunctionBody(Parser* parser) {
     expect(parser, TOK_LPAREN, "(");
     
-    ASTNode* node = createNode(NODE_FUNCTION, parser->previous.line);
+    ASTNode* node = createNode(parser, NODE_FUNCTION, parser->previous.line);
     node->data.func.name = NULL;
     node->data.func.params = CreateNodeList();
     node->data.func.isVararg = 0;
@@ -255,9 +200,9 @@ static ASTNode* parseFunctionBody(Parser* parser) {
         }
         
         expect(parser, TOK_NAME, "parameter name");
-        ASTNode* param = createNode(NODE_NAME, parser->previous.line);
-        param->data.string = strdup(parser->previous.value);
-        AddNode(&node->data.func.params, param);
+        ASTNode* param = createNode(parser, NODE_NAME, parser->previous.line);
+        param->data.string = InternToken(&parser->previous, parser->strings);
+        addNode(parser, &node->data.func.params, param);
         
         if (!match(parser, TOK_COMMA)) break;
     }
@@ -271,12 +216,13 @@ static ASTNode* parseFunctionBody(Parser* parser) {
 
 static ASTNode* parsePrimaryExpr(Parser* parser) {
     if (check(parser, TOK_EOF)) {
-        return createNode(NODE_NIL, parser->current.line);
+        return createNode(parser, NODE_NIL, parser->current.line);
     }
     
     if (match(parser, TOK_LPAREN)) {
         ASTNode* expr = parseExpression(parser);
         expect(parser, TOK_RPAREN, ")");
+        expr->parenthesized = 1;
         return expr;
     }
     
@@ -287,13 +233,13 @@ static ASTNode* parsePrimaryExpr(Parser* parser) {
     // Don't error on block-ending tokens
     if (check(parser, TOK_END) || check(parser, TOK_ELSE) || 
         check(parser, TOK_ELSEIF) || check(parser, TOK_UNTIL)) {
-        return createNode(NODE_NIL, parser->current.line);
+        return createNode(parser, NODE_NIL, parser->current.line);
     }
     
     parser->hadError = 1;
     snprintf(parser->errorMsg, 256, "Line %d: Expected expression, got %s", 
         parser->current.line, TokenTypeName(parser->current.type));
-    return createNode(NODE_NIL, parser->current.line);
+    return createNode(parser, NODE_NIL, parser->current.line);
 }
 
 static NodeList parseArgs(Parser* parser) {
@@ -301,20 +247,20 @@ static NodeList parseArgs(Parser* parser) {
     
     if (check(parser, TOK_STRING)) {
         advance(parser);
-        AddNode(&args, parseString(parser));
+        addNode(parser, &args, parseString(parser));
         return args;
     }
     
     if (check(parser, TOK_LBRACE)) {
         advance(parser);
-        AddNode(&args, parseTableConstructor(parser));
+        addNode(parser, &args, parseTableConstructor(parser));
         return args;
     }
     
     expect(parser, TOK_LPAREN, "(");
     
     while (!check(parser, TOK_RPAREN) && !check(parser, TOK_EOF)) {
-        AddNode(&args, parseExpression(parser));
+        addNode(parser, &args, parseExpression(parser));
         if (!match(parser, TOK_COMMA)) break;
     }
     
@@ -328,29 +274,29 @@ static ASTNode* parseSuffixedExpr(Parser* parser) {
     while (1) {
         if (match(parser, TOK_DOT)) {
             expect(parser, TOK_NAME, "field name");
-            ASTNode* newExpr = createNode(NODE_DOT_INDEX, parser->previous.line);
+            ASTNode* newExpr = createNode(parser, NODE_DOT_INDEX, parser->previous.line);
             newExpr->data.dotindex.object = expr;
-            newExpr->data.dotindex.field = strdup(parser->previous.value);
+            newExpr->data.dotindex.field = InternToken(&parser->previous, parser->strings);
             expr = newExpr;
         } else if (match(parser, TOK_LBRACKET)) {
-            ASTNode* newExpr = createNode(NODE_INDEX, parser->current.line);
+            ASTNode* newExpr = createNode(parser, NODE_INDEX, parser->current.line);
             newExpr->data.index.object = expr;
             newExpr->data.index.key = parseExpression(parser);
             expect(parser, TOK_RBRACKET, "]");
             expr = newExpr;
         } else if (match(parser, TOK_COLON)) {
             expect(parser, TOK_NAME, "method name");
-            char* method = strdup(parser->previous.value);
+            const char* method = InternToken(&parser->previous, parser->strings);
             NodeList args = parseArgs(parser);
             
-            ASTNode* newExpr = createNode(NODE_METHOD_CALL, parser->previous.line);
+            ASTNode* newExpr = createNode(parser, NODE_METHOD_CALL, parser->previous.line);
             newExpr->data.methodcall.object = expr;
             newExpr->data.methodcall.method = method;
             newExpr->data.methodcall.args = args;
             expr = newExpr;
         } else if (check(parser, TOK_LPAREN) || check(parser, TOK_STRING) || check(parser, TOK_LBRACE)) {
             NodeList args = parseArgs(parser);
-            ASTNode* newExpr = createNode(NODE_CALL, parser->previous.line);
+            ASTNode* newExpr = createNode(parser, NODE_CALL, parser->previous.line);
             newExpr->data.call.func = expr;
             newExpr->data.call.args = args;
             expr = newExpr;
@@ -366,17 +312,17 @@ static ASTNode* parseSimpleExpr(Parser* parser) {
     if (match(parser, TOK_NUMBER)) return parseNumber(parser);
     if (match(parser, TOK_STRING)) return parseString(parser);
     if (match(parser, TOK_TRUE)) {
-        ASTNode* node = createNode(NODE_BOOL, parser->previous.line);
+        ASTNode* node = createNode(parser, NODE_BOOL, parser->previous.line);
         node->data.boolean = 1;
         return node;
     }
     if (match(parser, TOK_FALSE)) {
-        ASTNode* node = createNode(NODE_BOOL, parser->previous.line);
+        ASTNode* node = createNode(parser, NODE_BOOL, parser->previous.line);
         node->data.boolean = 0;
         return node;
     }
-    if (match(parser, TOK_NIL)) return createNode(NODE_NIL, parser->previous.line);
-    if (match(parser, TOK_DOTDOTDOT)) return createNode(NODE_VARARG, parser->previous.line);
+    if (match(parser, TOK_NIL)) return createNode(parser, NODE_NIL, parser->previous.line);
+    if (match(parser, TOK_DOTDOTDOT)) return createNode(parser, NODE_VARARG, parser->previous.line);
     if (match(parser, TOK_LBRACE)) return parseTableConstructor(parser);
     if (match(parser, TOK_FUNCTION)) return parseFunctionBody(parser);
     
@@ -385,8 +331,8 @@ static ASTNode* parseSimpleExpr(Parser* parser) {
 
 static ASTNode* parseUnaryExpr(Parser* parser) {
     if (match(parser, TOK_NOT) || match(parser, TOK_MINUS) || match(parser, TOK_HASH)) {
-        ASTNode* node = createNode(NODE_UNOP, parser->previous.line);
-        strcpy(node->data.unop.op, parser->previous.value);
+        ASTNode* node = createNode(parser, NODE_UNOP, parser->previous.line);
+        copyOperator(node->data.unop.op, &parser->previous);
         node->data.unop.operand = parseUnaryExpr(parser);
         return node;
     }
@@ -425,8 +371,8 @@ static ASTNode* parseBinopExpr(Parser* parser, int minPrec) {
         
         ASTNode* right = parseBinopExpr(parser, nextPrec);
         
-        ASTNode* node = createNode(NODE_BINOP, op.line);
-        strcpy(node->data.binop.op, op.value);
+        ASTNode* node = createNode(parser, NODE_BINOP, op.line);
+        copyOperator(node->data.binop.op, &op);
         node->data.binop.left = left;
         node->data.binop.right = right;
         left = node;
@@ -440,7 +386,7 @@ static ASTNode* parseExpression(Parser* parser) {
 }
 
 static ASTNode* parseIfStatement(Parser* parser) {
-    ASTNode* node = createNode(NODE_IF, parser->previous.line);
+    ASTNode* node = createNode(parser, NODE_IF, parser->previous.line);
     node->data.ifstmt.condition = parseExpression(parser);
     expect(parser, TOK_THEN, "then");
     node->data.ifstmt.thenBlock = parseBlock(parser);
@@ -448,13 +394,13 @@ static ASTNode* parseIfStatement(Parser* parser) {
     node->data.ifstmt.elseBlock = NULL;
     
     while (match(parser, TOK_ELSEIF)) {
-        ASTNode* elseif = createNode(NODE_IF, parser->previous.line);
+        ASTNode* elseif = createNode(parser, NODE_IF, parser->previous.line);
         elseif->data.ifstmt.condition = parseExpression(parser);
         expect(parser, TOK_THEN, "then");
         elseif->data.ifstmt.thenBlock = parseBlock(parser);
         elseif->data.ifstmt.elseifs = CreateNodeList();
         elseif->data.ifstmt.elseBlock = NULL;
-        AddNode(&node->data.ifstmt.elseifs, elseif);
+        addNode(parser, &node->data.ifstmt.elseifs, elseif);
     }
     
     if (match(parser, TOK_ELSE)) {
@@ -466,7 +412,7 @@ static ASTNode* parseIfStatement(Parser* parser) {
 }
 
 static ASTNode* parseWhileStatement(Parser* parser) {
-    ASTNode* node = createNode(NODE_WHILE, parser->previous.line);
+    ASTNode* node = createNode(parser, NODE_WHILE, parser->previous.line);
     node->data.whilestmt.condition = parseExpression(parser);
     expect(parser, TOK_DO, "do");
     node->data.whilestmt.body = parseBlock(parser);
@@ -476,11 +422,11 @@ static ASTNode* parseWhileStatement(Parser* parser) {
 
 static ASTNode* parseForStatement(Parser* parser) {
     expect(parser, TOK_NAME, "variable name");
-    char* firstName = strdup(parser->previous.value);
+    const char* firstName = InternToken(&parser->previous, parser->strings);
     
     if (match(parser, TOK_ASSIGN)) {
         // Numeric for
-        ASTNode* node = createNode(NODE_FOR_NUM, parser->previous.line);
+        ASTNode* node = createNode(parser, NODE_FOR_NUM, parser->previous.line);
         node->data.fornum.var = firstName;
         node->data.fornum.start = parseExpression(parser);
         expect(parser, TOK_COMMA, ",");
@@ -489,7 +435,7 @@ static ASTNode* parseForStatement(Parser* parser) {
         if (match(parser, TOK_COMMA)) {
             node->data.fornum.step = parseExpression(parser);
         } else {
-            ASTNode* one = createNode(NODE_NUMBER, parser->current.line);
+            ASTNode* one = createNode(parser, NODE_NUMBER, parser->current.line);
             one->data.number = 1;
             node->data.fornum.step = one;
         }
@@ -500,26 +446,26 @@ static ASTNode* parseForStatement(Parser* parser) {
         return node;
     } else {
         // Generic for
-        ASTNode* node = createNode(NODE_FOR_IN, parser->previous.line);
+        ASTNode* node = createNode(parser, NODE_FOR_IN, parser->previous.line);
         node->data.forin.names = CreateNodeList();
         node->data.forin.iterators = CreateNodeList();
         
-        ASTNode* nameNode = createNode(NODE_NAME, parser->previous.line);
+        ASTNode* nameNode = createNode(parser, NODE_NAME, parser->previous.line);
         nameNode->data.string = firstName;
-        AddNode(&node->data.forin.names, nameNode);
+        addNode(parser, &node->data.forin.names, nameNode);
         
         while (match(parser, TOK_COMMA)) {
             expect(parser, TOK_NAME, "variable name");
-            ASTNode* n = createNode(NODE_NAME, parser->previous.line);
-            n->data.string = strdup(parser->previous.value);
-            AddNode(&node->data.forin.names, n);
+            ASTNode* n = createNode(parser, NODE_NAME, parser->previous.line);
+            n->data.string = InternToken(&parser->previous, parser->strings);
+            addNode(parser, &node->data.forin.names, n);
         }
         
         expect(parser, TOK_IN, "in");
         
-        AddNode(&node->data.forin.iterators, parseExpression(parser));
+        addNode(parser, &node->data.forin.iterators, parseExpression(parser));
         while (match(parser, TOK_COMMA)) {
-            AddNode(&node->data.forin.iterators, parseExpression(parser));
+            addNode(parser, &node->data.forin.iterators, parseExpression(parser));
         }
         
         expect(parser, TOK_DO, "do");
@@ -530,41 +476,43 @@ static ASTNode* parseForStatement(Parser* parser) {
 }
 
 static ASTNode* parseRepeatStatement(Parser* parser) {
-    ASTNode* node = createNode(NODE_WHILE, parser->previous.line); // Reuse while node
+    // Shares the while node's fields; the body runs before the first test
+    ASTNode* node = createNode(parser, NODE_REPEAT, parser->previous.line);
     node->data.whilestmt.body = parseBlock(parser);
     expect(parser, TOK_UNTIL, "until");
-    
-    // Negate condition for repeat-until
-    ASTNode* cond = parseExpression(parser);
-    ASTNode* notNode = createNode(NODE_UNOP, cond->line);
-    strcpy(notNode->data.unop.op, "not");
-    notNode->data.unop.operand = cond;
-    node->data.whilestmt.condition = notNode;
-    
+    node->data.whilestmt.condition = parseExpression(parser);
     return node;
 }
 
+// Interned "<base><sep><previous token>" for dotted and method function names
+static const char* joinName(Parser* parser, const char* base, char sep) {
+    int baseLen = (int)strlen(base);
+    int len = baseLen + 1 + parser->previous.length;
+    char* name = (char*)malloc(len);
+    if (!name) return base;
+    memcpy(name, base, baseLen);
+    name[baseLen] = sep;
+    memcpy(name + baseLen + 1, parser->previous.start, parser->previous.length);
+    const char* interned = InternString(parser->strings, name, len);
+    free(name);
+    return interned;
+}
+
 static ASTNode* parseFunctionStatement(Parser* parser, int isLocal) {
-    ASTNode* node = createNode(isLocal ? NODE_LOCAL_FUNCTION : NODE_FUNCTION, parser->previous.line);
+    ASTNode* node = createNode(parser, isLocal ? NODE_LOCAL_FUNCTION : NODE_FUNCTION, parser->previous.line);
     
     expect(parser, TOK_NAME, "function name");
-    node->data.func.name = strdup(parser->previous.value);
+    node->data.func.name = InternToken(&parser->previous, parser->strings);
     
     // Handle method syntax: function obj:method()
     while (match(parser, TOK_DOT)) {
         expect(parser, TOK_NAME, "field name");
-        char* newName = (char*)malloc(strlen(node->data.func.name) + strlen(parser->previous.value) + 2);
-        sprintf(newName, "%s.%s", node->data.func.name, parser->previous.value);
-        free(node->data.func.name);
-        node->data.func.name = newName;
+        node->data.func.name = joinName(parser, node->data.func.name, '.');
     }
     
     if (match(parser, TOK_COLON)) {
         expect(parser, TOK_NAME, "method name");
-        char* newName = (char*)malloc(strlen(node->data.func.name) + strlen(parser->previous.value) + 2);
-        sprintf(newName, "%s:%s", node->data.func.name, parser->previous.value);
-        free(node->data.func.name);
-        node->data.func.name = newName;
+        node->data.func.name = joinName(parser, node->data.func.name, ':');
     }
     
     expect(parser, TOK_LPAREN, "(");
@@ -577,9 +525,9 @@ static ASTNode* parseFunctionStatement(Parser* parser, int isLocal) {
             break;
         }
         expect(parser, TOK_NAME, "parameter name");
-        ASTNode* param = createNode(NODE_NAME, parser->previous.line);
-        param->data.string = strdup(parser->previous.value);
-        AddNode(&node->data.func.params, param);
+        ASTNode* param = createNode(parser, NODE_NAME, parser->previous.line);
+        param->data.string = InternToken(&parser->previous, parser->strings);
+        addNode(parser, &node->data.func.params, param);
         if (!match(parser, TOK_COMMA)) break;
     }
     
@@ -595,20 +543,20 @@ static ASTNode* parseLocalStatement(Parser* parser) {
         return parseFunctionStatement(parser, 1);
     }
     
-    ASTNode* node = createNode(NODE_LOCAL, parser->previous.line);
+    ASTNode* node = createNode(parser, NODE_LOCAL, parser->previous.line);
     node->data.local.names = CreateNodeList();
     node->data.local.values = CreateNodeList();
     
     do {
         expect(parser, TOK_NAME, "variable name");
-        ASTNode* name = createNode(NODE_NAME, parser->previous.line);
-        name->data.string = strdup(parser->previous.value);
-        AddNode(&node->data.local.names, name);
+        ASTNode* name = createNode(parser, NODE_NAME, parser->previous.line);
+        name->data.string = InternToken(&parser->previous, parser->strings);
+        addNode(parser, &node->data.local.names, name);
     } while (match(parser, TOK_COMMA));
     
     if (match(parser, TOK_ASSIGN)) {
         do {
-            AddNode(&node->data.local.values, parseExpression(parser));
+            addNode(parser, &node->data.local.values, parseExpression(parser));
         } while (match(parser, TOK_COMMA));
     }
     
@@ -616,13 +564,13 @@ static ASTNode* parseLocalStatement(Parser* parser) {
 }
 
 static ASTNode* parseReturnStatement(Parser* parser) {
-    ASTNode* node = createNode(NODE_RETURN, parser->previous.line);
+    ASTNode* node = createNode(parser, NODE_RETURN, parser->previous.line);
     node->data.ret.values = CreateNodeList();
     
     if (!check(parser, TOK_END) && !check(parser, TOK_ELSE) && 
         !check(parser, TOK_ELSEIF) && !check(parser, TOK_UNTIL) && !check(parser, TOK_EOF)) {
         do {
-            AddNode(&node->data.ret.values, parseExpression(parser));
+            addNode(parser, &node->data.ret.values, parseExpression(parser));
         } while (match(parser, TOK_COMMA));
     }
     
@@ -639,7 +587,7 @@ static ASTNode* parseStatement(Parser* parser) {
     if (match(parser, TOK_FUNCTION)) return parseFunctionStatement(parser, 0);
     if (match(parser, TOK_LOCAL)) return parseLocalStatement(parser);
     if (match(parser, TOK_RETURN)) return parseReturnStatement(parser);
-    if (match(parser, TOK_BREAK)) return createNode(NODE_BREAK, parser->previous.line);
+    if (match(parser, TOK_BREAK)) return createNode(parser, NODE_BREAK, parser->previous.line);
     if (match(parser, TOK_DO)) {
         ASTNode* block = parseBlock(parser);
         expect(parser, TOK_END, "end");
@@ -662,14 +610,14 @@ static ASTNode* parseStatement(Parser* parser) {
     
     if (match(parser, TOK_ASSIGN) || match(parser, TOK_COMMA)) {
         // Assignment
-        ASTNode* node = createNode(NODE_ASSIGN, expr->line);
+        ASTNode* node = createNode(parser, NODE_ASSIGN, expr->line);
         node->data.assign.targets = CreateNodeList();
         node->data.assign.values = CreateNodeList();
         
-        AddNode(&node->data.assign.targets, expr);
+        addNode(parser, &node->data.assign.targets, expr);
         
         while (parser->previous.type == TOK_COMMA) {
-            AddNode(&node->data.assign.targets, parseSuffixedExpr(parser));
+            addNode(parser, &node->data.assign.targets, parseSuffixedExpr(parser));
             if (!match(parser, TOK_COMMA)) break;
         }
         
@@ -678,7 +626,7 @@ static ASTNode* parseStatement(Parser* parser) {
         }
         
         do {
-            AddNode(&node->data.assign.values, parseExpression(parser));
+            addNode(parser, &node->data.assign.values, parseExpression(parser));
         } while (match(parser, TOK_COMMA));
         
         return node;
@@ -689,13 +637,14 @@ static ASTNode* parseStatement(Parser* parser) {
 }
 
 static ASTNode* parseBlock(Parser* parser) {
-    ASTNode* block = createNode(NODE_BLOCK, parser->current.line);
+    ASTNode* block = createNode(parser, NODE_BLOCK, parser->current.line);
     block->data.block.statements = CreateNodeList();
     
     while (!check(parser, TOK_END) && !check(parser, TOK_ELSE) && 
            !check(parser, TOK_ELSEIF) && !check(parser, TOK_UNTIL) && !check(parser, TOK_EOF)) {
+        if (stopped(parser)) break;
         ASTNode* stmt = parseStatement(parser);
-        if (stmt) AddNode(&block->data.block.statements, stmt);
+        if (stmt) addNode(parser, &block->data.block.statements, stmt);
         match(parser, TOK_SEMICOLON);
     }
     
@@ -703,13 +652,14 @@ static ASTNode* parseBlock(Parser* parser) {
 }
 
 ASTNode* Parse(Parser* parser) {
-    ASTNode* chunk = createNode(NODE_CHUNK, 1);
+    ASTNode* chunk = createNode(parser, NODE_CHUNK, 1);
     chunk->data.block.statements = CreateNodeList();
     
     while (!check(parser, TOK_EOF) && !parser->hadError) {
+        if (stopped(parser)) break;
         ASTNode* stmt = parseStatement(parser);
         if (stmt) {
-            AddNode(&chunk->data.block.statements, stmt);
+            addNode(parser, &chunk->data.block.statements, stmt);
         } else if (!check(parser, TOK_EOF)) {
             // If no statement and not EOF, skip unknown token
             if (!parser->hadError) {
@@ -1,14 +1,15 @@
 #include "../../include/Polymorphic.h"
 #include "../../include/Utils.h"
 
-PolymorphicContext* CreatePolymorphicContext(int seed) {
+PolymorphicContext* CreatePolymorphicContext(int seed, ObfContext* obf) {
     PolymorphicContext* ctx = (PolymorphicContext*)malloc(sizeof(PolymorphicContext));
+    ctx->obf = obf;
     ctx->templateCount = 0;
-    ctx->buildSeed = seed > 0 ? seed : RandomInt(1, 0xFFFFFF);
+    ctx->buildSeed = seed > 0 ? seed : RandomInt(obf, 1, 0xFFFFFF);
     
     // Pre-select variants for this build
     for (int i = 0; i < MAX_TEMPLATES; i++) {
-        ctx->variantChoices[i] = RandomInt(0, MAX_VARIANTS - 1);
+        ctx->variantChoices[i] = RandomInt(obf, 0, MAX_VARIANTS - 1);
     }
     
     return ctx;
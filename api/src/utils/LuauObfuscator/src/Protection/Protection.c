@@ -15,7 +15,7 @@ char* GetAntiDebugCode() {
     return strdup("local BB=function(u) while false do u[0]=0; end if debug and debug.info then while true do end end return 1 end");
 }
 
-char* GetControlFlowJunk() {
+char* GetControlFlowJunk(ObfContext* obf) {
     // Generates a junk loop akin to the user's example
     // loop: while-239 do ...
     // Note: 'while -239 do' in Lua 5.1 is valid (numbers are true), but infinite loop unless break. 
@@ -23,6 +23,8 @@ char* GetControlFlowJunk() {
     // Actually in Lua: all numbers are true. 'while -239' is 'while true'. 
     // Maybe they rely on 'break' or it's just fake code that never runs.
     
+    char* name = GenerateRandomString(obf, 5);
+    char* hex = GenerateRandomHex(obf, 3);
     char* junk = (char*)malloc(512);
     snprintf(junk, 512, 
         "local junk_%s = function() "
@@ -32,8 +34,10 @@ char* GetControlFlowJunk() {
         "       if (x %% 2 == 0) then end "
         "   end "
         "end", 
-        GenerateRandomString(5), 
-        GenerateRandomHex(3)
+        name, 
+        hex
     );
+    free(name);
+    free(hex);
     return junk;
 }
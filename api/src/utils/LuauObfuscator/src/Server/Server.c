@@ -0,0 +1,500 @@
+#include "../../include/Server.h"
+#include "../../include/Utils.h"
+#include "../../include/Obfuscator.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+// ============================================
+// WIRE FORMAT
+// ============================================
+//
+// All integers are little endian. Every frame starts with a u32 length
+// covering the rest of the frame.
+//
+// Request:  u32 length | u8 kind | u32 id | body
+//   kind 0 (obfuscate): u64 seed (0 = random) | u32 options | u32 timeoutMs (0 = none)
+//                       | u32 watermarkLen | watermark | u32 sourceLen | source
+//   kind 1 (cancel):    no body, cancels job id whether queued or running; a
+//                       running job stops at its next statement or generator
+//                       section and answers cancelled
+//   kind 2 (pooled):    u32 keyLen | key | kind 0 body; served from the builds
+//                       pre-generated for key when the server runs with a pool
+// Response: u32 length | u32 id | u8 status | body
+//   status ok: u64 seed | script (the seed reproduces the build when sent back)
+//   otherwise: error message
+//
+// Jobs run on a fixed pool of worker threads, so responses can come back
+// in any order. When the queue is full the request is answered "busy"
+// at once instead of waiting. Workers with nothing queued top up the
+// variant pool. stdout carries frames only; logging goes to stderr while
+// serving.
+
+#define SERVE_MAX_FRAME (64 * 1024 * 1024)
+#define SERVE_MAX_WORKERS 256
+
+#define SERVE_KIND_OBFUSCATE 0
+#define SERVE_KIND_CANCEL 1
+#define SERVE_KIND_POOLED 2
+
+#define SERVE_STATUS_OK 0
+#define SERVE_STATUS_ERROR 1
+#define SERVE_STATUS_BUSY 2
+#define SERVE_STATUS_TIMEOUT 3
+#define SERVE_STATUS_CANCELLED 4
+
+typedef struct {
+    unsigned int id;
+    unsigned char* frame;       // Owns the watermark and source bytes
+    const char* source;
+    size_t sourceLength;
+    const char* key;            // Pool key for kind 2, NULL otherwise
+    size_t keyLength;
+    ObfOptions options;
+    long long deadline;         // MonotonicMs() limit, 0 = none
+    volatile int cancel;
+} ServerJob;
+
+// ============================================
+// BOUNDED MPMC QUEUE (lock-free ring, per-cell sequence numbers)
+// ============================================
+
+typedef struct {
+    size_t sequence;
+    ServerJob* job;
+} QueueCell;
+
+typedef struct {
+    QueueCell* cells;
+    size_t mask;
+    size_t enqueuePos;
+    size_t dequeuePos;
+} JobQueue;
+
+static int initQueue(JobQueue* queue, int depth) {
+    size_t capacity = 2;
+    while (capacity < (size_t)depth) capacity <<= 1;
+
+    queue->cells = (QueueCell*)malloc(sizeof(QueueCell) * capacity);
+    if (!queue->cells) return 0;
+    for (size_t i = 0; i < capacity; i++) {
+        queue->cells[i].sequence = i;
+        queue->cells[i].job = NULL;
+    }
+    queue->mask = capacity - 1;
+    queue->enqueuePos = 0;
+    queue->dequeuePos = 0;
+    return 1;
+}
+
+static int queuePush(JobQueue* queue, ServerJob* job) {
+    size_t pos = __atomic_load_n(&queue->enqueuePos, __ATOMIC_RELAXED);
+    for (;;) {
+        QueueCell* cell = &queue->cells[pos & queue->mask];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        long diff = (long)seq - (long)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->enqueuePos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                cell->job = job;
+                __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;  // Full
+        } else {
+            pos = __atomic_load_n(&queue->enqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static ServerJob* queuePop(JobQueue* queue) {
+    size_t pos = __atomic_load_n(&queue->dequeuePos, __ATOMIC_RELAXED);
+    for (;;) {
+        QueueCell* cell = &queue->cells[pos & queue->mask];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        long diff = (long)seq - (long)(pos + 1);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->dequeuePos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                ServerJob* job = cell->job;
+                __atomic_store_n(&cell->sequence, pos + queue->mask + 1, __ATOMIC_RELEASE);
+                return job;
+            }
+        } else if (diff < 0) {
+            return NULL;  // Empty
+        } else {
+            pos = __atomic_load_n(&queue->dequeuePos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// ============================================
+// SERVER STATE
+// ============================================
+
+typedef struct {
+    JobQueue queue;
+    sem_t available;            // One post per queued job, per refill wake-up and per worker at shutdown
+    int queueDepth;
+    int queued;                 // Jobs accepted but not yet picked up (atomic)
+    int workers;
+    int stopping;               // Set once stdin closed (atomic)
+
+    VariantPool* pool;          // Pre-generated builds, NULL without --pool
+
+    pthread_mutex_t outputLock;
+
+    // Jobs that can still be cancelled, looked up by id
+    pthread_mutex_t activeLock;
+    ServerJob** active;
+    int activeCapacity;
+} Server;
+
+static int readExact(FILE* f, void* dst, size_t len) {
+    return fread(dst, 1, len, f) == len;
+}
+
+static unsigned int getU32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static void putU32(unsigned char* p, unsigned int v) {
+    p[0] = (unsigned char)(v & 0xFF);
+    p[1] = (unsigned char)((v >> 8) & 0xFF);
+    p[2] = (unsigned char)((v >> 16) & 0xFF);
+    p[3] = (unsigned char)((v >> 24) & 0xFF);
+}
+
+static void writeResponse(Server* server, unsigned int id, int status, const char* body, size_t bodyLen) {
+    unsigned char header[9];
+    putU32(header, (unsigned int)(bodyLen + 5));
+    putU32(header + 4, id);
+    header[8] = (unsigned char)status;
+
+    pthread_mutex_lock(&server->outputLock);
+    fwrite(header, 1, sizeof(header), stdout);
+    if (bodyLen > 0) fwrite(body, 1, bodyLen, stdout);
+    fflush(stdout);
+    pthread_mutex_unlock(&server->outputLock);
+}
+
+static void writeScript(Server* server, unsigned int id, unsigned long long seed,
+                        const char* script, size_t scriptLen) {
+    unsigned char header[17];
+    putU32(header, (unsigned int)(scriptLen + 13));
+    putU32(header + 4, id);
+    header[8] = SERVE_STATUS_OK;
+    putU32(header + 9, (unsigned int)(seed & 0xFFFFFFFF));
+    putU32(header + 13, (unsigned int)(seed >> 32));
+
+    pthread_mutex_lock(&server->outputLock);
+    fwrite(header, 1, sizeof(header), stdout);
+    fwrite(script, 1, scriptLen, stdout);
+    fflush(stdout);
+    pthread_mutex_unlock(&server->outputLock);
+}
+
+static void writeMessage(Server* server, unsigned int id, int status, const char* msg) {
+    writeResponse(server, id, status, msg, strlen(msg));
+}
+
+static int trackJob(Server* server, ServerJob* job) {
+    int tracked = 0;
+    pthread_mutex_lock(&server->activeLock);
+    for (int i = 0; i < server->activeCapacity; i++) {
+        if (!server->active[i]) {
+            server->active[i] = job;
+            tracked = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&server->activeLock);
+    return tracked;
+}
+
+static void untrackJob(Server* server, ServerJob* job) {
+    pthread_mutex_lock(&server->activeLock);
+    for (int i = 0; i < server->activeCapacity; i++) {
+        if (server->active[i] == job) {
+            server->active[i] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&server->activeLock);
+}
+
+static void cancelJob(Server* server, unsigned int id) {
+    pthread_mutex_lock(&server->activeLock);
+    for (int i = 0; i < server->activeCapacity; i++) {
+        if (server->active[i] && server->active[i]->id == id) {
+            server->active[i]->cancel = 1;
+        }
+    }
+    pthread_mutex_unlock(&server->activeLock);
+}
+
+static void freeJob(ServerJob* job) {
+    free(job->frame);
+    free(job);
+}
+
+// ============================================
+// WORKERS
+// ============================================
+
+static void runJob(Server* server, ServerJob* job) {
+    if (job->cancel) {
+        writeMessage(server, job->id, SERVE_STATUS_CANCELLED, "Job cancelled");
+        return;
+    }
+
+    // Time spent queued counts against the deadline
+    if (job->deadline) {
+        long long remaining = job->deadline - MonotonicMs();
+        if (remaining <= 0) {
+            writeMessage(server, job->id, SERVE_STATUS_TIMEOUT, "Job deadline exceeded");
+            return;
+        }
+        job->options.timeoutMs = (unsigned int)remaining;
+    }
+
+    // Every job gets its own context (RNG, counters, compiler state) inside
+    // ObfuscateBuffer, so workers share nothing but the queue
+    ObfResult result;
+    int status = job->key && server->pool
+        ? ObfuscatePooled(server->pool, job->key, job->keyLength, job->source, job->sourceLength,
+                          &job->options, &result)
+        : ObfuscateBuffer(job->source, job->sourceLength, &job->options, &result);
+    switch (status) {
+        case OBF_OK:
+            writeScript(server, job->id, result.seed, result.output, result.outputLength);
+            break;
+        case OBF_TIMEOUT:
+            writeMessage(server, job->id, SERVE_STATUS_TIMEOUT, result.errorMsg);
+            break;
+        case OBF_CANCELLED:
+            writeMessage(server, job->id, SERVE_STATUS_CANCELLED, result.errorMsg);
+            break;
+        default:
+            writeMessage(server, job->id, SERVE_STATUS_ERROR, result.errorMsg);
+            break;
+    }
+    FreeObfResult(&result);
+}
+
+static void* workerMain(void* arg) {
+    Server* server = (Server*)arg;
+
+    for (;;) {
+        // Requests come first; idle time goes to topping up the pool
+        if (sem_trywait(&server->available) != 0) {
+            if (!__atomic_load_n(&server->stopping, __ATOMIC_ACQUIRE) &&
+                RefillVariantPool(server->pool)) {
+                continue;
+            }
+            while (sem_wait(&server->available) != 0) {}
+        }
+
+        ServerJob* job = queuePop(&server->queue);
+        if (!job) {
+            if (__atomic_load_n(&server->stopping, __ATOMIC_ACQUIRE)) break;
+            continue;  // Woken to refill
+        }
+        __atomic_sub_fetch(&server->queued, 1, __ATOMIC_RELAXED);
+
+        int pooled = job->key != NULL;
+        runJob(server, job);
+        untrackJob(server, job);
+        freeJob(job);
+
+        // Whatever was popped gets rebuilt by every worker that is idle
+        if (pooled) {
+            int wake = VariantPoolDeficit(server->pool);
+            if (wake > server->workers - 1) wake = server->workers - 1;
+            for (int i = 0; i < wake; i++) {
+                sem_post(&server->available);
+            }
+        }
+    }
+    return NULL;
+}
+
+// ============================================
+// READER
+// ============================================
+
+// Decode an obfuscate request and queue it (frame ownership moves to the job)
+static void submitJob(Server* server, unsigned char* frame, unsigned int length) {
+    unsigned int id = getU32(frame + 1);
+    unsigned int pos = 5;
+    unsigned int keyLen = 0;
+    if (frame[0] == SERVE_KIND_POOLED) {
+        keyLen = length >= 9 ? getU32(frame + 5) : 0;
+        pos = 9;
+        if (length < 9 || keyLen == 0 || keyLen > length - pos) {
+            writeMessage(server, id, SERVE_STATUS_ERROR, "Malformed request: key length");
+            free(frame);
+            return;
+        }
+        pos += keyLen;
+    }
+    if (length - pos < 24) {
+        writeMessage(server, id, SERVE_STATUS_ERROR, "Malformed request");
+        free(frame);
+        return;
+    }
+
+    ServerJob* job = (ServerJob*)calloc(1, sizeof(ServerJob));
+    if (!job) {
+        writeMessage(server, id, SERVE_STATUS_ERROR, "Out of memory");
+        free(frame);
+        return;
+    }
+    job->id = id;
+    job->frame = frame;
+    if (keyLen) {
+        job->key = (const char*)frame + 9;
+        job->keyLength = keyLen;
+    }
+    job->options.seed = (unsigned long long)getU32(frame + pos) |
+                        ((unsigned long long)getU32(frame + pos + 4) << 32);
+    job->options.options = getU32(frame + pos + 8);
+    job->options.cancel = &job->cancel;
+
+    unsigned int timeoutMs = getU32(frame + pos + 12);
+    if (timeoutMs) job->deadline = MonotonicMs() + timeoutMs;
+
+    pos += 16;
+    unsigned int watermarkLen = getU32(frame + pos);
+    pos += 4;
+    if (watermarkLen > length - pos - 4) {
+        writeMessage(server, id, SERVE_STATUS_ERROR, "Malformed request: watermark length");
+        freeJob(job);
+        return;
+    }
+    job->options.watermark = (const char*)frame + pos;
+    job->options.watermarkLength = watermarkLen;
+    pos += watermarkLen;
+
+    unsigned int sourceLen = getU32(frame + pos);
+    pos += 4;
+    if (sourceLen > length - pos) {
+        writeMessage(server, id, SERVE_STATUS_ERROR, "Malformed request: source length");
+        freeJob(job);
+        return;
+    }
+    job->source = (const char*)frame + pos;
+    job->sourceLength = sourceLen;
+
+    // Backpressure: answer now rather than let the backlog grow
+    if (__atomic_add_fetch(&server->queued, 1, __ATOMIC_RELAXED) > server->queueDepth ||
+        !trackJob(server, job)) {
+        __atomic_sub_fetch(&server->queued, 1, __ATOMIC_RELAXED);
+        writeMessage(server, id, SERVE_STATUS_BUSY, "Server busy");
+        freeJob(job);
+        return;
+    }
+    if (!queuePush(&server->queue, job)) {
+        __atomic_sub_fetch(&server->queued, 1, __ATOMIC_RELAXED);
+        untrackJob(server, job);
+        writeMessage(server, id, SERVE_STATUS_BUSY, "Server busy");
+        freeJob(job);
+        return;
+    }
+    sem_post(&server->available);
+}
+
+int RunServer(const ServerConfig* config) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    SetLogStream(stderr);
+
+    int workers = config && config->workers > 0 ? config->workers : OnlineCores();
+    if (workers > SERVE_MAX_WORKERS) workers = SERVE_MAX_WORKERS;
+    int queueDepth = config && config->queueDepth > 0 ? config->queueDepth : workers * 4;
+
+    Server server;
+    memset(&server, 0, sizeof(server));
+    server.queueDepth = queueDepth;
+    server.workers = workers;
+    if (config && config->poolSize > 0) {
+        server.pool = CreateVariantPool(config->poolSize, config->poolScripts);
+    }
+    server.activeCapacity = queueDepth + workers;
+    server.active = (ServerJob**)calloc(server.activeCapacity, sizeof(ServerJob*));
+    if (!server.active || !initQueue(&server.queue, queueDepth)) {
+        LogError("Out of memory starting server");
+        return 1;
+    }
+    sem_init(&server.available, 0, 0);
+    pthread_mutex_init(&server.outputLock, NULL);
+    pthread_mutex_init(&server.activeLock, NULL);
+
+    pthread_t threads[SERVE_MAX_WORKERS];
+    for (int i = 0; i < workers; i++) {
+        pthread_create(&threads[i], NULL, workerMain, &server);
+    }
+    LogInfo("Serving framed requests on stdin (%d workers, queue depth %d, pool %d per script)",
+            workers, queueDepth, server.pool ? config->poolSize : 0);
+
+    int exitCode = 0;
+    unsigned char lengthBuf[4];
+    while (readExact(stdin, lengthBuf, 4)) {
+        unsigned int length = getU32(lengthBuf);
+        if (length > SERVE_MAX_FRAME) {
+            LogError("Frame of %u bytes exceeds limit, closing", length);
+            exitCode = 1;
+            break;
+        }
+
+        unsigned char* frame = (unsigned char*)malloc(length > 0 ? length : 1);
+        if (!readExact(stdin, frame, length)) {
+            free(frame);
+            LogError("Truncated frame, closing");
+            exitCode = 1;
+            break;
+        }
+
+        if (length < 5) {
+            writeMessage(&server, 0, SERVE_STATUS_ERROR, "Malformed request");
+            free(frame);
+        } else if (frame[0] == SERVE_KIND_CANCEL) {
+            cancelJob(&server, getU32(frame + 1));
+            free(frame);
+        } else if (frame[0] == SERVE_KIND_OBFUSCATE || frame[0] == SERVE_KIND_POOLED) {
+            submitJob(&server, frame, length);
+        } else {
+            writeMessage(&server, getU32(frame + 1), SERVE_STATUS_ERROR, "Unknown request kind");
+            free(frame);
+        }
+    }
+
+    // Let the workers drain what was accepted, then wake each one to exit
+    __atomic_store_n(&server.stopping, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < workers; i++) {
+        sem_post(&server.available);
+    }
+    for (int i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    sem_destroy(&server.available);
+    pthread_mutex_destroy(&server.outputLock);
+    pthread_mutex_destroy(&server.activeLock);
+    free(server.queue.cells);
+    free(server.active);
+    FreeVariantPool(server.pool);
+
+    LogInfo("stdin closed, shutting down");
+    return exitCode;
+}
@@ -1,8 +1,9 @@
 #include "../../include/AntiTamper.h"
 #include "../../include/Utils.h"
 
-AntiTamperContext* CreateAntiTamperContext() {
+AntiTamperContext* CreateAntiTamperContext(ObfContext* obf) {
     AntiTamperContext* ctx = (AntiTamperContext*)malloc(sizeof(AntiTamperContext));
+    ctx->obf = obf;
     ctx->checkpointCount = 0;
     ctx->validatorCount = 0;
     ctx->masterChecksum = 0;
@@ -18,8 +19,8 @@ void AddCheckpoint(AntiTamperContext* ctx, CheckpointType type, int start, int e
     cp->type = type;
     cp->targetStart = start;
     cp->targetEnd = end;
-    cp->failMode = RandomInt(0, 2);
-    cp->expectedValue = RandomInt(0x1000, 0xFFFFFF);
+    cp->failMode = RandomInt(ctx->obf, 0, 2);
+    cp->expectedValue = RandomInt(ctx->obf, 0x1000, 0xFFFFFF);
     ctx->checkpointCount++;
 }
 
@@ -29,8 +30,8 @@ void AddCrossValidator(AntiTamperContext* ctx, int funcA, int funcB) {
     CrossValidator* cv = &ctx->validators[ctx->validatorCount];
     cv->funcA = funcA;
     cv->funcB = funcB;
-    cv->sharedSecret = RandomInt(0x10000, 0xFFFFFF);
-    cv->validationPoint = RandomInt(1, 10);
+    cv->sharedSecret = RandomInt(ctx->obf, 0x10000, 0xFFFFFF);
+    cv->validationPoint = RandomInt(ctx->obf, 1, 10);
     ctx->validatorCount++;
 }
 
@@ -88,7 +89,7 @@ char* GenerateChecksumCode(AntiTamperContext* ctx, int variant) {
                 "end;"
                 "return h;"
                 "end;",
-                RandomInt(0x1000, 0xFFFF), RandomInt(31, 127));
+                RandomInt(ctx->obf, 0x1000, 0xFFFF), RandomInt(ctx->obf, 31, 127));
             break;
     }
     
@@ -105,8 +106,8 @@ char* GenerateSilentFailCode(AntiTamperContext* ctx) {
         "if _vF%%7==0 then return function()end end;"
         "return nil;"
         "end;",
-        RandomInt(0x1000, 0xFFFF),
-        RandomInt(0x100, 0xFFF));
+        RandomInt(ctx->obf, 0x1000, 0xFFFF),
+        RandomInt(ctx->obf, 0x100, 0xFFF));
     
     return code;
 }
@@ -119,7 +120,7 @@ char* GenerateValidatorCode(AntiTamperContext* ctx) {
     snprintf(buf, 512,
         "local _vs={};"
         "local _vk=%u;",
-        RandomInt(0x10000, 0xFFFFFF));
+        RandomInt(ctx->obf, 0x10000, 0xFFFFFF));
     strcat(code, buf);
     
     for (int i = 0; i < ctx->validatorCount && i < 5; i++) {
@@ -148,15 +149,15 @@ void FreeAntiTamperContext(AntiTamperContext* ctx) {
 }
 
 // Generate robust anti-tamper with multiple checks
-char* GenerateRobustAntiTamper(int seed) {
+char* GenerateRobustAntiTamper(int seed, ObfContext* obf) {
     char* code = (char*)malloc(4096);
-    char* v1 = GenerateRandomString(2);
-    char* v2 = GenerateRandomString(2);
-    char* v3 = GenerateRandomString(2);
-    char* chk = GenerateRandomString(3);
+    char* v1 = GenerateRandomString(obf, 2);
+    char* v2 = GenerateRandomString(obf, 2);
+    char* v3 = GenerateRandomString(obf, 2);
+    char* chk = GenerateRandomString(obf, 3);
     
-    int key1 = RandomInt(1000, 9999);
-    int key2 = RandomInt(100, 999);
+    int key1 = RandomInt(obf, 1000, 9999);
+    int key2 = RandomInt(obf, 100, 999);
     int expected = (seed * key2 + key1) & 0xFFFF;
     
     snprintf(code, 4096,
@@ -189,10 +190,10 @@ char* GenerateRobustAntiTamper(int seed) {
 }
 
 // Generate timing-based anti-debug
-char* GenerateTimingCheck() {
+char* GenerateTimingCheck(ObfContext* obf) {
     char* code = (char*)malloc(2048);
-    char* t1 = GenerateRandomString(2);
-    char* t2 = GenerateRandomString(2);
+    char* t1 = GenerateRandomString(obf, 2);
+    char* t2 = GenerateRandomString(obf, 2);
     
     snprintf(code, 2048,
         // Timing check - debuggers slow down execution
@@ -0,0 +1,87 @@
+#include "../../include/Arena.h"
+
+#define ARENA_ALIGN 16
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t size;            // Usable bytes after the header
+    size_t used;
+};
+
+#define BLOCK_HEADER ALIGN_UP(sizeof(ArenaBlock))
+
+static ArenaBlock* newBlock(size_t size) {
+    // calloc so every allocation starts zeroed without a memset
+    ArenaBlock* block = (ArenaBlock*)calloc(1, BLOCK_HEADER + size);
+    if (!block) return NULL;
+    block->size = size;
+    return block;
+}
+
+Arena* CreateArena(size_t blockSize) {
+    Arena* arena = (Arena*)malloc(sizeof(Arena));
+    if (!arena) return NULL;
+    arena->head = NULL;
+    arena->blockSize = blockSize ? ALIGN_UP(blockSize) : ARENA_DEFAULT_BLOCK;
+    return arena;
+}
+
+void FreeArena(Arena* arena) {
+    if (!arena) return;
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void* ArenaAlloc(Arena* arena, size_t size) {
+    size = ALIGN_UP(size ? size : 1);
+    ArenaBlock* head = arena->head;
+
+    if (!head || head->size - head->used < size) {
+        if (size > arena->blockSize / 4) {
+            // Large requests get their own block, kept behind the current
+            // one so its free space is not abandoned
+            ArenaBlock* block = newBlock(size);
+            if (!block) return NULL;
+            block->used = size;
+            if (head) {
+                block->next = head->next;
+                head->next = block;
+            } else {
+                arena->head = block;
+            }
+            return (char*)block + BLOCK_HEADER;
+        }
+
+        head = newBlock(arena->blockSize);
+        if (!head) return NULL;
+        head->next = arena->head;
+        arena->head = head;
+    }
+
+    void* ptr = (char*)head + BLOCK_HEADER + head->used;
+    head->used += size;
+    return ptr;
+}
+
+void* ArenaGrow(Arena* arena, void* old, size_t oldSize, size_t newSize) {
+    ArenaBlock* head = arena->head;
+
+    // The latest allocation in the current block can grow in place
+    if (old && head && (char*)old + ALIGN_UP(oldSize) == (char*)head + BLOCK_HEADER + head->used) {
+        size_t extra = ALIGN_UP(newSize) - ALIGN_UP(oldSize);
+        if (head->size - head->used >= extra) {
+            head->used += extra;
+            return old;
+        }
+    }
+
+    void* ptr = ArenaAlloc(arena, newSize);
+    if (ptr && old) memcpy(ptr, old, oldSize);
+    return ptr;
+}
@@ -0,0 +1,139 @@
+#include "../../include/Context.h"
+
+#include <unistd.h>
+
+// ============================================
+// PER-JOB CONTEXT AND PRNG (xoshiro256**)
+// ============================================
+
+static unsigned long long splitMix64(unsigned long long* x) {
+    unsigned long long z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static unsigned long long rotl64(unsigned long long x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// Fresh seed for unseeded jobs: OS entropy when available, mixed with the
+// clock and a process-wide counter so concurrent jobs never collide
+static unsigned long long entropySeed(void* salt) {
+    static unsigned long long jobCounter = 0;
+    unsigned long long seed = 0;
+
+#ifndef _WIN32
+    FILE* f = fopen("/dev/urandom", "rb");
+    if (f) {
+        if (fread(&seed, 1, sizeof(seed), f) != sizeof(seed)) seed = 0;
+        fclose(f);
+    }
+#endif
+
+    unsigned long long mix = (unsigned long long)time(NULL) ^
+                             ((unsigned long long)clock() << 20) ^
+                             (unsigned long long)(size_t)salt ^
+                             (__sync_add_and_fetch(&jobCounter, 1) << 40);
+    seed ^= splitMix64(&mix);
+    return seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+ObfContext* CreateObfContext(unsigned long long seed) {
+    ObfContext* ctx = (ObfContext*)calloc(1, sizeof(ObfContext));
+    if (!ctx) return NULL;
+
+    ctx->seed = seed ? seed : entropySeed(ctx);
+    unsigned long long x = ctx->seed;
+    for (int i = 0; i < 4; i++) {
+        ctx->rng[i] = splitMix64(&x);
+    }
+    return ctx;
+}
+
+void FreeObfContext(ObfContext* ctx) {
+    free(ctx);
+}
+
+long long MonotonicMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int OnlineCores() {
+#ifdef _SC_NPROCESSORS_ONLN
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores > 0) return (int)cores;
+#endif
+    return 4;
+}
+
+int ContextState(ObfContext* ctx) {
+    if (ctx->cancel && *ctx->cancel) return CONTEXT_CANCELLED;
+    if (ctx->deadline && MonotonicMs() >= ctx->deadline) return CONTEXT_EXPIRED;
+    return CONTEXT_RUNNING;
+}
+
+static unsigned long long nextRandom(ObfContext* ctx) {
+    unsigned long long* s = ctx->rng;
+    unsigned long long result = rotl64(s[1] * 5, 7) * 9;
+    unsigned long long t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+unsigned int RandomU32(ObfContext* ctx) {
+    return (unsigned int)(nextRandom(ctx) >> 32);
+}
+
+int RandomInt(ObfContext* ctx, int min, int max) {
+    unsigned long long range = (unsigned long long)((long long)max - min) + 1;
+    // Multiply-shift maps the top 32 bits onto the range without a division
+    return (int)(min + (long long)(((nextRandom(ctx) >> 32) * range) >> 32));
+}
+
+// Short names land on Lua keywords, the os library or the VM entry point
+// often enough to break the generated script
+static int isReservedName(const char* str) {
+    static const char* reserved[] = {
+        "do", "if", "in", "or", "and", "end", "for", "nil", "not", "else",
+        "then", "true", "break", "false", "local", "until", "while", "elseif",
+        "repeat", "return", "function", "goto", "continue", "os", "BW"
+    };
+    for (int i = 0; i < (int)(sizeof(reserved) / sizeof(reserved[0])); i++) {
+        if (strcmp(str, reserved[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+char* GenerateRandomString(ObfContext* ctx, int length) {
+    char* str = (char*)malloc(length + 1);
+    const char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    if (str) {
+        do {
+            for (int i = 0; i < length; i++) {
+                str[i] = charset[RandomInt(ctx, 0, (int)sizeof(charset) - 2)];
+            }
+            str[length] = '\0';
+        } while (isReservedName(str));
+    }
+    return str;
+}
+
+char* GenerateRandomHex(ObfContext* ctx, int length) {
+    char* str = (char*)malloc(length + 1);
+    const char charset[] = "0123456789ABCDEF";
+    if (str) {
+        for (int i = 0; i < length; i++) {
+            str[i] = charset[RandomInt(ctx, 0, (int)sizeof(charset) - 2)];
+        }
+        str[length] = '\0';
+    }
+    return str;
+}
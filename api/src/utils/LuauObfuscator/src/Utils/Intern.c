@@ -0,0 +1,94 @@
+#include "../../include/Intern.h"
+
+typedef struct {
+    const char* str;            // NULL = empty slot
+    int length;
+    unsigned int hash;
+} InternEntry;
+
+struct StringTable {
+    Arena* arena;
+    InternEntry* entries;
+    int capacity;               // Power of two
+    int count;
+};
+
+static unsigned int hashString(const char* str, int length) {
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+StringTable* CreateStringTable(Arena* arena) {
+    StringTable* table = (StringTable*)malloc(sizeof(StringTable));
+    if (!table) return NULL;
+    table->arena = arena;
+    table->capacity = 256;
+    table->count = 0;
+    table->entries = (InternEntry*)calloc(table->capacity, sizeof(InternEntry));
+    if (!table->entries) {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+void FreeStringTable(StringTable* table) {
+    if (!table) return;
+    free(table->entries);
+    free(table);
+}
+
+// Linear probing; the table is kept at most half full
+static InternEntry* findSlot(InternEntry* entries, int capacity, const char* str, int length,
+                             unsigned int hash) {
+    int mask = capacity - 1;
+    for (int i = hash & mask; ; i = (i + 1) & mask) {
+        InternEntry* entry = &entries[i];
+        if (!entry->str) return entry;
+        if (entry->hash == hash && entry->length == length &&
+            memcmp(entry->str, str, length) == 0) {
+            return entry;
+        }
+    }
+}
+
+static int grow(StringTable* table) {
+    int capacity = table->capacity * 2;
+    InternEntry* entries = (InternEntry*)calloc(capacity, sizeof(InternEntry));
+    if (!entries) return 0;
+
+    for (int i = 0; i < table->capacity; i++) {
+        InternEntry* old = &table->entries[i];
+        if (old->str) *findSlot(entries, capacity, old->str, old->length, old->hash) = *old;
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    return 1;
+}
+
+const char* InternString(StringTable* table, const char* str, int length) {
+    unsigned int hash = hashString(str, length);
+    InternEntry* entry = findSlot(table->entries, table->capacity, str, length, hash);
+    if (entry->str) return entry->str;
+
+    if ((table->count + 1) * 2 > table->capacity) {
+        if (!grow(table)) return NULL;
+        entry = findSlot(table->entries, table->capacity, str, length, hash);
+    }
+
+    char* copy = (char*)ArenaAlloc(table->arena, length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+
+    entry->str = copy;
+    entry->length = length;
+    entry->hash = hash;
+    table->count++;
+    return copy;
+}
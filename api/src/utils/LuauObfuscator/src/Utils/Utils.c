@@ -1,49 +1,24 @@
 #include "../../include/Utils.h"
 
-void SeedRandom() {
-    srand((unsigned int)time(NULL));
-}
-
-int RandomInt(int min, int max) {
-    return min + rand() % (max - min + 1);
-}
+static FILE* logStream = NULL;
 
-char* GenerateRandomString(int length) {
-    char* str = (char*)malloc(length + 1);
-    const char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
-    if (str) {
-        for (int i = 0; i < length; i++) {
-            int key = rand() % (int)(sizeof(charset) - 1);
-            str[i] = charset[key];
-        }
-        str[length] = '\0';
-    }
-    return str;
-}
-
-char* GenerateRandomHex(int length) {
-    char* str = (char*)malloc(length + 1);
-    const char charset[] = "0123456789ABCDEF";
-    if (str) {
-        for (int i = 0; i < length; i++) {
-            int key = rand() % (int)(sizeof(charset) - 1);
-            str[i] = charset[key];
-        }
-        str[length] = '\0';
-    }
-    return str;
+void SetLogStream(FILE* stream) {
+    logStream = stream;
 }
 
 void LogInfo(const char* format, ...) {
+    FILE* out = logStream ? logStream : stdout;
     va_list args;
     va_start(args, format);
-    printf("[INFO] ");
-    vprintf(format, args);
-    printf("\n");
+    fprintf(out, "[INFO] ");
+    vfprintf(out, format, args);
+    fprintf(out, "\n");
     va_end(args);
 }
 
 void LogError(const char* format, ...) {
+    // Keep errors in order with buffered [INFO] lines written before them
+    fflush(logStream ? logStream : stdout);
     va_list args;
     va_start(args, format);
     fprintf(stderr, "[ERROR] ");
@@ -57,7 +32,7 @@ char* EncodeBase85Custom(const unsigned char* data, int len) {
     // Custom Base85 alphabet with special chars
     const char* alphabet = "!\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstu";
     
-    int outLen = ((len + 3) / 4) * 5 + 100; // Estimate with padding
+    int outLen = ((len + 3) / 4) * 5 + (len / 60) * 3 + 16; // Groups, "z!!" markers, prefix
     char* output = (char*)malloc(outLen);
     int outPos = 0;
     
@@ -104,44 +79,51 @@ char* EncodeBase85Custom(const unsigned char* data, int len) {
     return output;
 }
 
+// Inverse of EncodeBase85Custom: skips the prefix and "z!!" markers the way
+// the generated d85() does. Returns malloc'd bytes (length in *outLen).
+unsigned char* DecodeBase85Custom(const char* text, int len, int* outLen) {
+    unsigned char* output = (unsigned char*)malloc((len / 5) * 4 + 4);
+    if (!output) return NULL;
+
+    int outPos = 0;
+    int i = 0;
+    while (i < len) {
+        if (i + 10 <= len && memcmp(text + i, "LPH+m0<X;z", 10) == 0) {
+            i += 10;
+        } else if (i + 3 <= len && memcmp(text + i, "z!!", 3) == 0) {
+            i += 3;
+        } else {
+            if (i + 5 > len) break;
+            unsigned long value = 0;
+            for (int j = 0; j < 5; j++) {
+                value = value * 85 + (unsigned char)(text[i + j] - 33);
+            }
+            output[outPos++] = (unsigned char)(value >> 24);
+            output[outPos++] = (unsigned char)(value >> 16);
+            output[outPos++] = (unsigned char)(value >> 8);
+            output[outPos++] = (unsigned char)value;
+            i += 5;
+        }
+    }
+
+    *outLen = outPos;
+    return output;
+}
+
 // Serialize bytecode chunk to binary format
 char* SerializeBytecode(BytecodeChunk* chunk) {
     // Calculate size needed
     int size = 1; // version byte
-    size += 1; // constant count
-    for (int i = 0; i < chunk->ConstantCount; i++) {
-        size += 2; // string length (2 bytes)
-        size += strlen(chunk->Constants[i]); // string data
-    }
-    size += chunk->Count * 6; // instructions (6 bytes each: op, A, B(2), C(2))
+    size += PrototypeSize(chunk); // prototype tree
     
     unsigned char* buffer = (unsigned char*)malloc(size);
     int pos = 0;
     
     // Version
-    buffer[pos++] = 0x01;
+    buffer[pos++] = BYTECODE_VERSION;
     
-    // Constants - use 2 bytes for length to support long strings (functions)
-    buffer[pos++] = (unsigned char)chunk->ConstantCount;
-    for (int i = 0; i < chunk->ConstantCount; i++) {
-        int len = strlen(chunk->Constants[i]);
-        buffer[pos++] = (unsigned char)(len & 0xFF);
-        buffer[pos++] = (unsigned char)((len >> 8) & 0xFF);
-        memcpy(buffer + pos, chunk->Constants[i], len);
-        pos += len;
-    }
-    
-    // Instructions - use 2 bytes for B and C to support constant flags
-    for (int i = 0; i < chunk->Count; i++) {
-        buffer[pos++] = (unsigned char)chunk->Instructions[i].Op;
-        buffer[pos++] = (unsigned char)chunk->Instructions[i].A;
-        // B as 2 bytes (little endian)
-        buffer[pos++] = (unsigned char)(chunk->Instructions[i].B & 0xFF);
-        buffer[pos++] = (unsigned char)((chunk->Instructions[i].B >> 8) & 0xFF);
-        // C as 2 bytes (little endian)
-        buffer[pos++] = (unsigned char)(chunk->Instructions[i].C & 0xFF);
-        buffer[pos++] = (unsigned char)((chunk->Instructions[i].C >> 8) & 0xFF);
-    }
+    // Prototypes - opcodes unshuffled (see WritePrototype)
+    pos += WritePrototype(buffer + pos, chunk, NULL, NULL);
     
     // Encode to Base85
     char* encoded = EncodeBase85Custom(buffer, pos);
@@ -2,17 +2,18 @@
 #include "../../include/Utils.h"
 
 // Create new opcode table with randomized mappings
-OpcodeTable* CreateOpcodeTable() {
+OpcodeTable* CreateOpcodeTable(ObfContext* obf) {
     OpcodeTable* table = (OpcodeTable*)malloc(sizeof(OpcodeTable));
-    table->shuffleKey = RandomInt(1, 0xFFFFFF);
-    table->xorKey = RandomInt(1, 255);
-    table->buildId = RandomInt(10000, 99999);
+    table->obf = obf;
+    table->shuffleKey = RandomInt(obf, 1, 0xFFFFFF);
+    table->xorKey = RandomInt(obf, 1, 255);
+    table->buildId = RandomInt(obf, 10000, 99999);
     
     // Initialize mappings
     for (int i = 0; i < VM_OPCODE_COUNT; i++) {
         table->mappings[i].realOp = i;
         table->mappings[i].shuffledOp = i;  // Will be shuffled
-        table->mappings[i].fakeCount = RandomInt(0, 3);
+        table->mappings[i].fakeCount = RandomInt(obf, 0, 3);
         table->mappings[i].flags = 0;
     }
     
@@ -26,7 +27,7 @@ void ShuffleOpcodes(OpcodeTable* table) {
     for (int i = 0; i < VM_OPCODE_COUNT; i++) {
         int newOp;
         do {
-            newOp = RandomInt(1, 250);  // Avoid 0 and high values
+            newOp = RandomInt(table->obf, 1, 250);  // Avoid 0 and high values
         } while (used[newOp]);
         
         used[newOp] = 1;
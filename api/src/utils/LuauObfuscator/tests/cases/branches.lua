@@ -0,0 +1,47 @@
+-- elseif chains, comparisons used as values, and/or
+
+local function grade(score)
+    if score >= 90 then return "A"
+    elseif score >= 80 then return "B"
+    elseif score >= 70 then return "C"
+    elseif score >= 60 then return "D"
+    else return "F" end
+end
+print(grade(95), grade(85), grade(75), grade(65), grade(10))
+
+local function classify(v)
+    local kind
+    if v == nil then kind = "nil"
+    elseif v == true then kind = "true"
+    elseif v ~= v then kind = "nan"
+    elseif type(v) == "number" and v < 0 then kind = "negative"
+    elseif type(v) == "number" then kind = "number"
+    else kind = "other" end
+    return kind
+end
+print(classify(nil), classify(true), classify(0 / 0), classify(-1), classify(3), classify("s"))
+
+-- comparisons stored, returned and passed on
+local a, b = 3, 7
+local lt, le, gt, ge, eq, ne = a < b, a <= b, a > b, a >= b, a == b, a ~= b
+print(lt, le, gt, ge, eq, ne)
+local function less(x, y) return x < y end
+print(less(1, 2), less(2, 1), not (a < b), (a < b) == (b > a))
+local flags = {a < b, a > b, "x" == "x"}
+print(flags[1], flags[2], flags[3])
+
+print(a < b and "yes" or "no", a > b and "yes" or "no", nil or false, false and nil)
+print((a > b) or (a + b))
+
+-- conditions that are not comparisons
+local items = {1, false, "x"}
+for i = 1, 4 do
+    if items[i] then print(i, "truthy") else print(i, "falsy") end
+end
+
+local i, total = 0, 0
+while i < 10 and total < 20 do
+    i = i + 1
+    total = total + i
+end
+print(i, total)
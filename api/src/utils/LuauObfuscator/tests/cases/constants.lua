@@ -0,0 +1,626 @@
+-- RK operands: constants read in place, and constants past the 256 an
+-- operand can address, which have to be loaded into a register first
+
+local x = 10
+print(x + 1, 1 + x, x - 0.5, 2 * x, x / 4, x % 3, 2 ^ x, "v" .. x, x .. "v")
+print(x < 11, 11 < x, x <= 10, 10 >= x, x == 10, "10" == x, x ~= "x")
+local t = {}
+t.key = "value"
+t[1] = 2
+t["other"] = x
+print(t.key, t[1], t.other, t.missing)
+
+-- 300 number and 300 string constants
+local sum = 0
+sum = sum + 1001
+sum = sum + 1002
+sum = sum + 1003
+sum = sum + 1004
+sum = sum + 1005
+sum = sum + 1006
+sum = sum + 1007
+sum = sum + 1008
+sum = sum + 1009
+sum = sum + 1010
+sum = sum + 1011
+sum = sum + 1012
+sum = sum + 1013
+sum = sum + 1014
+sum = sum + 1015
+sum = sum + 1016
+sum = sum + 1017
+sum = sum + 1018
+sum = sum + 1019
+sum = sum + 1020
+sum = sum + 1021
+sum = sum + 1022
+sum = sum + 1023
+sum = sum + 1024
+sum = sum + 1025
+sum = sum + 1026
+sum = sum + 1027
+sum = sum + 1028
+sum = sum + 1029
+sum = sum + 1030
+sum = sum + 1031
+sum = sum + 1032
+sum = sum + 1033
+sum = sum + 1034
+sum = sum + 1035
+sum = sum + 1036
+sum = sum + 1037
+sum = sum + 1038
+sum = sum + 1039
+sum = sum + 1040
+sum = sum + 1041
+sum = sum + 1042
+sum = sum + 1043
+sum = sum + 1044
+sum = sum + 1045
+sum = sum + 1046
+sum = sum + 1047
+sum = sum + 1048
+sum = sum + 1049
+sum = sum + 1050
+sum = sum + 1051
+sum = sum + 1052
+sum = sum + 1053
+sum = sum + 1054
+sum = sum + 1055
+sum = sum + 1056
+sum = sum + 1057
+sum = sum + 1058
+sum = sum + 1059
+sum = sum + 1060
+sum = sum + 1061
+sum = sum + 1062
+sum = sum + 1063
+sum = sum + 1064
+sum = sum + 1065
+sum = sum + 1066
+sum = sum + 1067
+sum = sum + 1068
+sum = sum + 1069
+sum = sum + 1070
+sum = sum + 1071
+sum = sum + 1072
+sum = sum + 1073
+sum = sum + 1074
+sum = sum + 1075
+sum = sum + 1076
+sum = sum + 1077
+sum = sum + 1078
+sum = sum + 1079
+sum = sum + 1080
+sum = sum + 1081
+sum = sum + 1082
+sum = sum + 1083
+sum = sum + 1084
+sum = sum + 1085
+sum = sum + 1086
+sum = sum + 1087
+sum = sum + 1088
+sum = sum + 1089
+sum = sum + 1090
+sum = sum + 1091
+sum = sum + 1092
+sum = sum + 1093
+sum = sum + 1094
+sum = sum + 1095
+sum = sum + 1096
+sum = sum + 1097
+sum = sum + 1098
+sum = sum + 1099
+sum = sum + 1100
+sum = sum + 1101
+sum = sum + 1102
+sum = sum + 1103
+sum = sum + 1104
+sum = sum + 1105
+sum = sum + 1106
+sum = sum + 1107
+sum = sum + 1108
+sum = sum + 1109
+sum = sum + 1110
+sum = sum + 1111
+sum = sum + 1112
+sum = sum + 1113
+sum = sum + 1114
+sum = sum + 1115
+sum = sum + 1116
+sum = sum + 1117
+sum = sum + 1118
+sum = sum + 1119
+sum = sum + 1120
+sum = sum + 1121
+sum = sum + 1122
+sum = sum + 1123
+sum = sum + 1124
+sum = sum + 1125
+sum = sum + 1126
+sum = sum + 1127
+sum = sum + 1128
+sum = sum + 1129
+sum = sum + 1130
+sum = sum + 1131
+sum = sum + 1132
+sum = sum + 1133
+sum = sum + 1134
+sum = sum + 1135
+sum = sum + 1136
+sum = sum + 1137
+sum = sum + 1138
+sum = sum + 1139
+sum = sum + 1140
+sum = sum + 1141
+sum = sum + 1142
+sum = sum + 1143
+sum = sum + 1144
+sum = sum + 1145
+sum = sum + 1146
+sum = sum + 1147
+sum = sum + 1148
+sum = sum + 1149
+sum = sum + 1150
+sum = sum + 1151
+sum = sum + 1152
+sum = sum + 1153
+sum = sum + 1154
+sum = sum + 1155
+sum = sum + 1156
+sum = sum + 1157
+sum = sum + 1158
+sum = sum + 1159
+sum = sum + 1160
+sum = sum + 1161
+sum = sum + 1162
+sum = sum + 1163
+sum = sum + 1164
+sum = sum + 1165
+sum = sum + 1166
+sum = sum + 1167
+sum = sum + 1168
+sum = sum + 1169
+sum = sum + 1170
+sum = sum + 1171
+sum = sum + 1172
+sum = sum + 1173
+sum = sum + 1174
+sum = sum + 1175
+sum = sum + 1176
+sum = sum + 1177
+sum = sum + 1178
+sum = sum + 1179
+sum = sum + 1180
+sum = sum + 1181
+sum = sum + 1182
+sum = sum + 1183
+sum = sum + 1184
+sum = sum + 1185
+sum = sum + 1186
+sum = sum + 1187
+sum = sum + 1188
+sum = sum + 1189
+sum = sum + 1190
+sum = sum + 1191
+sum = sum + 1192
+sum = sum + 1193
+sum = sum + 1194
+sum = sum + 1195
+sum = sum + 1196
+sum = sum + 1197
+sum = sum + 1198
+sum = sum + 1199
+sum = sum + 1200
+sum = sum + 1201
+sum = sum + 1202
+sum = sum + 1203
+sum = sum + 1204
+sum = sum + 1205
+sum = sum + 1206
+sum = sum + 1207
+sum = sum + 1208
+sum = sum + 1209
+sum = sum + 1210
+sum = sum + 1211
+sum = sum + 1212
+sum = sum + 1213
+sum = sum + 1214
+sum = sum + 1215
+sum = sum + 1216
+sum = sum + 1217
+sum = sum + 1218
+sum = sum + 1219
+sum = sum + 1220
+sum = sum + 1221
+sum = sum + 1222
+sum = sum + 1223
+sum = sum + 1224
+sum = sum + 1225
+sum = sum + 1226
+sum = sum + 1227
+sum = sum + 1228
+sum = sum + 1229
+sum = sum + 1230
+sum = sum + 1231
+sum = sum + 1232
+sum = sum + 1233
+sum = sum + 1234
+sum = sum + 1235
+sum = sum + 1236
+sum = sum + 1237
+sum = sum + 1238
+sum = sum + 1239
+sum = sum + 1240
+sum = sum + 1241
+sum = sum + 1242
+sum = sum + 1243
+sum = sum + 1244
+sum = sum + 1245
+sum = sum + 1246
+sum = sum + 1247
+sum = sum + 1248
+sum = sum + 1249
+sum = sum + 1250
+sum = sum + 1251
+sum = sum + 1252
+sum = sum + 1253
+sum = sum + 1254
+sum = sum + 1255
+sum = sum + 1256
+sum = sum + 1257
+sum = sum + 1258
+sum = sum + 1259
+sum = sum + 1260
+sum = sum + 1261
+sum = sum + 1262
+sum = sum + 1263
+sum = sum + 1264
+sum = sum + 1265
+sum = sum + 1266
+sum = sum + 1267
+sum = sum + 1268
+sum = sum + 1269
+sum = sum + 1270
+sum = sum + 1271
+sum = sum + 1272
+sum = sum + 1273
+sum = sum + 1274
+sum = sum + 1275
+sum = sum + 1276
+sum = sum + 1277
+sum = sum + 1278
+sum = sum + 1279
+sum = sum + 1280
+sum = sum + 1281
+sum = sum + 1282
+sum = sum + 1283
+sum = sum + 1284
+sum = sum + 1285
+sum = sum + 1286
+sum = sum + 1287
+sum = sum + 1288
+sum = sum + 1289
+sum = sum + 1290
+sum = sum + 1291
+sum = sum + 1292
+sum = sum + 1293
+sum = sum + 1294
+sum = sum + 1295
+sum = sum + 1296
+sum = sum + 1297
+sum = sum + 1298
+sum = sum + 1299
+sum = sum + 1300
+print(sum)
+local names = {}
+names[#names + 1] = "s001"
+names[#names + 1] = "s002"
+names[#names + 1] = "s003"
+names[#names + 1] = "s004"
+names[#names + 1] = "s005"
+names[#names + 1] = "s006"
+names[#names + 1] = "s007"
+names[#names + 1] = "s008"
+names[#names + 1] = "s009"
+names[#names + 1] = "s010"
+names[#names + 1] = "s011"
+names[#names + 1] = "s012"
+names[#names + 1] = "s013"
+names[#names + 1] = "s014"
+names[#names + 1] = "s015"
+names[#names + 1] = "s016"
+names[#names + 1] = "s017"
+names[#names + 1] = "s018"
+names[#names + 1] = "s019"
+names[#names + 1] = "s020"
+names[#names + 1] = "s021"
+names[#names + 1] = "s022"
+names[#names + 1] = "s023"
+names[#names + 1] = "s024"
+names[#names + 1] = "s025"
+names[#names + 1] = "s026"
+names[#names + 1] = "s027"
+names[#names + 1] = "s028"
+names[#names + 1] = "s029"
+names[#names + 1] = "s030"
+names[#names + 1] = "s031"
+names[#names + 1] = "s032"
+names[#names + 1] = "s033"
+names[#names + 1] = "s034"
+names[#names + 1] = "s035"
+names[#names + 1] = "s036"
+names[#names + 1] = "s037"
+names[#names + 1] = "s038"
+names[#names + 1] = "s039"
+names[#names + 1] = "s040"
+names[#names + 1] = "s041"
+names[#names + 1] = "s042"
+names[#names + 1] = "s043"
+names[#names + 1] = "s044"
+names[#names + 1] = "s045"
+names[#names + 1] = "s046"
+names[#names + 1] = "s047"
+names[#names + 1] = "s048"
+names[#names + 1] = "s049"
+names[#names + 1] = "s050"
+names[#names + 1] = "s051"
+names[#names + 1] = "s052"
+names[#names + 1] = "s053"
+names[#names + 1] = "s054"
+names[#names + 1] = "s055"
+names[#names + 1] = "s056"
+names[#names + 1] = "s057"
+names[#names + 1] = "s058"
+names[#names + 1] = "s059"
+names[#names + 1] = "s060"
+names[#names + 1] = "s061"
+names[#names + 1] = "s062"
+names[#names + 1] = "s063"
+names[#names + 1] = "s064"
+names[#names + 1] = "s065"
+names[#names + 1] = "s066"
+names[#names + 1] = "s067"
+names[#names + 1] = "s068"
+names[#names + 1] = "s069"
+names[#names + 1] = "s070"
+names[#names + 1] = "s071"
+names[#names + 1] = "s072"
+names[#names + 1] = "s073"
+names[#names + 1] = "s074"
+names[#names + 1] = "s075"
+names[#names + 1] = "s076"
+names[#names + 1] = "s077"
+names[#names + 1] = "s078"
+names[#names + 1] = "s079"
+names[#names + 1] = "s080"
+names[#names + 1] = "s081"
+names[#names + 1] = "s082"
+names[#names + 1] = "s083"
+names[#names + 1] = "s084"
+names[#names + 1] = "s085"
+names[#names + 1] = "s086"
+names[#names + 1] = "s087"
+names[#names + 1] = "s088"
+names[#names + 1] = "s089"
+names[#names + 1] = "s090"
+names[#names + 1] = "s091"
+names[#names + 1] = "s092"
+names[#names + 1] = "s093"
+names[#names + 1] = "s094"
+names[#names + 1] = "s095"
+names[#names + 1] = "s096"
+names[#names + 1] = "s097"
+names[#names + 1] = "s098"
+names[#names + 1] = "s099"
+names[#names + 1] = "s100"
+names[#names + 1] = "s101"
+names[#names + 1] = "s102"
+names[#names + 1] = "s103"
+names[#names + 1] = "s104"
+names[#names + 1] = "s105"
+names[#names + 1] = "s106"
+names[#names + 1] = "s107"
+names[#names + 1] = "s108"
+names[#names + 1] = "s109"
+names[#names + 1] = "s110"
+names[#names + 1] = "s111"
+names[#names + 1] = "s112"
+names[#names + 1] = "s113"
+names[#names + 1] = "s114"
+names[#names + 1] = "s115"
+names[#names + 1] = "s116"
+names[#names + 1] = "s117"
+names[#names + 1] = "s118"
+names[#names + 1] = "s119"
+names[#names + 1] = "s120"
+names[#names + 1] = "s121"
+names[#names + 1] = "s122"
+names[#names + 1] = "s123"
+names[#names + 1] = "s124"
+names[#names + 1] = "s125"
+names[#names + 1] = "s126"
+names[#names + 1] = "s127"
+names[#names + 1] = "s128"
+names[#names + 1] = "s129"
+names[#names + 1] = "s130"
+names[#names + 1] = "s131"
+names[#names + 1] = "s132"
+names[#names + 1] = "s133"
+names[#names + 1] = "s134"
+names[#names + 1] = "s135"
+names[#names + 1] = "s136"
+names[#names + 1] = "s137"
+names[#names + 1] = "s138"
+names[#names + 1] = "s139"
+names[#names + 1] = "s140"
+names[#names + 1] = "s141"
+names[#names + 1] = "s142"
+names[#names + 1] = "s143"
+names[#names + 1] = "s144"
+names[#names + 1] = "s145"
+names[#names + 1] = "s146"
+names[#names + 1] = "s147"
+names[#names + 1] = "s148"
+names[#names + 1] = "s149"
+names[#names + 1] = "s150"
+names[#names + 1] = "s151"
+names[#names + 1] = "s152"
+names[#names + 1] = "s153"
+names[#names + 1] = "s154"
+names[#names + 1] = "s155"
+names[#names + 1] = "s156"
+names[#names + 1] = "s157"
+names[#names + 1] = "s158"
+names[#names + 1] = "s159"
+names[#names + 1] = "s160"
+names[#names + 1] = "s161"
+names[#names + 1] = "s162"
+names[#names + 1] = "s163"
+names[#names + 1] = "s164"
+names[#names + 1] = "s165"
+names[#names + 1] = "s166"
+names[#names + 1] = "s167"
+names[#names + 1] = "s168"
+names[#names + 1] = "s169"
+names[#names + 1] = "s170"
+names[#names + 1] = "s171"
+names[#names + 1] = "s172"
+names[#names + 1] = "s173"
+names[#names + 1] = "s174"
+names[#names + 1] = "s175"
+names[#names + 1] = "s176"
+names[#names + 1] = "s177"
+names[#names + 1] = "s178"
+names[#names + 1] = "s179"
+names[#names + 1] = "s180"
+names[#names + 1] = "s181"
+names[#names + 1] = "s182"
+names[#names + 1] = "s183"
+names[#names + 1] = "s184"
+names[#names + 1] = "s185"
+names[#names + 1] = "s186"
+names[#names + 1] = "s187"
+names[#names + 1] = "s188"
+names[#names + 1] = "s189"
+names[#names + 1] = "s190"
+names[#names + 1] = "s191"
+names[#names + 1] = "s192"
+names[#names + 1] = "s193"
+names[#names + 1] = "s194"
+names[#names + 1] = "s195"
+names[#names + 1] = "s196"
+names[#names + 1] = "s197"
+names[#names + 1] = "s198"
+names[#names + 1] = "s199"
+names[#names + 1] = "s200"
+names[#names + 1] = "s201"
+names[#names + 1] = "s202"
+names[#names + 1] = "s203"
+names[#names + 1] = "s204"
+names[#names + 1] = "s205"
+names[#names + 1] = "s206"
+names[#names + 1] = "s207"
+names[#names + 1] = "s208"
+names[#names + 1] = "s209"
+names[#names + 1] = "s210"
+names[#names + 1] = "s211"
+names[#names + 1] = "s212"
+names[#names + 1] = "s213"
+names[#names + 1] = "s214"
+names[#names + 1] = "s215"
+names[#names + 1] = "s216"
+names[#names + 1] = "s217"
+names[#names + 1] = "s218"
+names[#names + 1] = "s219"
+names[#names + 1] = "s220"
+names[#names + 1] = "s221"
+names[#names + 1] = "s222"
+names[#names + 1] = "s223"
+names[#names + 1] = "s224"
+names[#names + 1] = "s225"
+names[#names + 1] = "s226"
+names[#names + 1] = "s227"
+names[#names + 1] = "s228"
+names[#names + 1] = "s229"
+names[#names + 1] = "s230"
+names[#names + 1] = "s231"
+names[#names + 1] = "s232"
+names[#names + 1] = "s233"
+names[#names + 1] = "s234"
+names[#names + 1] = "s235"
+names[#names + 1] = "s236"
+names[#names + 1] = "s237"
+names[#names + 1] = "s238"
+names[#names + 1] = "s239"
+names[#names + 1] = "s240"
+names[#names + 1] = "s241"
+names[#names + 1] = "s242"
+names[#names + 1] = "s243"
+names[#names + 1] = "s244"
+names[#names + 1] = "s245"
+names[#names + 1] = "s246"
+names[#names + 1] = "s247"
+names[#names + 1] = "s248"
+names[#names + 1] = "s249"
+names[#names + 1] = "s250"
+names[#names + 1] = "s251"
+names[#names + 1] = "s252"
+names[#names + 1] = "s253"
+names[#names + 1] = "s254"
+names[#names + 1] = "s255"
+names[#names + 1] = "s256"
+names[#names + 1] = "s257"
+names[#names + 1] = "s258"
+names[#names + 1] = "s259"
+names[#names + 1] = "s260"
+names[#names + 1] = "s261"
+names[#names + 1] = "s262"
+names[#names + 1] = "s263"
+names[#names + 1] = "s264"
+names[#names + 1] = "s265"
+names[#names + 1] = "s266"
+names[#names + 1] = "s267"
+names[#names + 1] = "s268"
+names[#names + 1] = "s269"
+names[#names + 1] = "s270"
+names[#names + 1] = "s271"
+names[#names + 1] = "s272"
+names[#names + 1] = "s273"
+names[#names + 1] = "s274"
+names[#names + 1] = "s275"
+names[#names + 1] = "s276"
+names[#names + 1] = "s277"
+names[#names + 1] = "s278"
+names[#names + 1] = "s279"
+names[#names + 1] = "s280"
+names[#names + 1] = "s281"
+names[#names + 1] = "s282"
+names[#names + 1] = "s283"
+names[#names + 1] = "s284"
+names[#names + 1] = "s285"
+names[#names + 1] = "s286"
+names[#names + 1] = "s287"
+names[#names + 1] = "s288"
+names[#names + 1] = "s289"
+names[#names + 1] = "s290"
+names[#names + 1] = "s291"
+names[#names + 1] = "s292"
+names[#names + 1] = "s293"
+names[#names + 1] = "s294"
+names[#names + 1] = "s295"
+names[#names + 1] = "s296"
+names[#names + 1] = "s297"
+names[#names + 1] = "s298"
+names[#names + 1] = "s299"
+names[#names + 1] = "s300"
+print(#names, names[1], names[256], names[300])
+
+-- these constants are numbered past 255
+local late = sum - 123456.5
+print(late, late * 3, 7.25 + late, late < 99999.5, 88888.5 >= late, late == 180150.5 - 123456.5)
+local keyed = {}
+keyed.farKey = "far value"
+keyed["another far key"] = 31337
+print(keyed.farKey, keyed["another far key"], "far " .. "concat " .. late)
+if late > 55555.5 then print("late branch") else print("wrong branch") end
@@ -0,0 +1,37 @@
+-- Constant folding and dead-branch elimination
+
+print(1 + 2 * 3, (1 + 2) * 3, 2 ^ 10, 7 % 3, -7 % 3, 7 / 2, 10 - 2 - 3)
+print("con" .. "cat", "n" .. 1, 1 == 1, 1 ~= 1, "a" == "a", "a" == "b", 2 < 3, 3 <= 2)
+print(not nil, not 0, -(-3), #"four", "ab" .. "c" .. 1 .. 2)
+print(1 / 0 > 1e308, 5 % 0 ~= 5 % 0)
+
+-- dead branches
+if false then print("never") end
+if true then print("always") else print("never") end
+if nil then print("never") elseif 1 then print("elseif taken") end
+while false do print("never") end
+local debugMode = false
+if debugMode then print("debug") else print("release") end
+
+-- constant locals, and locals that only look constant
+local limit = 10
+print(limit * 2)
+local counter = 1
+counter = counter + 1
+print(counter)
+local shadow = 1
+do local shadow = 2 print(shadow) end
+print(shadow)
+local s = 5
+repeat local s = 6 until s == 6
+print("repeat", s)
+local function param(limit) return limit end
+print(param(3))
+for limit = 1, 2 do print("loop", limit) end
+print(limit)
+
+-- and/or with constant left operands
+local function two() return 1, 2 end
+print(true and "t" or "f", false or "default", nil and 1)
+print(true and two())
+print(false or two())
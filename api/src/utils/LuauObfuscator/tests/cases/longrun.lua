@@ -0,0 +1,6 @@
+-- More dispatches than the old 10000-100000 dispatcher iteration caps allowed
+local sum = 0
+for i = 1, 300000 do
+    sum = sum + i % 7
+end
+print("sum", sum)
@@ -0,0 +1,81 @@
+-- break, repeat-until and loop exits
+
+-- break inside while true: the loop ends and the code after it runs
+local x = 0
+while true do
+    x = x + 1
+    if x > 3 then break end
+end
+print("while true", x)
+
+-- break only leaves the innermost loop
+local inner = 0
+for i = 1, 4 do
+    for j = 1, 4 do
+        if j > i then break end
+        inner = inner + 1
+    end
+end
+print("nested", inner)
+
+-- numeric for: each iteration's closure keeps its own i
+local fns = {}
+for i = 1, 10 do
+    fns[#fns + 1] = function() return i end
+    if i == 3 then break end
+end
+print("for break", #fns, fns[1](), fns[3]())
+
+-- generic for
+local seen = {}
+for _, v in ipairs({5, 6, 7, 8}) do
+    if v == 7 then break end
+    seen[#seen + 1] = v
+end
+print("ipairs break", #seen, seen[1], seen[2])
+
+local sum = 0
+for _, v in pairs({a = 1, b = 2, c = 3}) do
+    sum = sum + v
+end
+print("pairs", sum)
+
+-- repeat runs the body before the test, and until sees the body's locals
+local n = 10
+repeat n = n + 1 until n > 5
+print("repeat once", n)
+
+local k = 0
+repeat
+    local doubled = k * 2
+    k = k + 1
+until doubled >= 6
+print("repeat local", k)
+
+local r = 0
+repeat
+    r = r + 1
+    if r == 2 then break end
+until false
+print("repeat break", r)
+
+-- break after a closure captured a local of the body
+local saved
+local m = 0
+while true do
+    m = m + 1
+    local mine = m * 10
+    saved = function() return mine end
+    if m == 2 then break end
+end
+print("closed", saved())
+
+-- a loop left only through return
+local function firstSquareOver(limit)
+    local i = 0
+    while true do
+        i = i + 1
+        if i * i > limit then return i end
+    end
+end
+print("return exit", firstSquareOver(50))
@@ -0,0 +1,276 @@
+-- Register allocation: more than 200 locals across scopes, closures that
+-- capture loop locals, and multiple assignment under register pressure
+
+local function wide()
+    local v1 = 1
+    local v2 = 2
+    local v3 = 3
+    local v4 = 4
+    local v5 = 5
+    local v6 = 6
+    local v7 = 7
+    local v8 = 8
+    local v9 = 9
+    local v10 = 10
+    local v11 = 11
+    local v12 = 12
+    local v13 = 13
+    local v14 = 14
+    local v15 = 15
+    local v16 = 16
+    local v17 = 17
+    local v18 = 18
+    local v19 = 19
+    local v20 = 20
+    local v21 = 21
+    local v22 = 22
+    local v23 = 23
+    local v24 = 24
+    local v25 = 25
+    local v26 = 26
+    local v27 = 27
+    local v28 = 28
+    local v29 = 29
+    local v30 = 30
+    local v31 = 31
+    local v32 = 32
+    local v33 = 33
+    local v34 = 34
+    local v35 = 35
+    local v36 = 36
+    local v37 = 37
+    local v38 = 38
+    local v39 = 39
+    local v40 = 40
+    local v41 = 41
+    local v42 = 42
+    local v43 = 43
+    local v44 = 44
+    local v45 = 45
+    local v46 = 46
+    local v47 = 47
+    local v48 = 48
+    local v49 = 49
+    local v50 = 50
+    local v51 = 51
+    local v52 = 52
+    local v53 = 53
+    local v54 = 54
+    local v55 = 55
+    local v56 = 56
+    local v57 = 57
+    local v58 = 58
+    local v59 = 59
+    local v60 = 60
+    local v61 = 61
+    local v62 = 62
+    local v63 = 63
+    local v64 = 64
+    local v65 = 65
+    local v66 = 66
+    local v67 = 67
+    local v68 = 68
+    local v69 = 69
+    local v70 = 70
+    local v71 = 71
+    local v72 = 72
+    local v73 = 73
+    local v74 = 74
+    local v75 = 75
+    local v76 = 76
+    local v77 = 77
+    local v78 = 78
+    local v79 = 79
+    local v80 = 80
+    local v81 = 81
+    local v82 = 82
+    local v83 = 83
+    local v84 = 84
+    local v85 = 85
+    local v86 = 86
+    local v87 = 87
+    local v88 = 88
+    local v89 = 89
+    local v90 = 90
+    local v91 = 91
+    local v92 = 92
+    local v93 = 93
+    local v94 = 94
+    local v95 = 95
+    local v96 = 96
+    local v97 = 97
+    local v98 = 98
+    local v99 = 99
+    local v100 = 100
+    local v101 = 101
+    local v102 = 102
+    local v103 = 103
+    local v104 = 104
+    local v105 = 105
+    local v106 = 106
+    local v107 = 107
+    local v108 = 108
+    local v109 = 109
+    local v110 = 110
+    local v111 = 111
+    local v112 = 112
+    local v113 = 113
+    local v114 = 114
+    local v115 = 115
+    local v116 = 116
+    local v117 = 117
+    local v118 = 118
+    local v119 = 119
+    local v120 = 120
+    local v121 = 121
+    local v122 = 122
+    local v123 = 123
+    local v124 = 124
+    local v125 = 125
+    local v126 = 126
+    local v127 = 127
+    local v128 = 128
+    local v129 = 129
+    local v130 = 130
+    local v131 = 131
+    local v132 = 132
+    local v133 = 133
+    local v134 = 134
+    local v135 = 135
+    local v136 = 136
+    local v137 = 137
+    local v138 = 138
+    local v139 = 139
+    local v140 = 140
+    local v141 = 141
+    local v142 = 142
+    local v143 = 143
+    local v144 = 144
+    local v145 = 145
+    local v146 = 146
+    local v147 = 147
+    local v148 = 148
+    local v149 = 149
+    local v150 = 150
+    local v151 = 151
+    local v152 = 152
+    local v153 = 153
+    local v154 = 154
+    local v155 = 155
+    local v156 = 156
+    local v157 = 157
+    local v158 = 158
+    local v159 = 159
+    local v160 = 160
+    local v161 = 161
+    local v162 = 162
+    local v163 = 163
+    local v164 = 164
+    local v165 = 165
+    local v166 = 166
+    local v167 = 167
+    local v168 = 168
+    local v169 = 169
+    local v170 = 170
+    local v171 = 171
+    local v172 = 172
+    local v173 = 173
+    local v174 = 174
+    local v175 = 175
+    local v176 = 176
+    local v177 = 177
+    local v178 = 178
+    local v179 = 179
+    local v180 = 180
+    do
+        local w1 = v1 + v180
+        local w2 = v2 + v179
+        local w3 = v3 + v178
+        local w4 = v4 + v177
+        local w5 = v5 + v176
+        local w6 = v6 + v175
+        local w7 = v7 + v174
+        local w8 = v8 + v173
+        local w9 = v9 + v172
+        local w10 = v10 + v171
+        local w11 = v11 + v170
+        local w12 = v12 + v169
+        local w13 = v13 + v168
+        local w14 = v14 + v167
+        local w15 = v15 + v166
+        v1 = w1 + w2 + w3 + w4 + w5 + w6 + w7 + w8 + w9 + w10 + w11 + w12 + w13 + w14 + w15
+    end
+    do
+        local w1 = v16 + v180
+        local w2 = v17 + v179
+        local w3 = v18 + v178
+        local w4 = v19 + v177
+        local w5 = v20 + v176
+        local w6 = v21 + v175
+        local w7 = v22 + v174
+        local w8 = v23 + v173
+        local w9 = v24 + v172
+        local w10 = v25 + v171
+        local w11 = v26 + v170
+        local w12 = v27 + v169
+        local w13 = v28 + v168
+        local w14 = v29 + v167
+        local w15 = v30 + v166
+        v2 = w1 + w2 + w3 + w4 + w5 + w6 + w7 + w8 + w9 + w10 + w11 + w12 + w13 + w14 + w15
+    end
+    return (v1 + v2 + v3 + v4 + v5 + v6 + v7 + v8 + v9 + v10 + v11 + v12 + v13 + v14 + v15 + v16 + v17 + v18 + v19 + v20 + v21 + v22 + v23 + v24 + v25 + v26 + v27 + v28 + v29 + v30), (v31 + v32 + v33 + v34 + v35 + v36 + v37 + v38 + v39 + v40 + v41 + v42 + v43 + v44 + v45 + v46 + v47 + v48 + v49 + v50 + v51 + v52 + v53 + v54 + v55 + v56 + v57 + v58 + v59 + v60), (v61 + v62 + v63 + v64 + v65 + v66 + v67 + v68 + v69 + v70 + v71 + v72 + v73 + v74 + v75 + v76 + v77 + v78 + v79 + v80 + v81 + v82 + v83 + v84 + v85 + v86 + v87 + v88 + v89 + v90), (v91 + v92 + v93 + v94 + v95 + v96 + v97 + v98 + v99 + v100 + v101 + v102 + v103 + v104 + v105 + v106 + v107 + v108 + v109 + v110 + v111 + v112 + v113 + v114 + v115 + v116 + v117 + v118 + v119 + v120), (v121 + v122 + v123 + v124 + v125 + v126 + v127 + v128 + v129 + v130 + v131 + v132 + v133 + v134 + v135 + v136 + v137 + v138 + v139 + v140 + v141 + v142 + v143 + v144 + v145 + v146 + v147 + v148 + v149 + v150), (v151 + v152 + v153 + v154 + v155 + v156 + v157 + v158 + v159 + v160 + v161 + v162 + v163 + v164 + v165 + v166 + v167 + v168 + v169 + v170 + v171 + v172 + v173 + v174 + v175 + v176 + v177 + v178 + v179 + v180)
+end
+print("wide", wide())
+
+local numeric = {}
+for i = 1, 3 do
+    numeric[i] = function() return i end
+end
+print("numeric for closures", numeric[1](), numeric[2](), numeric[3]())
+
+local generic = {}
+for k, v in ipairs({"x", "y", "z"}) do
+    generic[k] = function() return k .. v end
+end
+print("generic for closures", generic[1](), generic[2](), generic[3]())
+
+local whiles = {}
+local i = 0
+while i < 3 do
+    i = i + 1
+    local captured = i * 10
+    whiles[i] = function() captured = captured + 1 return captured end
+end
+print("while closures", whiles[1](), whiles[1](), whiles[2](), whiles[3]())
+
+local repeats = {}
+local j = 0
+repeat
+    j = j + 1
+    local captured = j
+    repeats[j] = function() return captured end
+until captured >= 3
+print("repeat closures", repeats[1](), repeats[2](), repeats[3]())
+
+local shared = {}
+for n = 1, 2 do
+    local count = 0
+    shared[n] = {
+        inc = function() count = count + n end,
+        get = function() return count end,
+    }
+end
+shared[1].inc() shared[2].inc() shared[2].inc()
+print("shared upvalues", shared[1].get(), shared[2].get())
+
+local a, b, c = 1, 2, 3
+a, b, c = c, a, b
+print("rotate", a, b, c)
+a, b = b, a
+print("swap", a, b)
+local t = {1, 2}
+t[1], t[2] = t[2], t[1]
+print("table swap", t[1], t[2])
+local x, y, z = (function() return 7, 8, 9 end)()
+x, y, z = z, x + y, x * y * z
+print("mixed", x, y, z)
@@ -0,0 +1,53 @@
+-- Fused instruction pairs: GETGLOBAL+CALL, SELF+CALL, GETTABLE+GETTABLE,
+-- LOADK+SETTABLE and comparison/test+JMP, including jumps that land on the
+-- second half of a pair
+
+print("global call", type(print), tostring(12))
+
+local account = {balance = 100}
+function account:deposit(n) self.balance = self.balance + n return self.balance end
+function account:get() return self.balance end
+print("method call", account:deposit(25), account:get())
+local text = "Hello"
+print("string method", text:upper(), text:sub(2, 3), text:len())
+
+local config = {window = {size = {w = 640, h = 480}}, name = "cfg"}
+print("nested index", config.window.size.w, config.window.size.h)
+local size = config.window.size
+print("index chain", size.w * size.h)
+
+local record = {}
+record.kind = "point"
+record.label = "origin"
+record[1] = 0
+local key = "dynamic"
+record[key] = "set"
+print("constant stores", record.kind, record.label, record[1], record.dynamic)
+
+local hits = 0
+for i = 1, 20 do
+    if i == 3 then hits = hits + 100 end
+    if i < 5 then hits = hits + 1 end
+    if i <= 2 then hits = hits + 10 end
+    if i % 2 == 0 then hits = hits + 1000 end
+    if record[i] then hits = hits + 5 end
+end
+print("compare and jump", hits)
+
+-- Loops whose back edge lands on a fused call
+local n = 0
+while n < 3 do
+    print("loop call", n)
+    n = n + 1
+end
+local parts = {}
+for i = 1, 3 do
+    parts[#parts + 1] = text:sub(i, i)
+end
+print("loop method", table.concat(parts, ","))
+
+local found
+for _, item in ipairs({"a", "bb", "ccc"}) do
+    if #item == 2 then found = item break end
+end
+print("found", found)
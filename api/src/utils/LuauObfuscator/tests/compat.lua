@@ -0,0 +1,17 @@
+-- Prepended to every generated script so a stock Lua 5.1 or LuaJIT can run
+-- the VM, which is written for Luau: bit32 comes from LuaJIT's bit library.
+if not bit32 and bit then
+    local function u(x) return x % 4294967296 end
+    bit32 = {}
+    function bit32.band(a, b) return u(bit.band(a, b)) end
+    function bit32.bor(a, b) return u(bit.bor(a, b)) end
+    function bit32.bnot(a) return u(bit.bnot(a)) end
+    function bit32.lshift(a, n) return u(bit.lshift(a, n)) end
+    function bit32.rshift(a, n) return u(bit.rshift(a, n)) end
+    function bit32.rrotate(a, n) return u(bit.ror(a, n)) end
+    function bit32.bxor(a, b, ...)
+        local r = u(bit.bxor(a, b or 0))
+        if ... then return bit32.bxor(r, ...) end
+        return r
+    end
+end
@@ -1,84 +1,273 @@
 // ═══════════════════════════════════════════════════════════════
 // LUAU OBFUSCATOR WRAPPER
-// Wrapper for the C-based LuauObfuscator binary
+// Wrapper for the C-based LuauObfuscator (in-process addon or binary)
 // ═══════════════════════════════════════════════════════════════
 
-const { execSync } = require('child_process');
+const { spawn } = require('child_process');
 const fs = require('fs');
 const path = require('path');
-const crypto = require('crypto');
 const os = require('os');
+const { AppError } = require('../middleware/errorHandler');
 
 // Path to the obfuscator binary
 const OBFUSCATOR_PATH = process.env.NODE_ENV === 'production'
   ? path.join('/app', 'obfuscator', 'Obfuscator')
   : path.join(__dirname, 'LuauObfuscator', 'bin', 'Obfuscator.exe');
 
+// Path to the N-API addon (runs jobs on the libuv threadpool, no process spawns)
+const ADDON_PATH = process.env.NODE_ENV === 'production'
+  ? path.join('/app', 'obfuscator', 'luauobf.node')
+  : path.join(__dirname, 'LuauObfuscator', 'bin', 'luauobf.node');
+
+let addon = null;
+try {
+  addon = require(ADDON_PATH);
+} catch (error) {
+  if (fs.existsSync(ADDON_PATH)) {
+    console.error('[Obfuscator] Failed to load addon, using serve processes:', error.message);
+  }
+}
+
+// Worker threads inside the resident "--serve" process (and jobs the addon runs at once)
+const WORKERS = parseInt(process.env.OBFUSCATOR_WORKERS, 10) || Math.max(1, Math.min(4, os.cpus().length));
+// Jobs allowed to wait for a worker; beyond this requests fail fast with 503
+const QUEUE_DEPTH = parseInt(process.env.OBFUSCATOR_QUEUE_DEPTH, 10) || WORKERS * 8;
+// Recycle the process after this many jobs to cap its heap growth
+const MAX_JOBS_PER_PROCESS = parseInt(process.env.OBFUSCATOR_MAX_JOBS, 10) || 2000;
+// Ready-made builds the serve process keeps per script (0 disables the pool)
+const POOL_SIZE = parseInt(process.env.OBFUSCATOR_POOL_SIZE, 10) || 0;
+const JOB_TIMEOUT_MS = 60000; // 60 second deadline, enforced by the obfuscator
+const KILL_GRACE_MS = 5000;   // Extra time before a stuck process is killed
+
+// Serve protocol constants (see WIRE FORMAT in LuauObfuscator/src/Server/Server.c)
+const KIND_OBFUSCATE = 0;
+const KIND_CANCEL = 1;
+const KIND_POOLED = 2;
+const STATUS_OK = 0;
+const STATUS_BUSY = 2;
+const STATUS_TIMEOUT = 3;
+const STATUS_CANCELLED = 4;
+
+function busyError() {
+  return new AppError('Obfuscator is busy, retry shortly', 503, 'OBFUSCATOR_BUSY');
+}
+
+function timeoutError() {
+  return new AppError('Obfuscation timed out', 504, 'OBFUSCATION_TIMEOUT');
+}
+
 /**
- * Obfuscate Lua code using the LuauObfuscator binary
- * @param {string} code - The Lua source code to obfuscate
- * @param {object} options - Options for obfuscation
- * @returns {object} - Result with obfuscated code
- * @throws {Error} - If obfuscation fails (NO FALLBACK)
+ * Encode an obfuscate request frame for the obfuscator serve protocol
+ * Layout: u32 length | u8 kind | u32 id | [u32 len + poolKey] | u64 seed | u32 options
+ *         | u32 timeoutMs | u32 len + watermark | u32 len + source
  */
-function obfuscate(code, options = {}) {
-  const { userId = 'unknown', keyId = 'unknown', sessionId = '' } = options;
-  
-  // Generate unique temp file names
-  const tempId = crypto.randomBytes(8).toString('hex');
-  const tempDir = os.tmpdir();
-  const inputFile = path.join(tempDir, `obf_input_${tempId}.lua`);
-  const outputFile = path.join(tempDir, `obf_output_${tempId}.lua`);
-  
-  try {
-    // Add watermark comment to track usage (embedded in obfuscated code)
-    const watermark = `-- Wisper Hub | User: ${userId} | Session: ${sessionId.substring(0, 8)}\n`;
-    const codeWithWatermark = watermark + code;
-    
-    // Write input file
-    fs.writeFileSync(inputFile, codeWithWatermark, 'utf8');
-    
-    // Check if obfuscator binary exists
-    if (!fs.existsSync(OBFUSCATOR_PATH)) {
-      throw new Error(`Obfuscator binary not found at: ${OBFUSCATOR_PATH}`);
+function encodeRequest(id, source, { seed = 0n, options = 0, timeoutMs = JOB_TIMEOUT_MS, watermark = '', poolKey = '' } = {}) {
+  const keyBuf = Buffer.from(POOL_SIZE > 0 ? String(poolKey) : '', 'utf8');
+  const watermarkBuf = Buffer.from(watermark, 'utf8');
+  const sourceBuf = Buffer.from(source, 'utf8');
+  const keyField = keyBuf.length ? 4 + keyBuf.length : 0;
+  const body = Buffer.alloc(20);
+  body.writeBigUInt64LE(BigInt(seed), 0);
+  body.writeUInt32LE(options, 8);
+  body.writeUInt32LE(timeoutMs, 12);
+  body.writeUInt32LE(watermarkBuf.length, 16);
+  const header = Buffer.alloc(9 + keyField);
+  header.writeUInt32LE(5 + keyField + body.length + watermarkBuf.length + 4 + sourceBuf.length, 0);
+  header.writeUInt8(keyBuf.length ? KIND_POOLED : KIND_OBFUSCATE, 4);
+  header.writeUInt32LE(id, 5);
+  if (keyBuf.length) {
+    header.writeUInt32LE(keyBuf.length, 9);
+    keyBuf.copy(header, 13);
+  }
+  const sourceLen = Buffer.alloc(4);
+  sourceLen.writeUInt32LE(sourceBuf.length, 0);
+  return Buffer.concat([header, body, watermarkBuf, sourceLen, sourceBuf]);
+}
+
+function encodeCancel(id) {
+  const frame = Buffer.alloc(9);
+  frame.writeUInt32LE(5, 0);
+  frame.writeUInt8(KIND_CANCEL, 4);
+  frame.writeUInt32LE(id, 5);
+  return frame;
+}
+
+class ObfuscatorProcess {
+  constructor(onExit) {
+    this.pending = new Map();
+    this.jobsStarted = 0;
+    this.retiring = false;
+    this.buffer = Buffer.alloc(0);
+
+    this.proc = spawn(OBFUSCATOR_PATH, [
+      '--serve', '--workers', String(WORKERS), '--queue-depth', String(QUEUE_DEPTH),
+      '--pool', String(POOL_SIZE)
+    ], { stdio: ['pipe', 'pipe', 'pipe'] });
+    this.proc.stdout.on('data', (chunk) => this.onData(chunk));
+    this.proc.stderr.on('data', (chunk) => {
+      const text = chunk.toString().trim();
+      if (text.includes('[ERROR]')) console.error('[Obfuscator]', text);
+    });
+    this.proc.stdin.on('error', () => {}); // Surfaced through 'exit'
+    this.proc.on('error', (error) => this.fail(error));
+    this.proc.on('exit', (code, signal) => {
+      this.fail(new Error(`Obfuscator process exited (code ${code}, signal ${signal})`));
+      onExit(this);
+    });
+  }
+
+  run(source, request, signal) {
+    const id = ++this.jobsStarted;
+    if (this.jobsStarted >= MAX_JOBS_PER_PROCESS) this.retiring = true;
+
+    return new Promise((resolve, reject) => {
+      // The server answers with a timeout status at the deadline; only a
+      // process that stays silent past the grace period is treated as stuck
+      const timer = setTimeout(() => {
+        this.fail(timeoutError());
+        this.proc.kill('SIGKILL');
+      }, JOB_TIMEOUT_MS + KILL_GRACE_MS);
+
+      this.pending.set(id, { resolve, reject, timer });
+      this.proc.stdin.write(encodeRequest(id, source, request));
+      if (signal) signal.addEventListener('abort', () => this.cancel(id), { once: true });
+    });
+  }
+
+  cancel(id) {
+    if (this.pending.has(id)) this.proc.stdin.write(encodeCancel(id));
+  }
+
+  onData(chunk) {
+    this.buffer = this.buffer.length ? Buffer.concat([this.buffer, chunk]) : chunk;
+
+    while (this.buffer.length >= 4) {
+      const length = this.buffer.readUInt32LE(0);
+      if (this.buffer.length < 4 + length) break;
+
+      const id = this.buffer.readUInt32LE(4);
+      const status = this.buffer.readUInt8(8);
+      // Scripts are preceded by the u64 seed they were built from
+      const seed = status === STATUS_OK ? this.buffer.readBigUInt64LE(9) : 0n;
+      const body = this.buffer.toString('utf8', status === STATUS_OK ? 17 : 9, 4 + length);
+      this.buffer = this.buffer.subarray(4 + length);
+
+      const job = this.pending.get(id);
+      if (!job) continue;
+      this.pending.delete(id);
+      clearTimeout(job.timer);
+
+      if (status === STATUS_OK) {
+        job.resolve({ code: body, seed });
+      } else if (status === STATUS_BUSY) {
+        job.reject(busyError());
+      } else if (status === STATUS_TIMEOUT) {
+        job.reject(timeoutError());
+      } else if (status === STATUS_CANCELLED) {
+        job.reject(new Error('Obfuscation cancelled'));
+      } else {
+        job.reject(new Error(body || 'Obfuscation failed'));
+      }
     }
-    
-    // Execute obfuscator - NO FALLBACK, must succeed
-    execSync(`"${OBFUSCATOR_PATH}" "${inputFile}" "${outputFile}"`, {
-      timeout: 60000, // 60 second timeout
-      stdio: 'pipe'
+
+    if (this.retiring && this.pending.size === 0) {
+      this.proc.stdin.end(); // Process exits once its queue drains and stdin closes
+    }
+  }
+
+  fail(error) {
+    for (const job of this.pending.values()) {
+      clearTimeout(job.timer);
+      job.reject(error);
+    }
+    this.pending.clear();
+  }
+}
+
+let current = null;
+
+function acquireProcess() {
+  if (!fs.existsSync(OBFUSCATOR_PATH)) {
+    throw new Error(`Obfuscator binary not found at: ${OBFUSCATOR_PATH}`);
+  }
+
+  if (!current || current.retiring) {
+    current = new ObfuscatorProcess((proc) => {
+      if (current === proc) current = null;
     });
-    
-    // Read output file
-    if (!fs.existsSync(outputFile)) {
-      throw new Error('Obfuscator did not produce output file');
+  }
+  return current;
+}
+
+// Jobs handed to the addon and not yet settled (bounded like the server queue)
+let addonInFlight = 0;
+
+/**
+ * Run one job through the addon when available, otherwise through the serve pool
+ * Resolves to { code, seed } (seed is a BigInt that rebuilds the same output)
+ */
+async function runJob(code, request, signal) {
+  if (signal && signal.aborted) throw new Error('Obfuscation cancelled');
+  // Pooled requests go to the serve process, which keeps the pre-built variants
+  const pooled = POOL_SIZE > 0 && request.poolKey;
+  if (addon && !pooled) {
+    if (addonInFlight >= WORKERS + QUEUE_DEPTH) throw busyError();
+    addonInFlight++;
+    try {
+      // The addon polls this flag between pipeline stages
+      const cancelFlag = new Int32Array(1);
+      if (signal) signal.addEventListener('abort', () => Atomics.store(cancelFlag, 0, 1), { once: true });
+
+      const result = await addon.obfuscate(code, { timeoutMs: JOB_TIMEOUT_MS, cancelFlag, ...request });
+      return { code: result.code, seed: result.seed };
+    } catch (error) {
+      if (error.code === 'OBFUSCATION_TIMEOUT') throw timeoutError();
+      if (error.code === 'OBFUSCATION_CANCELLED') throw new Error('Obfuscation cancelled');
+      throw error;
+    } finally {
+      addonInFlight--;
     }
-    
-    const obfuscatedCode = fs.readFileSync(outputFile, 'utf8');
-    
+  }
+  return acquireProcess().run(code, request, signal);
+}
+
+/**
+ * Obfuscate Lua code using the LuauObfuscator addon or serve pool
+ * @param {string} code - The Lua source code to obfuscate
+ * @param {object} options - Options for obfuscation (signal: AbortSignal cancels a queued or running job;
+ *   poolKey: stable script id, serves a pre-built variant when OBFUSCATOR_POOL_SIZE is set;
+ *   seed: decimal string from a previous result's stats.seed, rebuilds that exact output)
+ * @returns {Promise<object>} - Result with obfuscated code
+ * @throws {Error} - If obfuscation fails (NO FALLBACK); AppError 503/504 when busy or timed out
+ */
+async function obfuscate(code, options = {}) {
+  const { userId = 'unknown', keyId = 'unknown', sessionId = '', poolKey, seed, signal } = options;
+
+  try {
+    // Watermark to track usage (encrypted constant in the payload, read back
+    // with `Obfuscator --extract-watermark <file>`)
+    const watermark = `Wisper Hub | User: ${userId} | Session: ${sessionId.substring(0, 8)}`;
+
+    // Execute obfuscator - NO FALLBACK, must succeed
+    const request = seed ? { watermark, seed: BigInt(seed) } : { watermark, poolKey };
+    const { code: obfuscatedCode, seed: usedSeed } = await runJob(code, request, signal);
+
     if (!obfuscatedCode || obfuscatedCode.trim().length === 0) {
       throw new Error('Obfuscator produced empty output');
     }
-    
+
     return {
       success: true,
       code: obfuscatedCode,
       stats: {
         originalSize: code.length,
-        obfuscatedSize: obfuscatedCode.length
+        obfuscatedSize: obfuscatedCode.length,
+        seed: usedSeed.toString()
       }
     };
   } catch (error) {
     console.error('[Obfuscator] FATAL ERROR:', error.message);
     throw error; // Re-throw - NO FALLBACK to original code
-  } finally {
-    // Cleanup temp files
-    try {
-      if (fs.existsSync(inputFile)) fs.unlinkSync(inputFile);
-      if (fs.existsSync(outputFile)) fs.unlinkSync(outputFile);
-    } catch (e) {
-      // Ignore cleanup errors
-    }
   }
 }
 